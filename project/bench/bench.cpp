@@ -0,0 +1,355 @@
+// bench.cpp
+// Microbenchmarks of the interpreter hot paths plus timed runs of the .ts
+// corpus. Prints one JSON object per line:
+//   {"name":"eval/arith","ns_per_op":42.1,"iterations":1048576}
+//
+// Usage: bench [--filter TEXT] [--min-time SECONDS] [--corpus DIR]
+#include "interpreter.h"
+#include "module.h"
+#include "os.h"
+#include "setup.h"
+#include "ts.h"
+#ifdef ADD_STD_HALF
+#include "half.h"
+#endif
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    struct Options
+    {
+        const char *filter = nullptr;
+        double minTime = 0.2; // seconds per measurement
+        std::string corpus = "bench/corpus";
+    };
+
+    Options options;
+
+    // Keeps the compiler from dropping a computed value
+    template <typename T>
+    inline void keep(const T &value)
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        asm volatile("" : : "g"(&value) : "memory");
+#else
+        static const volatile void *sink;
+        sink = &value;
+#endif
+    }
+
+    bool selected(const std::string &name)
+    {
+        return !options.filter || name.find(options.filter) != std::string::npos;
+    }
+
+    void report(const std::string &name, double nsPerOp, uint64_t iterations)
+    {
+        std::printf("{\"name\":\"%s\",\"ns_per_op\":%.2f,\"iterations\":%llu}\n",
+                    name.c_str(), nsPerOp, static_cast<unsigned long long>(iterations));
+        std::fflush(stdout);
+    }
+
+    // Runs body(n) with growing n until one run takes minTime, then reports
+    // the best of three runs of that size
+    template <typename Body>
+    void measure(const std::string &name, Body body)
+    {
+        if (!selected(name))
+            return;
+
+        auto run = [&](uint64_t n)
+        {
+            auto start = Clock::now();
+            body(n);
+            return std::chrono::duration<double>(Clock::now() - start).count();
+        };
+
+        uint64_t n = 1;
+        double seconds = run(n);
+        while (seconds < options.minTime && n < (1ull << 40))
+        {
+            double scale = seconds > 0 ? options.minTime / seconds : 100.0;
+            n = std::max<uint64_t>(n + 1, static_cast<uint64_t>(n * std::min(scale * 1.2, 100.0)));
+            seconds = run(n);
+        }
+        double best = seconds;
+        for (int repeat = 0; repeat < 2; ++repeat)
+            best = std::min(best, run(n));
+        report(name, best * 1e9 / static_cast<double>(n), n);
+    }
+
+    // A context with the builtins, some variables and a user function
+    struct Fixture
+    {
+        OS::StringConsole console;
+        Setup::Runtime runtime{&console};
+        Interpreter::Context &ctx = runtime.context();
+
+        Fixture()
+        {
+            runtime.runString("let x = 12.5;\n"
+                              "let s = \"abc\";\n"
+                              "function add(a: number, b: number): number {\n"
+                              "    return a + b;\n"
+                              "}\n"
+                              "function twice(a: number): number {\n"
+                              "    return add(a, a);\n"
+                              "}\n");
+        }
+
+        // Drops captured output so long runs do not grow it
+        void drain() { console.takeOutput(); }
+    };
+
+    void benchExpressions()
+    {
+        Fixture f;
+        auto eval = [&f](const char *name, const std::string &expr)
+        {
+            measure(name, [&](uint64_t n)
+                    {
+                for (uint64_t i = 0; i < n; ++i)
+                    keep(Interpreter::evalSimpleExpression(expr, f.ctx.variables, f.ctx)); });
+        };
+
+        eval("eval/arith", "1 + 2 * 3 - x / 4");
+        eval("eval/compare", "x > 3 && x <= 100 || !(x == 7)");
+        eval("eval/concat", "s + x + \"-suffix\"");
+        eval("eval/nested-builtins", "Math.max(Math.abs(x), Math.min(1, Math.sqrt(x)))");
+        eval("eval/user-call", "add(x, 1)");
+        eval("eval/nested-user-calls", "twice(add(x, 1))");
+    }
+
+    void benchStatements()
+    {
+        Fixture f;
+        struct Case
+        {
+            const char *kind;
+            const char *source;
+        };
+        const Case cases[] = {
+            {"let", "let y = x * 2;"},
+            {"assign", "x = x + 1;"},
+            {"if", "if (x > 3) {\n    x = 1;\n} else {\n    x = 2;\n}"},
+            {"while", "let k = 0;\nwhile (k < 10) {\n    k += 1;\n}"},
+            {"for", "for (let j = 0; j < 10; j++) {\n    x = j;\n}"},
+            {"call", "add(x, 2);"},
+            {"console.log", "console.log(x, s);"},
+        };
+
+        for (const Case &c : cases)
+        {
+            // From text: compile + run, as interactive input does (executeLine
+            // for one-line statements, executeScript for blocks)
+            std::vector<std::string> lines;
+            for (std::string_view line : Interpreter::splitLines(c.source))
+                lines.emplace_back(line);
+            measure(std::string("line/") + c.kind, [&](uint64_t n)
+                    {
+                for (uint64_t i = 0; i < n; ++i)
+                {
+                    if (lines.size() == 1)
+                        Interpreter::executeLine(lines[0], f.ctx);
+                    else
+                        Interpreter::executeScript(lines, f.ctx);
+                }
+                f.drain(); });
+
+            // Precompiled: the cost of executing the statement alone
+            Interpreter::Block block = Interpreter::compileSource(c.source);
+            measure(std::string("block/") + c.kind, [&](uint64_t n)
+                    {
+                for (uint64_t i = 0; i < n; ++i)
+                    Interpreter::executeBlock(block, f.ctx);
+                f.drain(); });
+        }
+    }
+
+    void benchCalls()
+    {
+        Fixture f;
+        Interpreter::Block call = Interpreter::compileSource("let r = add(1, 2);");
+        measure("call/user-function", [&](uint64_t n)
+                {
+            for (uint64_t i = 0; i < n; ++i)
+                Interpreter::executeBlock(call, f.ctx); });
+
+        Interpreter::Block builtin = Interpreter::compileSource("let r = Math.abs(-2);");
+        measure("call/builtin-fixed-arity", [&](uint64_t n)
+                {
+            for (uint64_t i = 0; i < n; ++i)
+                Interpreter::executeBlock(builtin, f.ctx); });
+
+        Interpreter::Block variadic = Interpreter::compileSource("let r = Math.max(1, 2, 3);");
+        measure("call/builtin-variadic", [&](uint64_t n)
+                {
+            for (uint64_t i = 0; i < n; ++i)
+                Interpreter::executeBlock(variadic, f.ctx); });
+
+        measure("runtime/create", [&](uint64_t n)
+                {
+            for (uint64_t i = 0; i < n; ++i)
+            {
+                Setup::Runtime runtime;
+                keep(runtime);
+            } });
+    }
+
+    // A script of `functions` declarations, each called with literal arguments
+    std::string typeCheckScript(size_t functions)
+    {
+        std::string text;
+        for (size_t i = 0; i < functions; ++i)
+        {
+            std::string name = "f" + std::to_string(i);
+            text += "function " + name + "(a: number, b: string): number {\n";
+            text += "    let t = a * 2;\n";
+            text += "    return t + 1;\n";
+            text += "}\n";
+            text += name + "(" + std::to_string(i) + ", \"x\");\n";
+        }
+        return text;
+    }
+
+    void benchTypeCheck()
+    {
+        for (size_t functions : {10, 100, 1000})
+        {
+            std::string script = typeCheckScript(functions);
+            measure("typecheck/" + std::to_string(functions * 5) + "-lines", [&](uint64_t n)
+                    {
+                for (uint64_t i = 0; i < n; ++i)
+                    keep(TS::checkTypesInSource(script)); });
+        }
+    }
+
+    void benchValues()
+    {
+        TS::Value number(static_cast<NUMBER>(3.14159));
+        TS::Value integer(static_cast<NUMBER>(123456));
+        TS::Value text(std::string("2.5e3"));
+        TS::Value array = TS::Value::makeArray({TS::Value(static_cast<NUMBER>(1)), TS::Value(std::string("a")), TS::Value(true)});
+
+        measure("value/toString-number", [&](uint64_t n)
+                {
+            for (uint64_t i = 0; i < n; ++i)
+                keep(number.toString()); });
+        measure("value/toString-integer", [&](uint64_t n)
+                {
+            for (uint64_t i = 0; i < n; ++i)
+                keep(integer.toString()); });
+        measure("value/toString-array", [&](uint64_t n)
+                {
+            for (uint64_t i = 0; i < n; ++i)
+                keep(array.toString()); });
+        measure("value/toNumber-string", [&](uint64_t n)
+                {
+            for (uint64_t i = 0; i < n; ++i)
+                keep(text.toNumber()); });
+        measure("value/copy-string", [&](uint64_t n)
+                {
+            for (uint64_t i = 0; i < n; ++i)
+            {
+                TS::Value copy = text;
+                keep(copy);
+            } });
+    }
+
+#ifdef ADD_STD_HALF
+    void benchHalf()
+    {
+        constexpr size_t kCount = 4096;
+        std::vector<float> floats(kCount);
+        std::vector<half> halves(kCount);
+        for (size_t i = 0; i < kCount; ++i)
+            floats[i] = static_cast<float>(i) * 0.37f - 700.0f;
+
+        measure("half/float_to_half", [&](uint64_t n)
+                {
+            for (uint64_t i = 0; i < n; ++i)
+                keep(half::float_to_half(floats[i % kCount])); });
+        measure("half/half_to_float", [&](uint64_t n)
+                {
+            for (uint64_t i = 0; i < n; ++i)
+                keep(half::half_to_float(static_cast<uint16_t>(i))); });
+        // Per element, batches of kCount
+        measure("half/fromFloats", [&](uint64_t n)
+                {
+            for (uint64_t i = 0; i < n; i += kCount)
+                half::fromFloats(floats.data(), halves.data(), kCount);
+            keep(halves[0]); });
+        measure("half/toFloats", [&](uint64_t n)
+                {
+            for (uint64_t i = 0; i < n; i += kCount)
+                half::toFloats(halves.data(), floats.data(), kCount);
+            keep(floats[0]); });
+    }
+#endif
+
+    // Each corpus script in a fresh runtime; one op is one whole run
+    void benchCorpus()
+    {
+        std::vector<std::string> scripts;
+        if (!Setup::listBatch(options.corpus, scripts))
+            return;
+
+        for (const std::string &script : scripts)
+        {
+            std::string name = script.substr(script.find_last_of("/\\") + 1);
+            OS::StringConsole console;
+            Setup::Runtime loader(&console);
+            Setup::Program program = loader.load(script);
+            if (!program)
+            {
+                std::fprintf(stderr, "bench: %s failed to load:\n%s", script.c_str(), console.output().c_str());
+                continue;
+            }
+            measure("corpus/" + name, [&](uint64_t n)
+                    {
+                for (uint64_t i = 0; i < n; ++i)
+                {
+                    OS::StringConsole out;
+                    Setup::Runtime runtime(&out);
+                    runtime.run(program);
+                } });
+        }
+    }
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--filter") == 0 && i + 1 < argc)
+            options.filter = argv[++i];
+        else if (std::strcmp(argv[i], "--min-time") == 0 && i + 1 < argc)
+            options.minTime = std::atof(argv[++i]);
+        else if (std::strcmp(argv[i], "--corpus") == 0 && i + 1 < argc)
+            options.corpus = argv[++i];
+        else
+        {
+            std::fprintf(stderr, "Usage: bench [--filter TEXT] [--min-time SECONDS] [--corpus DIR]\n");
+            return 1;
+        }
+    }
+
+    benchExpressions();
+    benchStatements();
+    benchCalls();
+    benchTypeCheck();
+    benchValues();
+#ifdef ADD_STD_HALF
+    benchHalf();
+#endif
+    benchCorpus();
+    return 0;
+}
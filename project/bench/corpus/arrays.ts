@@ -0,0 +1,20 @@
+// Arrays: element access, typed array kernels
+let values = Float64Array(4096);
+for (let i = 0; i < 4096; i++) {
+    values[i] = i * 0.5;
+}
+let weights = Float64Array(4096);
+Array.fill(weights, 2);
+let dots = 0;
+for (let k = 0; k < 200; k++) {
+    dots = dots + Array.dot(values, weights);
+}
+let list = [];
+for (let j = 0; j < 2000; j++) {
+    Array.push(list, j);
+}
+let sum = 0;
+for (let j = 0; j < list.length; j++) {
+    sum = sum + list[j];
+}
+console.log(dots, Array.sum(values), sum);
@@ -0,0 +1,13 @@
+// Static class members and method calls
+class Counter {
+    static count = 0;
+    static step(by: number): number {
+        return by * 2;
+    }
+}
+
+let c = 0;
+for (let i = 0; i < 5000; i++) {
+    c = c + Counter.step(i);
+}
+console.log(c);
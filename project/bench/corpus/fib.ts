@@ -0,0 +1,9 @@
+// Recursive calls: user-function call overhead and frame setup
+function fib(n: number): number {
+    if (n < 2) {
+        return n;
+    }
+    return fib(n - 1) + fib(n - 2);
+}
+
+console.log(fib(20));
@@ -0,0 +1,30 @@
+// Small numeric functions called from a hot loop (tiered up to bytecode)
+function lerp(a: number, b: number, t: number): number {
+    return a + (b - a) * t;
+}
+function collatz(n: number): number {
+    let steps = 0;
+    while (n != 1) {
+        if (n % 2 == 0) {
+            n = n / 2;
+        } else {
+            n = 3 * n + 1;
+        }
+        steps++;
+    }
+    return steps;
+}
+function integrate(from: number, to: number, count: number): number {
+    let h = (to - from) / count;
+    let sum = 0;
+    for (let i = 0; i < count; i++) {
+        let x = from + (i + 0.5) * h;
+        sum = sum + x * x * h;
+    }
+    return sum;
+}
+let acc = 0;
+for (let i = 1; i < 3000; i++) {
+    acc = acc + lerp(0, i, 0.25) + collatz(i);
+}
+console.log(acc, integrate(0, 3, 20000));
@@ -0,0 +1,15 @@
+// Numeric loops: let/assign/if/while/for statements and arithmetic
+let total = 0;
+for (let i = 0; i < 20000; i++) {
+    let x = i % 7;
+    if (x == 3) {
+        total = total + x * 2;
+    } else {
+        total = total - 1;
+    }
+}
+let n = 0;
+while (n < 20000) {
+    n += 1;
+}
+console.log(total, n);
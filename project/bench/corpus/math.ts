@@ -0,0 +1,6 @@
+// Builtin calls: Math functions through the fixed-arity fast path
+let acc = 0;
+for (let i = 1; i < 20000; i++) {
+    acc = acc + Math.sqrt(i) * Math.sin(i) + Math.abs(Math.cos(i)) - Math.floor(i / 3);
+}
+console.log(Math.round(acc));
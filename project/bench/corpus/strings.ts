@@ -0,0 +1,13 @@
+// String building: concatenation and number formatting
+let text = "";
+for (let i = 0; i < 2000; i++) {
+    text = text + i + ",";
+}
+let words = 0;
+for (let j = 0; j < 2000; j++) {
+    let label = "item-" + j;
+    if (label.length > 6) {
+        words += 1;
+    }
+}
+console.log(text.length, words);
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+
+namespace TS
+{
+    /**
+     * Bump allocator for short-lived interpreter temporaries (value stacks,
+     * argument lists, large call frames).
+     * Allocation advances a pointer; memory is given back in bulk by rewinding
+     * to a Mark (or reset), which keeps the chunks for reuse, so a steady
+     * workload stops touching the general-purpose heap after warming up.
+     * Chunks come from an upstream memory_resource, the hook embedders use to
+     * supply their own memory. Not thread-safe: one arena per context.
+     */
+    class Arena : public std::pmr::memory_resource
+    {
+        struct Chunk;
+
+    public:
+        /**
+         * Default size of the chunks requested from upstream.
+         */
+        static constexpr size_t kChunkSize = 16 * 1024;
+
+        /**
+         * A position in the arena that rewind returns to.
+         */
+        struct Mark
+        {
+            Chunk *chunk = nullptr;
+            size_t used = 0;
+        };
+
+        /**
+         * Rewinds the arena to where it was when the scope was entered.
+         * Everything allocated inside the scope must be dead by then.
+         */
+        class Scope
+        {
+        public:
+            explicit Scope(Arena &arena) : arena(arena), mark(arena.mark()) {}
+            ~Scope() { arena.rewind(mark); }
+            Scope(const Scope &) = delete;
+            Scope &operator=(const Scope &) = delete;
+
+        private:
+            Arena &arena;
+            Mark mark;
+        };
+
+        explicit Arena(std::pmr::memory_resource *upstream = std::pmr::get_default_resource(),
+                       size_t chunkSize = kChunkSize);
+
+        /**
+         * Starts with a caller-provided buffer (e.g. on the stack) and only
+         * asks upstream for more once it is full. The buffer is never freed.
+         */
+        Arena(void *buffer, size_t size,
+              std::pmr::memory_resource *upstream = std::pmr::get_default_resource(),
+              size_t chunkSize = kChunkSize);
+
+        ~Arena();
+        Arena(const Arena &) = delete;
+        Arena &operator=(const Arena &) = delete;
+
+        /**
+         * @returns The current position, for a later rewind.
+         */
+        inline Mark mark() const { return Mark{current, used}; }
+
+        /**
+         * Releases everything allocated after `m`; the chunks stay cached.
+         */
+        inline void rewind(Mark m)
+        {
+            current = m.chunk ? m.chunk : head;
+            used = m.chunk ? m.used : 0;
+        }
+
+        /**
+         * Releases everything; the chunks stay cached.
+         */
+        inline void reset() { rewind(Mark{}); }
+
+        /**
+         * Returns the cached chunks to upstream. The arena must be empty (reset).
+         */
+        void shrink();
+
+        /**
+         * Replaces the resource chunks come from. Frees the cached chunks, so
+         * the arena must be empty (reset).
+         */
+        void setUpstream(std::pmr::memory_resource *resource);
+
+        inline std::pmr::memory_resource *upstream() const { return source; }
+
+        /**
+         * @returns Bytes held in chunks (used or cached), including the initial buffer.
+         */
+        size_t capacity() const;
+
+    private:
+        struct Chunk
+        {
+            Chunk *next;
+            size_t size; // usable bytes after the header
+            bool owned;  // allocated from upstream (not the initial buffer)
+        };
+
+        void *do_allocate(size_t bytes, size_t alignment) override;
+        void do_deallocate(void *p, size_t bytes, size_t alignment) override;
+        bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override { return this == &other; }
+
+        std::pmr::memory_resource *source;
+        size_t chunkSize;
+        Chunk *head = nullptr;    // first chunk; the initial buffer, if any
+        Chunk *current = nullptr; // chunk allocations come from; nullptr before the first one
+        size_t used = 0;          // bytes of `current` in use (after its header)
+    };
+
+} // namespace TS
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "simd.h"
+#include "ts.h"
+
+namespace TS
+{
+    /**
+     * @fn
+     * @short Creates an array of `type` (Array or a typed array) from `source`.
+     * A number gives that many zero (Array: null) elements; an array of any
+     * kind is copied element by element, converting to the element type.
+     */
+    Value makeArrayFrom(ValueType type, const Value &source);
+
+    /**
+     * @fn
+     * @short Shallow copy of an array, of the same kind.
+     * @returns The copy, or null if `array` is not an array.
+     */
+    Value copyArray(const Value &array);
+
+    // --- Bulk Operations ---
+    // Typed arrays run through the Simd kernels (Float16Array in float chunks
+    // via the batch half conversions); Arrays convert element by element.
+    // An argument that is not an array makes the operation a no-op (numeric
+    // results are NaN).
+
+    /**
+     * @fn
+     * @short Sets every element of `array` to `value`.
+     */
+    void fillArray(const Value &array, const Value &value);
+
+    /**
+     * @fn
+     * @short Sum of the elements of `array`.
+     */
+    NUMBER sumArray(const Value &array);
+
+    /**
+     * @fn
+     * @short Dot product of the first min(a.length, b.length) elements.
+     */
+    NUMBER dotArrays(const Value &a, const Value &b);
+
+    /**
+     * @fn
+     * @short Multiplies every element of `array` by `factor` in place.
+     */
+    void scaleArray(const Value &array, NUMBER factor);
+
+    /**
+     * @fn
+     * @short Adds `src` to `dst` element-wise in place (over the shorter length).
+     */
+    void addArrays(const Value &dst, const Value &src);
+
+    /**
+     * @fn
+     * @short Smallest (largest) element, like Math.min (Math.max) over the elements.
+     */
+    NUMBER minArray(const Value &array);
+    NUMBER maxArray(const Value &array);
+
+    /**
+     * @fn
+     * @short New array of the same kind holding op(element) for every element.
+     * @returns The result, or null if `array` is not an array.
+     */
+    Value mapArray(Simd::Unary op, const Value &array);
+
+    /**
+     * @fn
+     * @short New array of the same kind holding pow(element, exponent).
+     */
+    Value powArray(const Value &array, NUMBER exponent);
+
+    /**
+     * @fn
+     * @short New array of the kind of `a` holding a[i] op b[i] (over the shorter length).
+     * @returns The result, or null unless both are arrays.
+     */
+    Value combineArrays(Simd::Binary op, const Value &a, const Value &b);
+
+} // namespace TS
@@ -0,0 +1,403 @@
+#pragma once
+
+#include "ts.h"
+#include "objects.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Interpreter
+{
+    struct FunctionDef;
+    struct Statement;
+
+    /**
+     * Binary and unary operators of compiled expressions.
+     */
+    enum class OpCode : uint8_t
+    {
+        Add,       // +
+        Sub,       // -
+        Mul,       // *
+        Div,       // /
+        Mod,       // %
+        Pow,       // **
+        Eq,        // ==
+        Ne,        // !=
+        StrictEq,  // ===
+        StrictNe,  // !==
+        Lt,        // <
+        Gt,        // >
+        Le,        // <=
+        Ge,        // >=
+        And,       // &&
+        Or,        // ||
+        Neg,       // unary -
+        Plus,      // unary +
+        Not,       // unary !
+        Index,     // a[b]
+        Length     // a.length (unary)
+    };
+
+    /**
+     * Classification of a token in a compiled (RPN) expression.
+     */
+    enum class TokenKind : uint8_t
+    {
+        Operator, // apply `op` to the top one (unary) or two values
+        Literal,  // push `value` (numbers are already converted to NUMBER)
+        Variable, // push the variable `name`
+        Call,     // call `name` with the top `argc` values
+        Array,    // replace the top `argc` values by an Array of them
+        Member,   // replace the top value by its property `name`
+        Object,   // replace the top `argc` values by an Object with the properties `name` ("x,y")
+        New,      // replace the top `argc` values by a new instance of class `name`
+        Method    // call method `name` of the value below the top `argc` values with them
+    };
+
+    /**
+     * A type annotation (`a: number` on a parameter), resolved once when the
+     * source is compiled so calls never compare type names.
+     */
+    enum class DeclaredType : uint8_t
+    {
+        Any,     // not annotated, or annotated `any`
+        Number,  // number
+        String,  // string
+        Boolean, // boolean
+        Other    // any other name: no value passes the call-time check
+    };
+
+    /**
+     * @returns The declared type an annotation names ("any" or "" is Any).
+     */
+    DeclaredType declaredType(std::string_view annotation);
+
+    /**
+     * @returns True if `value` passes the call-time check of a parameter of type `type`.
+     */
+    inline bool hasDeclaredType(const TS::Value &value, DeclaredType type)
+    {
+        switch (type)
+        {
+        case DeclaredType::Any:
+            return true;
+        case DeclaredType::Number:
+            return value.type == TS::ValueType::Number;
+        case DeclaredType::String:
+            return value.type == TS::ValueType::String;
+        case DeclaredType::Boolean:
+            return value.type == TS::ValueType::Boolean;
+        default:
+            return false;
+        }
+    }
+
+    /**
+     * The property accesses a token or statement makes, resolved at compile
+     * time. For a dotted name (`p.x.y`, or `p.move` in a call) the first part
+     * names a variable and `keys` the properties read from it in turn.
+     * `caches` remembers, per key, the slot it was found at in the shape of
+     * the object it was last read from, so reading the same kind of object
+     * again is an indexed load. Caches are updated through const paths.
+     */
+    struct PropertyPath
+    {
+        uint32_t base = 0;                   // atom of the first part (New: of the class)
+        uint32_t owner = 0;                  // atom of every part but the last ("p.x" of "p.x.y")
+        std::vector<uint32_t> keys;          // atoms of the property names
+        std::vector<TS::InlineCache> caches; // one per key
+        TS::InlineCache method;              // calls: the class member the last key resolved to
+        const TS::Shape *shape = nullptr;    // Object and New: the shape objects are created with
+    };
+
+    using PropertyPathPtr = std::shared_ptr<const PropertyPath>;
+
+    /**
+     * Splits a dotted name into a property path.
+     *
+     * @param name E.g. "p.x.y".
+     * @returns The path, or nullptr if `name` has no dot.
+     */
+    PropertyPathPtr propertyPath(std::string_view name);
+
+    /**
+     * A pre-classified token of a compiled expression.
+     */
+    struct RpnToken
+    {
+        TokenKind kind = TokenKind::Literal;
+        OpCode op = OpCode::Add;
+        uint32_t argc = 0;
+        int32_t slot = -1;   // Variable and dotted Call: local slot of the name (of its first part) in the function frame, -1 for named lookup
+        uint32_t atom = 0;   // Call and Variable: TS::atom of `name`; Member and Method: of the key; New: of "name.constructor"
+        TS::Value value;
+        std::string name;
+        PropertyPathPtr path; // dotted Variable and Call names, and every Member, Object, New and Method
+    };
+
+    /**
+     * Sets the atom and property path of a token from its kind and name, as
+     * the compiler does (compiled artifacts keep only the names).
+     */
+    void linkToken(RpnToken &tok);
+
+    /**
+     * An expression compiled to reverse polish notation.
+     */
+    struct Expression
+    {
+        /**
+         * Tokens in evaluation order.
+         */
+        std::vector<RpnToken> code;
+
+        /**
+         * The source text the expression was compiled from.
+         */
+        std::string source;
+    };
+
+    using ExpressionPtr = std::shared_ptr<const Expression>;
+
+    /**
+     * @returns The type every evaluation of `expr` produces whatever its
+     * variables hold (e.g. `n - 1` is a Number, `a < b` a Boolean), or Any.
+     */
+    DeclaredType staticType(const Expression &expr);
+
+    /**
+     * The id of a function name (e.g. "Math.sin" or "add") in the callable
+     * registry: its atom, which the compiler stores on every call so the
+     * registry is indexed instead of hashed.
+     *
+     * @param name The callee name.
+     * @returns TS::atom(name).
+     */
+    inline uint32_t callableId(std::string_view name) { return TS::atom(name); }
+
+    /**
+     * Hit/miss counters of the compiled expression cache.
+     */
+    struct ExpressionCacheStats
+    {
+        uint64_t hits = 0;   // lookups served from the cache
+        uint64_t misses = 0; // lookups that had to tokenize and compile
+        size_t entries = 0;  // distinct expressions currently cached
+    };
+
+    /**
+     * A compiled block: the statements of a script or of a `{ ... }` body.
+     */
+    using Block = std::vector<Statement>;
+
+    /**
+     * Kinds of statements produced by the compile pass.
+     */
+    enum class StatementKind : uint8_t
+    {
+        Let,      // let name[: type] = expr;
+        Function, // function name(params) { ... }
+        If,       // if (cond) { ... } [else { ... }]
+        Class,    // class Name { constructor, methods, fields and static members }
+        Call,     // name(arg1, arg2, ...);
+        Return,   // return expr;
+        Assign,   // name = expr; (also op=, ++ and --, compiled to a plain assignment)
+        While,    // while (cond) { ... }
+        For,      // for (init; cond; update) { ... }
+        Break,    // break;
+        Continue, // continue;
+        Error     // statement that failed to parse, reported when executed
+    };
+
+    /**
+     * A single parsed statement.
+     * Source text is split, trimmed and stripped of `;` once at compile time,
+     * so executing a statement never re-scans the raw line.
+     */
+    struct Statement
+    {
+        StatementKind kind = StatementKind::Error;
+
+        /**
+         * 1-based line number of the statement in its source.
+         */
+        size_t line = 0;
+
+        /**
+         * Variable, function, class or callee name (depends on `kind`).
+         * For `Error` statements this holds the message to report.
+         */
+        std::string name;
+
+        /**
+         * Declared type of a `let` (e.g. "number"), empty when not annotated.
+         */
+        std::string type;
+
+        /**
+         * Local slot a `let` or assignment inside a function writes to, -1 for named variables.
+         * With a `path`, the local the first part of the name reads instead.
+         */
+        int32_t slot = -1;
+
+        /**
+         * TS::atom of `name` for calls, `let`s and assignments.
+         */
+        uint32_t atom = 0;
+
+        /**
+         * Property path of a dotted assignment or call (`p.x = 1;`, `p.move(1);`), null otherwise.
+         */
+        PropertyPathPtr path;
+
+        /**
+         * Right-hand side of a `let` or assignment, condition of an `if` or loop
+         * (null for an empty `for` condition), value of a `return`.
+         */
+        ExpressionPtr expr;
+
+        /**
+         * Element index of an assignment to `name[index]`, null for plain assignments.
+         */
+        ExpressionPtr index;
+
+        /**
+         * Argument expressions of a call statement.
+         */
+        std::vector<ExpressionPtr> args;
+
+        /**
+         * staticType of each of `args`: arguments already known to have the
+         * declared type of their parameter skip the call-time check.
+         */
+        std::vector<DeclaredType> argTypes;
+
+        /**
+         * Nested statements: `if` branch, loop body, or members of a `class`.
+         */
+        Block body;
+
+        /**
+         * `else` branch of an `if` (an `else if` is a single nested `If`).
+         */
+        Block elseBody;
+
+        /**
+         * Initializer of a `for` (at most one statement).
+         */
+        Block init;
+
+        /**
+         * Update of a `for`, run after each iteration (at most one statement).
+         */
+        Block update;
+
+        /**
+         * Compiled function for `Function` statements.
+         */
+        std::shared_ptr<FunctionDef> function;
+    };
+
+    /**
+     * Splits source text into lines without copying.
+     *
+     * @param source The loaded script text.
+     * @returns Views into `source`, one per line (without the '\n').
+     */
+    std::vector<std::string_view> splitLines(std::string_view source);
+
+    /**
+     * A read position over the lines of an already loaded script.
+     * The compiler pulls statement and block lines from the cursor, so a
+     * multi-line body is just a range of views into the loaded buffer.
+     * The lines (and the text they point to) must outlive the cursor.
+     */
+    class SourceCursor
+    {
+    public:
+        /**
+         * @param lines The source lines.
+         * @param firstLine Line number of `lines[0]`, used for diagnostics.
+         */
+        explicit SourceCursor(const std::vector<std::string_view> &lines, size_t firstLine = 1);
+
+        /**
+         * Advances to the next line.
+         *
+         * @param line Receives the line text.
+         * @param lineNo Receives its 1-based line number.
+         * @returns False once every line has been consumed.
+         */
+        bool next(std::string_view &line, size_t &lineNo);
+
+        /**
+         * @returns True when no lines are left.
+         */
+        bool atEnd() const { return pos >= count; }
+
+    private:
+        const std::string_view *lines;
+        size_t count;
+        size_t firstLine;
+        size_t pos = 0;
+    };
+
+    /**
+     * Compiles every remaining line of a cursor into a block of statements.
+     * Multi-line bodies (`function`, `if`/`else`, `class`) are read from the same cursor.
+     *
+     * @param source The cursor to read from.
+     * @returns The compiled statements.
+     */
+    Block compileScript(SourceCursor &source);
+
+    /**
+     * Compiles source lines into a block of statements.
+     *
+     * @param lines The source lines to compile.
+     * @param firstLine Line number of `lines[0]`, used for diagnostics.
+     * @returns The compiled statements.
+     */
+    Block compileScript(const std::vector<std::string> &lines, size_t firstLine = 1);
+
+    /**
+     * Compiles a whole loaded script.
+     *
+     * @param source The script text.
+     * @param firstLine Line number of the first line, used for diagnostics.
+     * @returns The compiled statements.
+     */
+    Block compileSource(std::string_view source, size_t firstLine = 1);
+
+    /**
+     * Compiles an expression to RPN, memoized by its text.
+     * Repeated conditions and right-hand sides skip tokenizing entirely.
+     * Thread-safe; the cache is shared by every runtime in the process.
+     *
+     * @param expr The expression source.
+     * @returns The shared compiled expression.
+     */
+    ExpressionPtr compileExpression(std::string_view expr);
+
+    /**
+     * @returns The current counters of the expression cache.
+     */
+    ExpressionCacheStats expressionCacheStats();
+
+    /**
+     * Drops every cached expression and resets the counters.
+     */
+    void clearExpressionCache();
+
+    /**
+     * Counts the net number of `{` minus `}` in a line, ignoring string literals.
+     *
+     * @param line The source line.
+     * @returns The brace balance of the line.
+     */
+    int braceBalance(std::string_view line);
+
+} // namespace Interpreter
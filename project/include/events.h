@@ -0,0 +1,153 @@
+#pragma once
+
+#include "ts.h"
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace OS
+{
+    class Poller;
+}
+
+namespace Interpreter
+{
+    struct Context;
+
+    /**
+     * The work a context has scheduled for later: timers (setTimeout,
+     * setInterval), microtasks (queueMicrotask) and streams read line by
+     * line as their input arrives (watchLines).
+     *
+     * Callbacks are user functions named by a string, called like a call
+     * statement with the arguments given when they were scheduled. They run
+     * one at a time on the thread running the context, so any number of
+     * waits share one thread: while nothing is due the loop blocks in a
+     * single OS::Poller wait for the next timer or input.
+     */
+    class EventLoop
+    {
+    public:
+        EventLoop();
+        ~EventLoop();
+
+        EventLoop(const EventLoop &) = delete;
+        EventLoop &operator=(const EventLoop &) = delete;
+
+        /**
+         * Schedules `callback(args...)` after `delayMs`, and then every
+         * `delayMs` (at least 1) if `repeat` is set.
+         *
+         * @returns The timer id, for clearTimer (never 0).
+         */
+        uint32_t setTimer(std::string callback, std::vector<TS::Value> args, uint64_t delayMs, bool repeat);
+
+        /**
+         * Cancels a timer; an interval may cancel itself from its callback.
+         *
+         * @returns False if there is no such timer (any more).
+         */
+        bool clearTimer(uint32_t id);
+
+        /**
+         * Queues `callback(args...)` to run as soon as the current callback
+         * (or the script itself) returns, before any timer or input.
+         */
+        void queueMicrotask(std::string callback, std::vector<TS::Value> args);
+
+        /**
+         * Opens a file, pipe, FIFO or device ("-" is standard input) and calls
+         * `callback(line)` for every line read from it, as it arrives. At the
+         * end of the stream the callback gets `undefined` and the watch ends.
+         *
+         * @returns The watch id, for unwatch, or 0 if the path cannot be opened.
+         */
+        uint32_t watchLines(const std::string &path, std::string callback);
+
+        /**
+         * Stops a watch and closes its stream.
+         *
+         * @returns False if there is no such watch (any more).
+         */
+        bool unwatch(uint32_t id);
+
+        /**
+         * Adds work for sources that are always ready (like a regular file):
+         * `step` runs once per pass, without the loop waiting in between,
+         * until it returns false.
+         */
+        void addJob(std::function<bool(Context &)> step);
+
+        /**
+         * @returns True while microtasks, timers, watches or jobs are left.
+         */
+        bool pending() const
+        {
+            return !timers.empty() || !watches.empty() || !microtasks.empty() || !jobs.empty();
+        }
+
+        /**
+         * Runs callbacks until nothing is pending: the microtasks first, then
+         * due timers, available input and jobs (each followed by the
+         * microtasks it queued), waiting for the next of them in between.
+         *
+         * @param ctx The context the callbacks run in (the owner of this loop).
+         */
+        void run(Context &ctx);
+
+    private:
+        struct Task
+        {
+            std::string callback;
+            std::vector<TS::Value> args;
+        };
+
+        struct Timer
+        {
+            Task task;
+            uint64_t intervalMs = 0; // 0 for a timeout
+        };
+
+        // A timer's next expiry; cleared timers are skipped when they come up
+        struct Expiry
+        {
+            uint64_t at = 0;
+            uint64_t sequence = 0; // equal times run in scheduling order
+            uint32_t id = 0;
+
+            bool operator>(const Expiry &other) const
+            {
+                return at != other.at ? at > other.at : sequence > other.sequence;
+            }
+        };
+
+        struct Watch
+        {
+            int stream = -1;
+            std::string callback;
+            std::string partial; // text after the last complete line
+        };
+
+        std::unordered_map<uint32_t, Timer> timers;
+        std::priority_queue<Expiry, std::vector<Expiry>, std::greater<Expiry>> expiries;
+        std::deque<Task> microtasks;
+        std::unordered_map<uint32_t, Watch> watches;
+        std::vector<std::function<bool(Context &)>> jobs;
+        std::unique_ptr<OS::Poller> poller; // created with the first watch
+        uint32_t nextId = 1;
+        uint64_t nextSequence = 0;
+
+        void schedule(uint32_t id, uint64_t at);
+        void call(Context &ctx, const Task &task);
+        void runMicrotasks(Context &ctx);
+        void runTimers(Context &ctx);
+        void runJobs(Context &ctx);
+        void readStream(Context &ctx, int stream);
+    };
+
+} // namespace Interpreter
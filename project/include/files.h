@@ -0,0 +1,54 @@
+#pragma once
+
+#include "os.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+namespace Interpreter
+{
+    /**
+     * The files a context's scripts have open (File.open), by handle.
+     * Handles are small numbers, never 0, and never reused by one context.
+     */
+    class FileTable
+    {
+    public:
+        /**
+         * Opens a file: mode "r" reads it (see OS::FileReader), "w" replaces
+         * it and "a" appends to it (see OS::FileWriter).
+         *
+         * @returns The handle, or 0 if the mode is unknown or the file cannot be opened.
+         */
+        uint32_t open(const std::string &path, const std::string &mode);
+
+        /**
+         * @returns The reader of a handle opened with "r", or nullptr.
+         */
+        OS::FileReader *reader(uint32_t handle);
+
+        /**
+         * @returns The writer of a handle opened with "w" or "a", or nullptr.
+         */
+        OS::FileWriter *writer(uint32_t handle);
+
+        /**
+         * Closes a handle, flushing what was written to it.
+         *
+         * @returns False if there is no such handle or a write failed.
+         */
+        bool close(uint32_t handle);
+
+    private:
+        struct OpenFile
+        {
+            std::unique_ptr<OS::FileReader> reader;
+            std::unique_ptr<OS::FileWriter> writer;
+        };
+
+        std::unordered_map<uint32_t, OpenFile> files;
+        uint32_t nextHandle = 1;
+    };
+
+} // namespace Interpreter
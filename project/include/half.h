@@ -1,47 +1,202 @@
 #pragma once
 #ifdef ADD_STD_HALF
+#include <cstddef>
 #include <cstdint>
 #include <cmath>
+#include <cstring>
+#if defined(__F16C__)
+#include <immintrin.h>
+#endif
+#if __cplusplus >= 202002L && __has_include(<bit>)
+#include <bit>
+#endif
+
+namespace half_detail
+{
+    // Reinterprets the bits of a value (std::bit_cast where available)
+    template <typename To, typename From>
+    inline To bitCast(const From &from)
+    {
+        static_assert(sizeof(To) == sizeof(From), "bitCast needs equally sized types");
+#if defined(__cpp_lib_bit_cast)
+        return std::bit_cast<To>(from);
+#else
+        To to;
+        std::memcpy(&to, &from, sizeof(To));
+        return to;
+#endif
+    }
+
+    // Split half -> float tables (8.5 KB instead of a 256 KB full table):
+    // floatBits = mantissa[offset[h >> 10] + (h & 0x3FF)] + exponent[h >> 10]
+    struct Tables
+    {
+        uint32_t mantissa[2048];
+        uint32_t exponent[64];
+        uint16_t offset[64];
+    };
+
+    constexpr uint32_t subnormalMantissa(uint32_t i)
+    {
+        uint32_t m = i << 13;
+        uint32_t e = 0;
+        while (!(m & 0x00800000u)) // normalize
+        {
+            e -= 0x00800000u;
+            m <<= 1;
+        }
+        m &= ~0x00800000u;
+        e += 0x38800000u;
+        return m | e;
+    }
+
+    constexpr Tables makeTables()
+    {
+        Tables t{};
+        t.mantissa[0] = 0;
+        for (uint32_t i = 1; i < 1024; ++i)
+            t.mantissa[i] = subnormalMantissa(i);
+        for (uint32_t i = 1024; i < 2048; ++i)
+            t.mantissa[i] = 0x38000000u + ((i - 1024) << 13);
+
+        t.exponent[0] = 0;
+        for (uint32_t i = 1; i < 31; ++i)
+            t.exponent[i] = i << 23;
+        t.exponent[31] = 0x47800000u; // Inf / NaN
+        t.exponent[32] = 0x80000000u; // -0 and negative subnormals
+        for (uint32_t i = 33; i < 63; ++i)
+            t.exponent[i] = 0x80000000u + ((i - 32) << 23);
+        t.exponent[63] = 0xC7800000u;
+
+        for (uint32_t i = 0; i < 64; ++i)
+            t.offset[i] = (i == 0 || i == 32) ? 0 : 1024;
+        return t;
+    }
+
+    inline constexpr Tables kTables = makeTables();
+
+    inline bool isNaN(uint16_t bits) { return (bits & 0x7FFF) > 0x7C00; }
+
+    // Integer that orders like the value; +0 and -0 share a key
+    inline int32_t orderKey(uint16_t bits)
+    {
+        return (bits & 0x8000) ? -static_cast<int32_t>(bits & 0x7FFF) : static_cast<int32_t>(bits);
+    }
+} // namespace half_detail
 
 class half
 {
 public:
     uint16_t bits;
+    // Single conversions (round to nearest even; F16C or __fp16 when the target has them)
     static inline uint16_t float_to_half(float f);
     static inline float half_to_float(uint16_t h);
-    half();        // default constructor
-    half(float f); // construct from float
-    half::half(double f);
-    operator float() const; // convert to float
+
+    // Batch conversions of n values (F16C or NEON when the target has them)
+    static void toFloats(const half *in, float *out, size_t n);
+    static void fromFloats(const float *in, half *out, size_t n);
+
+    half() : bits(0) {}                                                  // default constructor
+    half(float f) : bits(float_to_half(f)) {}                            // construct from float
+    half(double f) : bits(float_to_half(static_cast<float>(f))) {}       // construct from double
+    operator float() const { return half_to_float(bits); }               // convert to float
 
     // Arithmetic operators
-    half operator+(const half &other) const;
-    half operator-(const half &other) const;
-    half operator*(const half &other) const;
-    half operator/(const half &other) const;
-    half operator%(const half &b) const;
-
-    // Comparison operators
-    bool operator==(const half &other) const;
-    bool operator!=(const half &other) const;
-    bool operator<(const half &other) const;
-    bool operator>(const half &other) const;
-    bool operator<=(const half &other) const;
-    bool operator>=(const half &other) const;
+    // float holds every half exactly and is wide enough that rounding its
+    // result back once gives the correctly rounded half result.
+    half operator+(const half &other) const { return half(half_to_float(bits) + half_to_float(other.bits)); }
+    half operator-(const half &other) const { return half(half_to_float(bits) - half_to_float(other.bits)); }
+    half operator*(const half &other) const { return half(half_to_float(bits) * half_to_float(other.bits)); }
+    half operator/(const half &other) const { return half(half_to_float(bits) / half_to_float(other.bits)); }
+    half operator%(const half &b) const { return half(std::fmod(half_to_float(bits), half_to_float(b.bits))); }
+    half operator-() const { return fromBits(bits ^ 0x8000); } // exact: flips the sign
+
+    // Comparison operators (exact, on the bits)
+    bool operator==(const half &other) const
+    {
+        return !half_detail::isNaN(bits) && !half_detail::isNaN(other.bits) &&
+               half_detail::orderKey(bits) == half_detail::orderKey(other.bits);
+    }
+    bool operator!=(const half &other) const { return !(*this == other); }
+    bool operator<(const half &other) const
+    {
+        return !half_detail::isNaN(bits) && !half_detail::isNaN(other.bits) &&
+               half_detail::orderKey(bits) < half_detail::orderKey(other.bits);
+    }
+    bool operator>(const half &other) const { return other < *this; }
+    bool operator<=(const half &other) const { return *this < other || *this == other; }
+    bool operator>=(const half &other) const { return other < *this || *this == other; }
+
+    static half fromBits(uint16_t b)
+    {
+        half h;
+        h.bits = b;
+        return h;
+    }
 };
 
+inline uint16_t half::float_to_half(float f)
+{
+#if defined(__F16C__)
+    return static_cast<uint16_t>(_cvtss_sh(f, _MM_FROUND_TO_NEAREST_INT));
+#elif defined(__ARM_FP16_FORMAT_IEEE)
+    return half_detail::bitCast<uint16_t>(static_cast<__fp16>(f));
+#else
+    // Branch-light round to nearest even
+    constexpr uint32_t f32Infinity = 255u << 23;
+    constexpr uint32_t f16Overflow = (127u + 16u) << 23;              // first float above the half range
+    constexpr uint32_t subnormalMagic = ((127u - 15u) + (23u - 10u) + 1u) << 23;
+
+    uint32_t x = half_detail::bitCast<uint32_t>(f);
+    uint32_t sign = x & 0x80000000u;
+    x ^= sign;
+
+    uint16_t out;
+    if (x >= f16Overflow)
+        out = x > f32Infinity ? 0x7E00 : 0x7C00; // NaN stays NaN, everything else is Inf
+    else if (x < (113u << 23))
+    {
+        // Subnormal or zero: the float addition aligns and rounds the mantissa
+        float aligned = half_detail::bitCast<float>(x) + half_detail::bitCast<float>(subnormalMagic);
+        out = static_cast<uint16_t>(half_detail::bitCast<uint32_t>(aligned) - subnormalMagic);
+    }
+    else
+    {
+        uint32_t mantissaOdd = (x >> 13) & 1;
+        x += (static_cast<uint32_t>(15 - 127) << 23) + 0xFFF; // rebias, round half up...
+        x += mantissaOdd;                                     // ...or to even on a tie
+        out = static_cast<uint16_t>(x >> 13);
+    }
+    return static_cast<uint16_t>(out | (sign >> 16));
+#endif
+}
+
+inline float half::half_to_float(uint16_t h)
+{
+#if defined(__F16C__)
+    return _cvtsh_ss(h);
+#elif defined(__ARM_FP16_FORMAT_IEEE)
+    return static_cast<float>(half_detail::bitCast<__fp16>(h));
+#else
+    const half_detail::Tables &t = half_detail::kTables;
+    uint32_t index = h >> 10;
+    return half_detail::bitCast<float>(t.mantissa[t.offset[index] + (h & 0x3FF)] + t.exponent[index]);
+#endif
+}
+
 // Math overloads in global namespace
-inline half sqrt(const half &h);
-inline half abs(const half &h);
-inline half sin(const half &h);
-inline half cos(const half &h);
-inline half tan(const half &h);
-inline half exp(const half &h);
-inline half log(const half &h);
-inline half floor(const half &h);
-inline half ceil(const half &h);
-inline half round(const half &h);
-inline half fmod(const half &a, const half &b);
+// Rounding functions and abs are exact; the others round the float result once.
+inline half sqrt(const half &h) { return half(std::sqrt(float(h))); }
+inline half abs(const half &h) { return half::fromBits(h.bits & 0x7FFF); }
+inline half sin(const half &h) { return half(std::sin(float(h))); }
+inline half cos(const half &h) { return half(std::cos(float(h))); }
+inline half tan(const half &h) { return half(std::tan(float(h))); }
+inline half exp(const half &h) { return half(std::exp(float(h))); }
+inline half log(const half &h) { return half(std::log(float(h))); }
+inline half floor(const half &h) { return half(std::floor(float(h))); }
+inline half ceil(const half &h) { return half(std::ceil(float(h))); }
+inline half round(const half &h) { return half(std::round(float(h))); }
+inline half fmod(const half &a, const half &b) { return half(std::fmod(float(a), float(b))); }
 
 // half vs int
 inline bool operator==(const half &h, int i) { return float(h) == static_cast<float>(i); }
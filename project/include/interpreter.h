@@ -1,31 +1,111 @@
 #pragma once
 
 #include "ts.h"
+#include "arena.h"
+#include "compiler.h"
+#include "events.h"
+#include "files.h"
+#include "os.h"
+#include "profiler.h"
 #include <string>
+#include <string_view>
+#include <cstdint>
 #include <functional>
+#include <memory>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 namespace Interpreter
 {
+    struct Context;
+
+    /**
+     * Read-only view of the arguments of a call.
+     * Points straight into the caller's value stack (or argument vector), so
+     * calling a builtin does not copy its arguments. Offers the parts of
+     * std::vector builtins use: size(), empty(), [] and iteration.
+     * Also carries the calling context, so builtins that need per-runtime
+     * state (output, random numbers, variables) need not capture one.
+     */
+    class Args
+    {
+    public:
+        Args() = default;
+        Args(const TS::Value *data, size_t count, Context *context = nullptr) : first(data), count(count), caller(context) {}
+        Args(const std::vector<TS::Value> &values) : first(values.data()), count(values.size()) {}
+        Args(const std::pmr::vector<TS::Value> &values, Context *context = nullptr)
+            : first(values.data()), count(values.size()), caller(context) {}
+
+        inline size_t size() const { return count; }
+        inline bool empty() const { return count == 0; }
+        inline const TS::Value &operator[](size_t i) const { return first[i]; }
+        inline const TS::Value *begin() const { return first; }
+        inline const TS::Value *end() const { return first + count; }
+
+        /**
+         * @returns The context the call runs in, or nullptr for context-free evaluation.
+         */
+        inline Context *context() const { return caller; }
+
+    private:
+        const TS::Value *first = nullptr;
+        size_t count = 0;
+        Context *caller = nullptr;
+    };
+
     /**
      * Function signature for built-in or user-defined functions.
-     * Functions take a vector of TS::Value arguments and return a TS::Value.
+     * Functions take a view of their TS::Value arguments and return a TS::Value.
      */
-    using Function = std::function<TS::Value(const std::vector<TS::Value> &)>;
+    using Function = std::function<TS::Value(Args)>;
+
+    /**
+     * Direct calling conventions for builtins of a fixed arity (e.g. Math.sin, Math.pow).
+     * Expressions calling them with exactly that many arguments skip the
+     * std::function and pass the operands in place.
+     */
+    using Native1 = TS::Value (*)(const TS::Value &);
+    using Native2 = TS::Value (*)(const TS::Value &, const TS::Value &);
 
 // Registers a built-in function in ctx.builtins with a given name
 // Usage: __BUILTIN("Math.sign") { /* body */ }
-#define __BUILTIN(NAME) ctx.builtins[NAME] = [](const std::vector<TS::Value> &args) -> TS::Value
+#define __BUILTIN(NAME) ctx.builtins[NAME].fn = [](Interpreter::Args args) -> TS::Value
+
+// Registers a built-in that uses the calling context, reached through args.context()
+// (builtins never capture a context: the standard library is shared by all of them)
+#define __BUILTIN2(NAME) ctx.builtins[NAME].fn = [](Interpreter::Args args) -> TS::Value
 
-#define __BUILTIN2(NAME) ctx.builtins[NAME] = [&ctx](const std::vector<TS::Value> &args) -> TS::Value
+// Registers a fixed-arity built-in taking its arguments as `a` (and `b`)
+// Usage: __BUILTIN_1("Math.sin") { return TS::Value(std::sin(a.toNumber())); }
+#define __BUILTIN_1(NAME) ctx.builtins[NAME].fn1 = [](const TS::Value &a) -> TS::Value
 
-// Quick-eval macro for expressions in the current context , lacks user functions to be used.also ho
-#define QEVAL(EXPR) evalSimpleExpression((EXPR), ctx.variables, ctx.builtins)
+#define __BUILTIN_2(NAME) ctx.builtins[NAME].fn2 = [](const TS::Value &a, const TS::Value &b) -> TS::Value
+
+// Quick-eval macro for expressions in the current context (builtins and user functions)
+#define QEVAL(EXPR) evalSimpleExpression((EXPR), ctx.variables, ctx)
 
 // any type
 #define any std::any
 
+    struct Bytecode;
+
+    /**
+     * Calls after which a user function is compiled to bytecode (see vm.h).
+     */
+    constexpr uint32_t kHotCallThreshold = 16;
+
+    /**
+     * How a user function is run in one context: interpreted until it has
+     * been called Context::hotCallThreshold times, then as bytecode.
+     */
+    struct FunctionTier
+    {
+        uint32_t calls = 0;                   // calls so far while interpreted
+        bool unsupported = false;             // the body has no bytecode form: stay interpreted
+        std::shared_ptr<const Bytecode> code; // set once the function turned hot
+    };
+
     /**
      * Represents a user-defined function definition.
      */
@@ -43,9 +123,91 @@ namespace Interpreter
         std::vector<std::string> paramTypes;
 
         /**
-         * The body of the function, stored as a list of source code lines.
+         * `paramTypes` resolved when the definition is compiled (see declaredType).
          */
-        std::vector<std::string> bodyLines;
+        std::vector<DeclaredType> declaredTypes;
+
+        /**
+         * The body of the function, compiled once when the definition is parsed.
+         * Parameters and `let` locals are resolved to frame slots.
+         */
+        Block body;
+
+        /**
+         * Number of frame slots: parameters first (in order), then locals.
+         */
+        uint32_t slotCount = 0;
+
+        /**
+         * Execution tier. Only the copies in Context::userFunctions are ever
+         * called, so each context tiers up its own definitions.
+         */
+        mutable FunctionTier tier;
+    };
+
+    /**
+     * An entry of the callable registry: a builtin or a user function.
+     */
+    struct Callable
+    {
+        /**
+         * Implementation invoked by expressions. For user functions this is a
+         * wrapper created once, when the definition is added. For fixed-arity
+         * builtins it is generated from fn1/fn2 when the builtin is published.
+         */
+        Function fn;
+
+        /**
+         * Direct entry points used when a call passes exactly one (fn1) or two
+         * (fn2) arguments; nullptr when the builtin has no fixed arity.
+         */
+        Native1 fn1 = nullptr;
+        Native2 fn2 = nullptr;
+
+        /**
+         * The user function definition, or nullptr for builtins.
+         * Points into Context::userFunctions.
+         */
+        const FunctionDef *user = nullptr;
+    };
+
+    /**
+     * Callable lookup shared by builtins and user functions.
+     * Entries are indexed by callableId, which the compiler stores on every
+     * call, so executing a call is an array index rather than a hash lookup.
+     */
+    class CallableRegistry
+    {
+    public:
+        /**
+         * @returns The callable with the given id, or nullptr if none is defined.
+         */
+        inline const Callable *find(uint32_t id) const
+        {
+            if (id < entries.size() && entries[id].fn)
+                return &entries[id];
+            return shared ? shared->find(id) : nullptr;
+        }
+
+        /**
+         * @returns The callable with the given name, or nullptr if none is defined.
+         */
+        inline const Callable *find(std::string_view name) const { return find(callableId(name)); }
+
+        /**
+         * Adds or replaces the callable named `name`.
+         */
+        void set(std::string_view name, Callable callable);
+
+        /**
+         * Falls back to `base` (which must outlive this registry) for ids not
+         * set here; init links every context to the shared standard library.
+         */
+        inline void setShared(const CallableRegistry *base) { shared = base; }
+
+    private:
+        std::vector<Callable> entries;
+        const CallableRegistry *shared = nullptr;
     };
 
     /**
@@ -59,40 +221,199 @@ namespace Interpreter
         TS::Environment variables;
 
         /**
-         * Map of built-in functions available in the current context.
+         * Builtins registered on this context only (registerBuiltin). The standard
+         * library is built once per process and shared read-only by every context
+         * through `callables`.
          */
-        std::unordered_map<std::string, Function> builtins;
+        std::unordered_map<std::string, Callable> builtins;
 
         /**
          * Map of user-defined functions available in the current context.
          */
         std::unordered_map<std::string, FunctionDef> userFunctions;
+
+        /**
+         * Every callable name (builtins and user functions) resolved through one lookup.
+         * Kept up to date by init, registerBuiltin and defineFunction instead of
+         * being rebuilt per statement.
+         */
+        CallableRegistry callables;
+
+        /**
+         * Paths of the modules `require` has loaded (or is loading) into this context.
+         */
+        std::unordered_set<std::string> modules;
+
+        /**
+         * Arena for evaluation temporaries (value stacks, call arguments, large
+         * frames), rewound as each expression and call completes.
+         * Its chunks come from std::pmr::get_default_resource(); embedders plug
+         * in their own memory with scratch.setUpstream(resource) before running code.
+         */
+        TS::Arena scratch;
+
+        /**
+         * Type check files and modules before executing them (turned off by --no-check).
+         */
+        bool typeCheck = true;
+
+        /**
+         * Where console.log and runtime errors are written and interactive input
+         * is read from. Must outlive the context.
+         */
+        OS::Console *console = &OS::standardConsole();
+
+        /**
+         * State of Math.random (splitmix64). Every context starts from the same
+         * seed, so runs are reproducible unless seeded (see seedRandom).
+         */
+        uint64_t randomState = 0x853C49E6748FEA9Bull;
+
+        /**
+         * Calls after which a user function runs as bytecode; 0 keeps every
+         * function in the tree-walking interpreter.
+         */
+        uint32_t hotCallThreshold = kHotCallThreshold;
+
+        /**
+         * Timers, microtasks and watched streams the scripts scheduled (see
+         * events.h), run by Setup::Runtime once the script itself returns.
+         */
+        EventLoop events;
+
+        /**
+         * Files the scripts opened with File.open.
+         */
+        FileTable files;
+
+        /**
+         * Receives frames, statements and allocations while attached (--profile);
+         * nullptr (the default) disables profiling. Must outlive its use here.
+         */
+        Profiler *profiler = nullptr;
     };
 
     /**
      * Evaluates a simple expression string and returns its value.
      * Supports literals, variables, operators, and function calls.
+     * The compiled form is cached by expression text (see compileExpression).
      *
      * @param expr The expression to evaluate.
      * @param env The variable environment to use for lookups.
-     * @param builtins Map of callable built-in functions.
+     * @param ctx The context providing callables, scratch memory and output.
      * @returns The evaluated TS::Value result.
      */
     TS::Value evalSimpleExpression(
         const std::string &expr,
         TS::Environment &env,
-        const std::unordered_map<std::string, std::function<TS::Value(const std::vector<TS::Value> &)>> &builtins);
+        Context &ctx);
+
+    /**
+     * Evaluates a simple expression string without a context.
+     * Builtins that need one (console.log, Math.random, assert, typeofVar,
+     * require) see none: console.log writes to OS::standardConsole() and the
+     * others return undefined.
+     */
+    TS::Value evalSimpleExpression(
+        const std::string &expr,
+        TS::Environment &env,
+        const CallableRegistry &callables);
+
+    /**
+     * Evaluates an already compiled expression.
+     * This is the hot path used by executing statements; no tokenizing happens here.
+     *
+     * @param expr The compiled expression (see compileExpression).
+     * @param env The variable environment to use for lookups.
+     * @param ctx The context providing callables, scratch memory (for the
+     * value stack, rewound before returning) and output.
+     * @returns The evaluated TS::Value result.
+     */
+    TS::Value evalExpression(
+        const Expression &expr,
+        TS::Environment &env,
+        Context &ctx);
+
+    /**
+     * Evaluates an already compiled expression without a context (see
+     * evalSimpleExpression), with the value stack in a small stack buffer
+     * (spilling to the default resource).
+     */
+    TS::Value evalExpression(
+        const Expression &expr,
+        TS::Environment &env,
+        const CallableRegistry &callables);
+
+    /**
+     * Applies a binary operator of compiled expressions.
+     */
+    TS::Value applyOpVal(OpCode op, const TS::Value &a, const TS::Value &b);
+
+    /**
+     * Applies a unary operator of compiled expressions.
+     */
+    TS::Value applyUnaryOpVal(OpCode op, const TS::Value &a);
+
+    /**
+     * @returns The value of a constant init defines (NaN, undefined, Math.PI,
+     * Math.E, Math.EPSILON), or nullptr if `name` is not one of them.
+     */
+    const TS::Value *standardConstant(std::string_view name);
+
+    /**
+     * Looks up a function of the standard library, ignoring builtins a host
+     * registered and user functions.
+     *
+     * @returns The function, or nullptr if the library has no `name`.
+     */
+    const Callable *standardBuiltin(std::string_view name);
+
+    /**
+     * @returns True if the standard library function `name` has no side
+     * effects and its result only depends on its arguments (Math.sqrt, but
+     * not Math.random or console.log).
+     */
+    bool isPureBuiltin(std::string_view name);
 
     /**
      * Initializes the interpreter context.
-     * Registers built-in functions and prepares the environment.
+     * Defines the global constants and links the context to the standard
+     * library, which is built on first use and shared by every context.
      *
      * @param ctx The context to initialize.
      */
     void init(Context &ctx);
 
+    /**
+     * Seeds Math.random for one context.
+     *
+     * @param ctx The context to seed.
+     * @param seed Any value; equal seeds give equal sequences.
+     */
+    void seedRandom(Context &ctx, uint64_t seed);
+
+    /**
+     * Registers (or replaces) a built-in function after init.
+     *
+     * @param ctx The context to register into.
+     * @param name The name scripts call the function by.
+     * @param fn The implementation.
+     */
+    void registerBuiltin(Context &ctx, const std::string &name, Function fn);
+
+    /**
+     * Adds (or replaces) a user-defined function and its registry entry.
+     *
+     * @param ctx The context to define the function in.
+     * @param name The function name (e.g. "add" or "ClassName.method").
+     * @param def The compiled definition.
+     */
+    void defineFunction(Context &ctx, const std::string &name, const FunctionDef &def);
+
     /**
      * Executes a single line of code in the given context.
+     * A block left open by the line is completed from OS::readLine, so this is
+     * meant for interactive input; scripts should use executeSource.
      *
      * @param line The source code line to execute.
      * @param ctx The execution context.
@@ -107,4 +428,29 @@ namespace Interpreter
      */
     void executeScript(const std::vector<std::string> &lines, Context &ctx);
 
+    /**
+     * Executes an indexed script (e.g. OS::SourceFile::lines()) in the given context.
+     *
+     * @param lines Views of the script lines; they only need to live until the call returns.
+     * @param ctx The execution context.
+     */
+    void executeScript(const std::vector<std::string_view> &lines, Context &ctx);
+
+    /**
+     * Executes a loaded script in the given context.
+     * Blocks are collected from `source` itself, without copying lines.
+     *
+     * @param source The full script text.
+     * @param ctx The execution context.
+     */
+    void executeSource(std::string_view source, Context &ctx);
+
+    /**
+     * Executes an already compiled block of statements in the given context.
+     *
+     * @param block The statements to execute.
+     * @param ctx The execution context.
+     */
+    void executeBlock(const Block &block, Context &ctx);
+
 } // namespace Interpreter
\ No newline at end of file
@@ -1,6 +1,8 @@
 #pragma once
 #include "os.h"
+#include <charconv>
 #include <string>
+#include <string_view>
 #include <type_traits>
 
 namespace std
@@ -9,43 +11,40 @@ namespace std
     class ostream_2
     {
     public:
-        // Generic template for most types
+        // Generic template for most types, written straight to the OS output buffer
         template <typename T>
         ostream_2 &operator<<(const T &value)
         {
-            OS::print(toString(value));
-            return *this;
-        }
-
-        // Overload for manipulators like endl
-        using Manipulator = ostream_2 &(*)(ostream_2 &);
-        ostream_2 &operator<<(Manipulator manip)
-        {
-            return manip(*this);
-        }
-
-    private:
-        // Convert to string for printing
-        template <typename T>
-        static std::string toString(const T &value)
-        {
-            if constexpr (std::is_same_v<T, std::string>)
+            if constexpr (std::is_convertible_v<const T &, std::string_view>)
+            {
+                OS::write(std::string_view(value));
+            }
+            else if constexpr (std::is_same_v<T, char>)
             {
-                return value;
+                OS::write(&value, 1);
             }
-            else if constexpr (std::is_same_v<T, const char *>)
+            else if constexpr (std::is_same_v<T, bool>)
             {
-                return std::string(value);
+                OS::write(value ? "1" : "0", 1);
             }
             else if constexpr (std::is_arithmetic_v<T>)
             {
-                return std::to_string(value);
+                char buffer[64];
+                auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+                OS::write(buffer, static_cast<size_t>(result.ptr - buffer));
             }
             else
             {
-                // Fallback: try to_string if available
-                return "[unsupported type]";
+                OS::write("[unsupported type]");
             }
+            return *this;
+        }
+
+        // Overload for manipulators like endl
+        using Manipulator = ostream_2 &(*)(ostream_2 &);
+        ostream_2 &operator<<(Manipulator manip)
+        {
+            return manip(*this);
         }
     };
 
@@ -64,9 +63,10 @@ namespace std
     {
     public:
         template <typename T>
-        istream &operator>>(T &value)
+        istream_2 &operator>>(T &value)
         {
-            std::string line = OS::readLine();
+            std::string line;
+            OS::readLine(line);
             if constexpr (std::is_same_v<T, std::string>)
             {
                 value = line;
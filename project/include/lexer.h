@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace TS
+{
+    /**
+     * @enum TokenType
+     * @short Classification of a lexed token.
+     */
+    enum class TokenType : uint8_t
+    {
+        Identifier, // name, keyword or dotted path (e.g. "Math.sin")
+        Number,     // numeric literal, including exponents (e.g. "2.5e-3")
+        String,     // quoted literal including its quotes and escapes
+        Operator,   // operator or punctuation (e.g. "===", "(", ",")
+        End         // end of input
+    };
+
+    /**
+     * @struct Token
+     * @short A token of source text.
+     * `text` is a view into the lexed source; nothing is copied.
+     */
+    struct Token
+    {
+        TokenType type = TokenType::End;
+        std::string_view text;
+        uint32_t line = 0; // 1-based line the token starts on
+
+        inline bool is(std::string_view op) const { return type == TokenType::Operator && text == op; }
+    };
+
+    /**
+     * @class Lexer
+     * @short Splits source text into tokens, skipping whitespace and `//` comments.
+     * Shared by the type checker (whole files) and the expression compiler.
+     */
+    class Lexer
+    {
+    public:
+        explicit Lexer(std::string_view source, uint32_t firstLine = 1)
+            : source(source), line(firstLine) {}
+
+        /**
+         * @returns The next token, or an `End` token once the input is exhausted.
+         */
+        Token next();
+
+    private:
+        std::string_view source;
+        size_t pos = 0;
+        uint32_t line;
+    };
+
+    /**
+     * @fn
+     * @short Lexes a whole source text.
+     * @returns Every token of `source` (without the trailing `End`).
+     */
+    std::vector<Token> lex(std::string_view source, uint32_t firstLine = 1);
+
+} // namespace TS
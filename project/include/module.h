@@ -0,0 +1,150 @@
+#pragma once
+
+#include "interpreter.h"
+#include "os.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace Interpreter
+{
+    /**
+     * Identifies the exact source a compiled artifact was built from.
+     */
+    struct SourceStamp
+    {
+        uint64_t size = 0;  // source length in bytes
+        uint64_t mtime = 0; // OS::fileModifiedTime of the source
+        uint64_t hash = 0;  // hashSource of the source text
+    };
+
+    /**
+     * Hashes script text (64-bit FNV-1a).
+     *
+     * @param text The source text.
+     * @returns The hash.
+     */
+    uint64_t hashSource(std::string_view text);
+
+    /**
+     * @param sourcePath Path of a script, e.g. "lib/util.ts".
+     * @returns Path of its precompiled artifact, e.g. "lib/util.tsc".
+     */
+    std::string compiledPath(const std::string &sourcePath);
+
+    /**
+     * @param sourcePath Path of a script, e.g. "lib/util.ts".
+     * @returns Path of its cached type check results, e.g. "lib/util.tscheck".
+     */
+    std::string checkedPath(const std::string &sourcePath);
+
+    /**
+     * Serializes a compiled block to disk.
+     *
+     * @param path Artifact path (see compiledPath).
+     * @param stamp The source the block was compiled from.
+     * @param block The compiled statements.
+     * @returns True if the artifact was written.
+     */
+    bool writeCompiled(const std::string &path, const SourceStamp &stamp, const Block &block);
+
+    /**
+     * Loads a compiled block from disk.
+     * The artifact is rejected when it was written by an incompatible build or
+     * for other source: the sizes must match, and either the mtimes or the
+     * content hashes must match.
+     *
+     * @param path Artifact path (see compiledPath).
+     * @param source The current source file.
+     * @param stamp Stamp of `source`; `hash` is filled in if it had to be computed.
+     * @param out Receives the statements.
+     * @returns True if a valid artifact was loaded.
+     */
+    bool readCompiled(const std::string &path, const OS::SourceFile &source, SourceStamp &stamp, Block &out);
+
+    /**
+     * Compiles a script file, reusing its precompiled artifact when it is current
+     * and refreshing the artifact otherwise.
+     *
+     * @param path Path of the script.
+     * @param source The opened script.
+     * @returns The compiled statements.
+     */
+    Block compileFile(const std::string &path, const OS::SourceFile &source);
+
+    /**
+     * Compiled statements shared between runtimes (immutable once built).
+     */
+    using ModulePtr = std::shared_ptr<const Block>;
+
+    /**
+     * Compiles a script file once per process (see compileFile) and shares the
+     * result: loading an unchanged file again, from any runtime or thread,
+     * returns the same statements without touching its artifact.
+     *
+     * @param path Path of the script.
+     * @param source The opened script.
+     * @returns The compiled statements.
+     */
+    ModulePtr loadModule(const std::string &path, const OS::SourceFile &source);
+
+#ifndef SKIP_TYPECHECK
+    /**
+     * Type checks a script, reusing the results cached next to it (see checkedPath)
+     * while the source is unchanged, and refreshing the cache otherwise.
+     *
+     * @param path Path of the script.
+     * @param source The opened script.
+     * @returns The errors and the function signature table of the script.
+     */
+    TS::TypeCheckResult checkFile(const std::string &path, const OS::SourceFile &source);
+#endif
+
+    /**
+     * Runs the pre-execution type check unless it is disabled (ctx.typeCheck or
+     * SKIP_TYPECHECK) and prints any errors.
+     *
+     * @param ctx The execution context.
+     * @param path Path of the script.
+     * @param source The opened script.
+     * @returns True if the script may be executed.
+     */
+    bool passesTypeCheck(const Context &ctx, const std::string &path, const OS::SourceFile &source);
+
+    /**
+     * Saves the state scripts built up in a context: its variables, user
+     * functions (compiled) and the modules it loaded, with the stamps of their
+     * sources. Builtins registered on the context are not saved.
+     *
+     * @param path Snapshot path.
+     * @param ctx The context, usually after running a prelude.
+     * @returns True if the snapshot was written.
+     */
+    bool writeSnapshot(const std::string &path, const Context &ctx);
+
+    /**
+     * Restores a snapshot (see writeSnapshot) into an initialized context,
+     * reading it in place from a single mapping of the file: no module is
+     * parsed or executed again, and `require` of a saved module is a no-op.
+     * The snapshot is rejected as a whole when it was written by an
+     * incompatible build or one of its modules changed since.
+     *
+     * @param path Snapshot path.
+     * @param ctx The context, changed only if the snapshot is valid.
+     * @returns True if the snapshot was restored.
+     */
+    bool readSnapshot(const std::string &path, Context &ctx);
+
+    /**
+     * Loads and executes a module once per context.
+     * The module is type checked first (see passesTypeCheck). Later calls
+     * (and cyclic requires) for the same path are no-ops.
+     *
+     * @param ctx The execution context.
+     * @param path Path of the module script.
+     * @returns False if the module could not be opened or failed the type check.
+     */
+    bool requireModule(Context &ctx, const std::string &path);
+
+} // namespace Interpreter
@@ -0,0 +1,134 @@
+// objects.h
+#pragma once
+
+#include "ts.h"
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+namespace TS
+{
+    /**
+     * Class of objects created by object literals rather than `new`.
+     */
+    constexpr uint32_t kNoClass = UINT32_MAX;
+
+    /**
+     * @struct
+     * @short Hidden class of an object: which property lives in which slot.
+     * Objects built the same way (by one constructor, or one object literal)
+     * add their properties in the same order, so they end up sharing a shape:
+     * each added property takes the transition from the current shape to the
+     * one with that property appended. Shapes are process-wide, immutable
+     * and never freed, so a shape pointer or id can be cached anywhere.
+     */
+    struct Shape
+    {
+        uint32_t id = 0;              // never 0
+        uint32_t classAtom = kNoClass; // atom of the class of instances, kNoClass for object literals
+        std::vector<uint32_t> keys;   // property atoms in slot order
+
+        /**
+         * @returns The slot of `key`, or -1 if objects of this shape have no such property.
+         */
+        int32_t slotOf(uint32_t key) const;
+
+        /**
+         * @returns The shape of an object of this shape after adding `key`
+         * (this shape if it has it already). Thread-safe.
+         */
+        const Shape *with(uint32_t key) const;
+
+        /**
+         * @returns The shape of objects without properties: new instances of
+         * class `classAtom`, or object literals (kNoClass). Thread-safe.
+         */
+        static const Shape *root(uint32_t classAtom = kNoClass);
+
+        Shape() = default;
+        Shape(const Shape &) = delete;
+        Shape &operator=(const Shape &) = delete;
+
+    private:
+        mutable std::atomic<const Shape *> recent{nullptr}; // the transition `with` took last
+    };
+
+    /**
+     * @class
+     * @short Monomorphic inline cache of a property access.
+     * Remembers one shape and what the access found for it (e.g. the slot
+     * of the property), packed in one word so threads sharing a compiled
+     * expression read and update it without locks. A miss only costs the
+     * lookup the cache saves.
+     */
+    class InlineCache
+    {
+    public:
+        InlineCache() = default;
+        InlineCache(const InlineCache &other) : entry(other.entry.load(std::memory_order_relaxed)) {}
+        InlineCache &operator=(const InlineCache &other)
+        {
+            entry.store(other.entry.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            return *this;
+        }
+
+        /**
+         * @returns True, with the cached data in `out`, if the cache holds `shape`.
+         */
+        inline bool lookup(const Shape *shape, uint32_t &out) const
+        {
+            uint64_t cached = entry.load(std::memory_order_relaxed);
+            if (static_cast<uint32_t>(cached >> 32) != shape->id)
+                return false;
+            out = static_cast<uint32_t>(cached);
+            return true;
+        }
+
+        inline void update(const Shape *shape, uint32_t data) const
+        {
+            entry.store(static_cast<uint64_t>(shape->id) << 32 | data, std::memory_order_relaxed);
+        }
+
+    private:
+        mutable std::atomic<uint64_t> entry{0}; // shape id << 32 | data; shape ids are never 0
+    };
+
+    /**
+     * @fn
+     * @short Finds property `key` of an object.
+     * @returns The value of the property, or nullptr if `object` is not an
+     * object or has no such property.
+     */
+    inline Value *findProperty(const Value &object, uint32_t key, const InlineCache &cache)
+    {
+        if (object.type != ValueType::Object)
+            return nullptr;
+        ObjectData &data = object.asObject();
+        uint32_t slot;
+        if (!cache.lookup(data.shape, slot))
+        {
+            int32_t found = data.shape->slotOf(key);
+            if (found < 0)
+                return nullptr;
+            slot = static_cast<uint32_t>(found);
+            cache.update(data.shape, slot);
+        }
+        return &data.slots[slot];
+    }
+
+    /**
+     * @fn
+     * @short Sets property `key` of an object, adding it if it is new.
+     * @returns False if `object` is not an object.
+     */
+    bool setProperty(const Value &object, uint32_t key, const Value &value, const InlineCache &cache);
+
+    /**
+     * @fn
+     * @short Resolves method `key` of an instance to the class member
+     * implementing it: "ClassName.key".
+     * @returns False if `object` is not an instance of a class.
+     */
+    bool findMethod(const Value &object, uint32_t key, const InlineCache &cache, uint32_t &outAtom);
+
+} // namespace TS
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "compiler.h"
+
+namespace Interpreter
+{
+    /**
+     * Load-time optimization of a compiled unit (a script, module or
+     * interactive line), run by compileScript before anything executes:
+     *
+     * - Constant subexpressions are folded to literals: operators on literals,
+     *   pure standard library functions (see isPureBuiltin) on literals, and
+     *   the constants init defines, unless the unit assigns or redefines them.
+     * - A top-level `let` of a constant that the unit never writes again is
+     *   substituted into the top-level statements after it. Function bodies
+     *   keep reading the variable, since code run later (another script, a
+     *   module, an interactive line) may assign it. Units calling `require`,
+     *   or functions that are neither their own nor the standard library's,
+     *   are left alone, as those could write the variable in between.
+     * - `if` branches and loops whose condition folded to a constant are
+     *   resolved, and statements after a `return`, `break` or `continue` are
+     *   dropped.
+     *
+     * The static argument types of call statements are recomputed afterwards,
+     * so folded arguments skip the call-time type check too.
+     *
+     * @param program The unit, optimized in place.
+     */
+    void optimizeProgram(Block &program);
+
+} // namespace Interpreter
@@ -1,8 +1,15 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <cstdint>
+#include <cstdio>
+
+// Default capacity of the standard output buffer, in bytes
+#ifndef OS_OUTPUT_BUFFER_SIZE
+#define OS_OUTPUT_BUFFER_SIZE 65536
+#endif
 
 namespace OS {
 
@@ -20,13 +27,118 @@ namespace OS {
      */
     void printLine(const std::string& msg);
 
+    /**
+     * Writes raw bytes to standard output through the output buffer.
+     * @param data The bytes to write.
+     * @param size Number of bytes.
+     */
+    void write(const char* data, size_t size);
+
+    /**
+     * Writes a string to standard output through the output buffer.
+     * @param text The text to write.
+     */
+    inline void write(std::string_view text) { write(text.data(), text.size()); }
+
+    /**
+     * Writes all buffered output to standard output.
+     * Called automatically at exit, before reading input, before sleeping
+     * and whenever the buffer fills up.
+     */
+    void flush();
+
+    /**
+     * Sets the output buffer size (default OS_OUTPUT_BUFFER_SIZE).
+     * Pending output is flushed first.
+     * @param bytes Buffer capacity; 0 writes every call straight through.
+     */
+    void setOutputBufferSize(size_t bytes);
+
     /**
      * Reads a line of input from the standard input stream.
+     * Buffered output is flushed first, so prompts are visible.
      * @param out Reference to a string where the input will be stored.
      * @returns True if a line was successfully read, false on EOF or error.
      */
     bool readLine(std::string &out);
 
+    // --- Consoles ---
+
+    /**
+     * Where a runtime writes script output and reads interactive input.
+     * Every Interpreter::Context has one, so independent runtimes can send
+     * their output to different places; the default is standardConsole().
+     */
+    class Console {
+    public:
+        virtual ~Console() = default;
+
+        /**
+         * Writes raw bytes.
+         * @param data The bytes to write.
+         * @param size Number of bytes.
+         */
+        virtual void write(const char* data, size_t size) = 0;
+
+        /**
+         * Reads a line of input.
+         * @param out Receives the line (without the '\n').
+         * @returns False on end of input (the default: no input).
+         */
+        virtual bool readLine(std::string& out) { (void)out; return false; }
+
+        /**
+         * Writes out anything the console buffers.
+         */
+        virtual void flush() {}
+
+        inline void write(std::string_view text) { write(text.data(), text.size()); }
+
+        /**
+         * Writes a message followed by a newline.
+         */
+        virtual void printLine(std::string_view msg) {
+            write(msg);
+            write("\n", 1);
+        }
+    };
+
+    /**
+     * @returns The console over standard input and the buffered standard
+     * output (the functions above). Safe to share between threads: each
+     * write is appended whole.
+     */
+    Console& standardConsole();
+
+    /**
+     * A console that collects output in memory and reads input from a string.
+     * Used to capture the output of a script, e.g. to print it in order later.
+     */
+    class StringConsole : public Console {
+    public:
+        explicit StringConsole(std::string input = std::string()) : input(std::move(input)) {}
+
+        using Console::write;
+
+        void write(const char* data, size_t size) override { text.append(data, size); }
+        bool readLine(std::string& out) override;
+
+        /**
+         * @returns Everything written so far.
+         */
+        const std::string& output() const { return text; }
+
+        /**
+         * Returns the output written so far and clears it.
+         */
+        std::string takeOutput() { return std::move(text); }
+
+    private:
+        std::string text;
+        std::string input;
+        size_t inputPos = 0;
+    };
+
     // --- File I/O ---
 
     /**
@@ -52,6 +164,14 @@ namespace OS {
      */
     bool writeFile(const std::string& path, const std::string& data);
 
+    /**
+     * Gets the last modification time of a file.
+     * @param path Path to the file.
+     * @param outTime Receives the time; only comparable with other results of this function.
+     * @returns True if the time could be read, false otherwise.
+     */
+    bool fileModifiedTime(const std::string& path, uint64_t& outTime);
+
     /**
      * Lists all files in a directory.
      * @param directory Path to the directory.
@@ -60,6 +180,229 @@ namespace OS {
      */
     bool listFiles(const std::string& directory, std::vector<std::string>& outFiles);
 
+    // --- Source Files ---
+
+    /**
+     * A read-only view of a whole file plus an index of its lines.
+     * The file is memory-mapped where the platform supports it and read into
+     * memory otherwise. The type checker, the compiler and `require` all work
+     * on the same `lines()` views, so loading a script copies nothing.
+     */
+    class SourceFile {
+    public:
+        SourceFile() = default;
+        ~SourceFile();
+
+        SourceFile(const SourceFile&) = delete;
+        SourceFile& operator=(const SourceFile&) = delete;
+
+        /**
+         * Maps a file and indexes its lines, closing any previously open file.
+         * @param path Path to the file.
+         * @returns True if the file could be opened.
+         */
+        bool open(const std::string& path);
+
+        /**
+         * Releases the mapping; views from text() and lines() become invalid.
+         */
+        void close();
+
+        /**
+         * @returns The whole file contents.
+         */
+        std::string_view text() const { return std::string_view(data, size); }
+
+        /**
+         * @returns One view per line (without the '\n'), valid until close().
+         */
+        const std::vector<std::string_view>& lines() const { return lineIndex; }
+
+    private:
+        const char* data = nullptr;
+        size_t size = 0;
+        bool mapped = false;
+        void* fileHandle = nullptr;    // Windows only
+        void* mappingHandle = nullptr; // Windows only
+        std::string buffer;            // contents when the file is not mapped
+        std::vector<std::string_view> lineIndex;
+
+        void indexLines();
+    };
+
+    // --- Chunked Files ---
+
+    /**
+     * Reads a file front to back, a chunk or a line at a time, without ever
+     * holding all of it in memory. Regular files are memory-mapped and read
+     * in place (zero-copy); pipes, devices and files that cannot be mapped
+     * are read through one reusable buffer.
+     */
+    class FileReader {
+    public:
+        FileReader() = default;
+        ~FileReader();
+
+        FileReader(const FileReader&) = delete;
+        FileReader& operator=(const FileReader&) = delete;
+
+        /**
+         * Opens a file, closing any previously open one.
+         * @param path Path to the file; "-" is standard input.
+         * @returns True if the file could be opened.
+         */
+        bool open(const std::string& path);
+
+        /**
+         * Closes the file; views from earlier reads become invalid.
+         */
+        void close();
+
+        /**
+         * @returns True between a successful open() and close().
+         */
+        bool isOpen() const { return mapped || file; }
+
+        /**
+         * @returns True if the file is memory-mapped: one read of its size returns all of it.
+         */
+        bool isMapped() const { return mapped; }
+
+        /**
+         * Reads up to `size` bytes.
+         * @param size The most bytes to read (at least 1).
+         * @param out Receives a view of the bytes, valid until the next read.
+         * @returns False at the end of the file.
+         */
+        bool read(size_t size, std::string_view& out);
+
+        /**
+         * Reads the next line.
+         * @param out Receives the line without its "\n" or "\r\n", valid until the next read.
+         * @returns False at the end of the file.
+         */
+        bool readLine(std::string_view& out);
+
+    private:
+        const char* data = nullptr; // mapped: the file; buffered: buffer.data()
+        size_t size = 0;            // bytes at data
+        size_t pos = 0;             // first unread byte
+        bool mapped = false;
+        std::FILE* file = nullptr;  // when not mapped
+        std::string buffer;
+        void* fileHandle = nullptr;    // Windows only
+        void* mappingHandle = nullptr; // Windows only
+
+        bool fill(size_t want);
+    };
+
+    /**
+     * Writes a file through one reusable buffer, handed to the OS in large chunks.
+     */
+    class FileWriter {
+    public:
+        FileWriter() = default;
+        ~FileWriter();
+
+        FileWriter(const FileWriter&) = delete;
+        FileWriter& operator=(const FileWriter&) = delete;
+
+        /**
+         * Opens a file for writing, closing any previously open one.
+         * @param path Path to the file.
+         * @param append Write after the existing contents instead of replacing them.
+         * @returns True if the file could be opened.
+         */
+        bool open(const std::string& path, bool append);
+
+        /**
+         * Writes bytes (buffered).
+         * @returns False if the file is not open or writing failed.
+         */
+        bool write(std::string_view text);
+
+        /**
+         * Writes out the buffered bytes.
+         * @returns False if writing failed.
+         */
+        bool flush();
+
+        /**
+         * Flushes and closes the file.
+         * @returns False if any write since open() failed.
+         */
+        bool close();
+
+        bool isOpen() const { return file != nullptr; }
+
+    private:
+        std::FILE* file = nullptr;
+        bool failed = false;
+    };
+
+    // --- Streams ---
+
+    /**
+     * Opens a file, pipe, FIFO or device for reading without ever blocking.
+     * @param path Path to open; "-" is standard input.
+     * @returns A stream handle, or -1 if it cannot be opened.
+     */
+    int openStream(const std::string& path);
+
+    /**
+     * Reads what a stream has available, without waiting for more.
+     * @param stream Handle from openStream.
+     * @param buffer Receives the bytes.
+     * @param size Capacity of `buffer`.
+     * @returns Bytes read; 0 at the end of the stream (or on error);
+     * -1 if nothing is available yet.
+     */
+    long readStream(int stream, char* buffer, size_t size);
+
+    /**
+     * Closes a stream from openStream.
+     */
+    void closeStream(int stream);
+
+    /**
+     * Waits for any of several streams to become readable, in one call:
+     * epoll on Linux, kqueue on macOS and the BSDs, poll on other POSIX
+     * systems. Streams that cannot be waited on (regular files, and every
+     * stream on Windows) always count as readable.
+     */
+    class Poller {
+    public:
+        Poller();
+        ~Poller();
+
+        Poller(const Poller&) = delete;
+        Poller& operator=(const Poller&) = delete;
+
+        /**
+         * Watches a stream until it is removed.
+         * @param stream Handle from openStream.
+         */
+        void add(int stream);
+
+        /**
+         * Stops watching a stream (before it is closed).
+         */
+        void remove(int stream);
+
+        /**
+         * Waits until a watched stream can be read or the timeout passes.
+         * Buffered output is flushed first.
+         * @param timeoutMs Longest wait in milliseconds; negative waits for a stream.
+         * @param outReady Receives the readable streams (cleared first).
+         */
+        void wait(int64_t timeoutMs, std::vector<int>& outReady);
+
+    private:
+        int queue = -1;               // epoll or kqueue descriptor
+        std::vector<int> streams;     // every watched stream (what poll waits on)
+        std::vector<int> alwaysReady; // watched streams that cannot be waited on
+    };
+
     // --- Timing ---
 
     /**
@@ -69,6 +412,12 @@ namespace OS {
      */
     uint64_t getMillis();
 
+    /**
+     * Gets a monotonic timestamp in nanoseconds, for measuring intervals.
+     * @returns Nanoseconds since an arbitrary fixed point; only differences are meaningful.
+     */
+    uint64_t getNanos();
+
     /**
      * Suspends execution for a given number of milliseconds.
      * @param ms Number of milliseconds to sleep.
@@ -0,0 +1,28 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+
+namespace Setup {
+
+    // Runs batches of independent tasks on a fixed number of threads.
+    // Every thread starts with its own share of the tasks and, once that
+    // runs out, steals from the far end of the others' queues, so a few
+    // slow tasks do not leave the remaining threads idle.
+    class WorkPool {
+    public:
+        // `threads` workers (0: one per hardware thread)
+        explicit WorkPool(unsigned threads = 0);
+
+        unsigned size() const { return threadCount; }
+
+        // Calls task(i) for every i in [0, count) and returns when all are done.
+        // The calling thread works too. Tasks are started roughly in index
+        // order. The first exception a task throws is rethrown here once the
+        // others have finished.
+        void forEach(size_t count, const std::function<void(size_t)>& task);
+
+    private:
+        unsigned threadCount;
+    };
+
+} // namespace Setup
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace Interpreter
+{
+    /**
+     * Opt-in execution profiler (--profile), attached through Context::profiler.
+     *
+     * The interpreter reports frames (the script, required modules, user
+     * functions, and builtins as leaves), statements and stored values to it.
+     * From those it keeps, per frame name: call counts, inclusive and exclusive
+     * time and bytes allocated (Value::size() of the strings and arrays that
+     * statements store or return); per source line: executions and inclusive
+     * time; and per call path: exclusive time, written as folded stacks.
+     *
+     * Without a profiler attached the hooks cost one null check each, and
+     * building with REMOVE_PROFILER compiles them out. Not thread-safe: one
+     * profiler per context.
+     */
+    class Profiler
+    {
+    public:
+        Profiler();
+
+        /**
+         * Starts a frame named `name` (e.g. "script.ts", "fib", "Math.sqrt").
+         */
+        void enter(std::string_view name, bool builtin = false);
+
+        /**
+         * Ends the innermost frame.
+         */
+        void leave();
+
+        /**
+         * Records one execution of the statement at `line` of the innermost
+         * frame's source, taking `nanos` including everything it called
+         * (so a recursive call's line also counts the nested executions).
+         */
+        void statement(size_t line, uint64_t nanos);
+
+        /**
+         * Charges `bytes` to the innermost frame.
+         */
+        inline void allocated(size_t bytes)
+        {
+            if (!stack.empty())
+                functions[stack.back().function].bytes += bytes;
+        }
+
+        /**
+         * @returns The call paths in flamegraph folded format, one per line:
+         * "script.ts;outer;inner 12345" with the exclusive nanoseconds spent there.
+         */
+        std::string folded() const;
+
+        /**
+         * @returns Per-function and per-line tables as text.
+         */
+        std::string report() const;
+
+        /**
+         * Starts and ends a frame (no-op without a profiler).
+         */
+        class Frame
+        {
+        public:
+            Frame(Profiler *profiler, std::string_view name, bool builtin = false) : profiler(profiler)
+            {
+                if (profiler)
+                    profiler->enter(name, builtin);
+            }
+            ~Frame()
+            {
+                if (profiler)
+                    profiler->leave();
+            }
+            Frame(const Frame &) = delete;
+            Frame &operator=(const Frame &) = delete;
+
+        private:
+            Profiler *profiler;
+        };
+
+    private:
+        struct FunctionStats
+        {
+            std::string name;
+            bool builtin = false;
+            uint64_t calls = 0;
+            uint64_t inclusiveNs = 0; // outermost activations only, so recursion is not counted twice
+            uint64_t exclusiveNs = 0;
+            uint64_t bytes = 0;
+            uint32_t active = 0; // activations currently on the stack
+        };
+
+        struct LineStats
+        {
+            uint64_t count = 0;
+            uint64_t inclusiveNs = 0;
+        };
+
+        // A call path: the root is the empty path
+        struct Node
+        {
+            uint32_t parent = 0;
+            uint32_t function = 0;
+            uint64_t selfNs = 0;
+            std::unordered_map<uint32_t, uint32_t> children; // function -> node
+        };
+
+        struct ActiveFrame
+        {
+            uint32_t function;
+            uint32_t node;
+            uint64_t start;
+            uint64_t childNs = 0; // time spent in frames called from this one
+        };
+
+        std::vector<FunctionStats> functions;
+        std::unordered_map<std::string, uint32_t> functionIds;
+        std::unordered_map<uint64_t, LineStats> lines; // key: function << 32 | line
+        std::vector<Node> tree;
+        std::vector<ActiveFrame> stack;
+    };
+
+} // namespace Interpreter
@@ -1,15 +1,139 @@
 #pragma once
+#include <cstdint>
+#include <functional>
+#include <memory>
 #include <string>
+#include <vector>
+
+namespace OS {
+    class Console;
+}
+
+namespace Interpreter {
+    struct Context;
+    struct Statement;
+    class Profiler;
+}
 
 namespace Setup {
 
+    // A compiled script, shared read-only by every runtime that runs it
+    using Program = std::shared_ptr<const std::vector<Interpreter::Statement>>;
+
+    // One isolated interpreter: its own variables, functions, loaded modules,
+    // console and Math.random state, and no globals behind them. Independent
+    // runtimes may run on different threads at the same time; compiled
+    // programs, modules and the standard library are shared between them.
+    // A single runtime must only be used by one thread at a time.
+    class Runtime {
+    public:
+        // Creates a runtime with the builtins available.
+        // Output and input go through `console` (the process stdin/stdout if null),
+        // which must outlive the runtime.
+        explicit Runtime(OS::Console* console = nullptr);
+        ~Runtime();
+
+        Runtime(const Runtime&) = delete;
+        Runtime& operator=(const Runtime&) = delete;
+
+        // Type checks (unless disabled) and compiles a script file without running it.
+        // Returns null if the file cannot be opened or fails the type check.
+        Program load(const std::string& filename);
+
+        // Runs a loaded program in this runtime, then the callbacks it scheduled
+        // (timers, microtasks, watched streams) until none are left
+        void run(const Program& program);
+
+        // Loads and runs a script from a file path (see run)
+        bool runFile(const std::string& filename);
+
+        // Runs a script from a string (see run)
+        bool runString(const std::string& code);
+
+        // Enable or disable the type check before running files and modules (--no-check)
+        void setTypeCheck(bool enabled);
+
+        // Seeds Math.random for this runtime (runtimes otherwise all start from the same seed)
+        void seedRandom(uint64_t seed);
+
+        // Sends output and reads input through `console` from now on
+        void setConsole(OS::Console& console);
+
+        // Profiles everything this runtime runs from now on (--profile)
+        Interpreter::Profiler& startProfiling();
+
+        // Writes the profile collected so far: folded stacks (flamegraph input)
+        // to `foldedPath` and per-function and per-line tables to `reportPath`.
+        // Returns false if profiling is off or a file cannot be written.
+        bool writeProfile(const std::string& foldedPath, const std::string& reportPath) const;
+
+        // Saves the variables, user functions and loaded modules of this runtime
+        // (see Interpreter::writeSnapshot). Returns false if it cannot be written.
+        bool writeSnapshot(const std::string& path) const;
+
+        // Restores a saved snapshot, typically into a fresh runtime, instead of
+        // running its prelude again. Returns false, changing nothing, if the
+        // snapshot is unreadable, from another build or out of date.
+        bool restoreSnapshot(const std::string& path);
+
+        // The interpreter state, for registering builtins and inspecting variables
+        Interpreter::Context& context() { return *ctx; }
+
+    private:
+        std::unique_ptr<Interpreter::Context> ctx;
+        std::unique_ptr<Interpreter::Profiler> profile;
+    };
+
+    // --- Batch Runs ---
+
+    // Outcome of one script of a batch
+    struct BatchResult {
+        std::string script;
+        std::string output; // everything the script printed, errors included
+        bool ok = false;    // opened and passed the type check
+    };
+
+    // Collects the scripts of a batch: the .ts files of a directory (sorted by
+    // name), or the paths listed in a manifest file, one per line ('#' starts
+    // a comment; relative paths are relative to the manifest).
+    bool listBatch(const std::string& path, std::vector<std::string>& outScripts);
+
+    // Runs every script in a fresh runtime of its own, on a work-stealing pool
+    // of `jobs` threads (0: one per core). `emit` is called on one thread at a
+    // time with each result in script order, as soon as it and all the ones
+    // before it are done. Returns true if every script could be run.
+    bool runBatch(const std::vector<std::string>& scripts, unsigned jobs, bool typeCheck,
+                  const std::function<void(const BatchResult&)>& emit);
+
+    // --- Process-wide runtime ---
+    // The functions below drive one default runtime, for hosts that only run
+    // a single script (like the command-line runner).
+
     // Initialize the runtime (register builtins, etc.)
     void initialize();
 
     // Run a script from a file path
     bool runFile(const std::string& filename);
 
+    // Enable or disable the type check before running files and modules (--no-check)
+    void setTypeCheck(bool enabled);
+
+    // Type check a script without running it (--check-only)
+    bool checkFile(const std::string& filename);
+
     // Run a script from a string (optional helper)
     bool runString(const std::string& code);
 
-} // namespace Setup
\ No newline at end of file
+    // Profile the default runtime from now on (--profile)
+    void enableProfiling();
+
+    // Write the default runtime's profile (see Runtime::writeProfile)
+    bool writeProfile(const std::string& foldedPath, const std::string& reportPath);
+
+    // Save the default runtime's state (see Runtime::writeSnapshot, --write-snapshot)
+    bool writeSnapshot(const std::string& path);
+
+    // Restore a snapshot into the default runtime (see Runtime::restoreSnapshot, --snapshot)
+    bool restoreSnapshot(const std::string& path);
+
+} // namespace Setup
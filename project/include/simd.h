@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstddef>
+
+namespace TS
+{
+    /**
+     * Batch kernels over contiguous double and float buffers.
+     * The instruction set is chosen at compile time from the target flags
+     * (AVX, SSE2, NEON on AArch64), with a scalar loop everywhere else.
+     * Reductions accumulate in double precision.
+     */
+    namespace Simd
+    {
+        /**
+         * Element-wise functions for map.
+         */
+        enum class Unary : unsigned char
+        {
+            Sqrt,
+            Abs,
+            Floor,
+            Sin, // no vector instruction: a tight loop over std::sin
+            Cos  // no vector instruction: a tight loop over std::cos
+        };
+
+        /**
+         * Element-wise operators for combine.
+         */
+        enum class Binary : unsigned char
+        {
+            Add,
+            Sub,
+            Mul,
+            Div
+        };
+
+        /**
+         * @returns The instruction set the kernels were built for ("avx", "sse2", "neon" or "scalar").
+         */
+        const char *isa();
+
+        /**
+         * out[i] = op(in[i]) for i < n. `out` may be `in`.
+         */
+        void map(Unary op, const double *in, double *out, size_t n);
+        void map(Unary op, const float *in, float *out, size_t n);
+
+        /**
+         * out[i] = pow(in[i], exponent) for i < n. `out` may be `in`.
+         */
+        void pow(const double *in, double exponent, double *out, size_t n);
+        void pow(const float *in, float exponent, float *out, size_t n);
+
+        /**
+         * out[i] = a[i] op b[i] for i < n. `out` may be `a` or `b`.
+         */
+        void combine(Binary op, const double *a, const double *b, double *out, size_t n);
+        void combine(Binary op, const float *a, const float *b, float *out, size_t n);
+
+        /**
+         * data[i] *= factor for i < n.
+         */
+        void scale(double *data, double factor, size_t n);
+        void scale(float *data, float factor, size_t n);
+
+        /**
+         * @returns The sum of the first n elements (the order of additions is unspecified).
+         */
+        double sum(const double *data, size_t n);
+        double sum(const float *data, size_t n);
+
+        /**
+         * @returns The dot product of the first n elements.
+         */
+        double dot(const double *a, const double *b, size_t n);
+        double dot(const float *a, const float *b, size_t n);
+
+        /**
+         * @returns The smallest (largest) of the first n elements, NaN if any
+         * is NaN, and Infinity (-Infinity) when n is 0, like Math.min (Math.max).
+         */
+        double min(const double *data, size_t n);
+        double min(const float *data, size_t n);
+        double max(const double *data, size_t n);
+        double max(const float *data, size_t n);
+
+    } // namespace Simd
+
+} // namespace TS
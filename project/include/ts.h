@@ -1,13 +1,25 @@
 // ts.h
 #pragma once
 
+#include <memory>
 #include <string>
+#include <string_view>
 #include <unordered_map>
-#include <variant>
 #include <vector>
 #include <optional>
+#include <atomic>
 #include <cmath>
 #include <cstdint>
+#include <cstring>
+
+#ifdef ADD_STD_HALF
+#include "half.h"
+#endif
+
+// SKIPTYPE_CHECK is the old spelling of SKIP_TYPECHECK
+#if defined(SKIPTYPE_CHECK) && !defined(SKIP_TYPECHECK)
+#define SKIP_TYPECHECK
+#endif
 
 #ifdef USE_FLOAT_NUMBER
 typedef float NUMBER;
@@ -58,7 +70,14 @@ namespace TS
         Null,      // NULL
         Undefined, // Undefined
         NaN,       // NaN
-        Half       // half (fp16)
+        Half,      // half (fp16)
+        Object,    // Object (properties laid out by a TS::Shape)
+
+        // Arrays (shared, reference counted element storage)
+        Array,        // Array (TS::Value elements)
+        Float64Array, // Float64Array (double elements)
+        Float32Array, // Float32Array (float elements)
+        Float16Array  // Float16Array (half elements, ADD_STD_HALF only)
     };
 
 #ifdef ADD_STD_HALF
@@ -67,27 +86,197 @@ namespace TS
 #define _half float
 #endif
 
+    /**
+     * @struct
+     * @short Reference count shared by every heap payload of a Value.
+     */
+    struct SharedData
+    {
+        std::atomic<uint32_t> refs{1}; // Number of Values referencing this payload
+    };
+
+    /**
+     * @struct
+     * @short Immutable, reference counted string payload.
+     * Copies of a string Value share one StringData instead of copying characters.
+     */
+    struct StringData : SharedData
+    {
+        const std::string str; // The characters (never modified after creation)
+
+        explicit StringData(std::string s) : str(std::move(s)) {}
+    };
+
+    /**
+     * @struct
+     * @short Reference counted elements of an array value.
+     * Copies of an array Value share one ArrayData, so arrays have reference
+     * semantics like in JavaScript: a write through one copy is seen by all.
+     * Typed arrays keep their numbers unboxed and contiguous.
+     */
+    template <typename T>
+    struct ArrayData : SharedData
+    {
+        std::vector<T> elements;
+
+        explicit ArrayData(std::vector<T> e = {}) : elements(std::move(e)) {}
+    };
+
+    struct Value;
+    struct Shape;
+
+    /**
+     * @struct
+     * @short Reference counted properties of an object value.
+     * `slots` holds one value per key of `shape` (see objects.h), in its
+     * order. Copies of an object Value share one ObjectData, like arrays.
+     */
+    struct ObjectData : SharedData
+    {
+        const Shape *shape = nullptr;
+        std::vector<Value> slots;
+    };
+
     // --- Value Representation ---
+    /**
+     * A 16-byte tagged value: one type tag plus an 8-byte payload.
+     * Numbers, booleans and halves are stored inline, so arithmetic never
+     * touches the allocator; strings are a pointer to shared StringData.
+     */
     struct Value
     {
-        ValueType type;                                      // Current Type
-        std::variant<NUMBER, std::string, bool, _half> data; // Current Value
+        ValueType type; // Current Type
+
+        union Payload // Current Value (selected by `type`)
+        {
+            NUMBER number;
+            bool boolean;
+            _half fp16;
+            StringData *string;
+            ArrayData<Value> *array;
+            ArrayData<double> *f64;
+            ArrayData<float> *f32;
+            ArrayData<_half> *f16;
+            ObjectData *object;
+            uint64_t bits;
+
+            Payload() : bits(0) {}
+        } payload;
+
+        Value() : type(ValueType::Null) {}                                   // Null by default
+        explicit Value(NUMBER num) : type(ValueType::Number) { payload.number = num; } // Create a TS::Value with a number.
+#ifdef USE_FLOAT_NUMBER
+        explicit Value(double num) : Value(static_cast<NUMBER>(num)) {} // Double literals narrow to NUMBER.
+#endif
+        explicit Value(const std::string &str);                              // Create a TS::Value with a string.
+        explicit Value(std::string &&str);                                   // Create a TS::Value with a string (moved in).
+        explicit Value(const char *str);                                     // Create a TS::Value with a string literal.
+        explicit Value(bool b) : type(ValueType::Boolean) { payload.boolean = b; }     // Create a TS::Value with a boolean.
+#if defined(ADD_STD_HALF) || !defined(USE_FLOAT_NUMBER) // otherwise _half is NUMBER
+        explicit Value(_half b) : type(ValueType::Half) { payload.fp16 = b; }          // Create a TS::Value with a half.
+#endif
 
-        Value();                                // Null by default
-        explicit Value(NUMBER num);             // Create a TS::Value with a number.
-        explicit Value(const std::string &str); // Create a TS::Value with a string.
-        explicit Value(bool b);                 // Create a TS::Value with a boolean.
-        explicit Value(_half b);                // Create a TS::Value with a half.
+        /**
+         * Creates an Array holding `elements`.
+         */
+        static Value makeArray(std::vector<Value> elements = {});
+
+        /**
+         * Creates a zero filled typed array (`type` is Float64Array, Float32Array
+         * or Float16Array) of `length` elements.
+         */
+        static Value makeTypedArray(ValueType type, size_t length);
+
+        /**
+         * Creates an Object of shape `shape` holding `slots` (one per key of the shape).
+         */
+        static Value makeObject(const Shape *shape, std::vector<Value> slots = {});
+
+        inline Value(const Value &other) : type(other.type)
+        {
+            std::memcpy(&payload, &other.payload, sizeof(Payload));
+            retain();
+        }
+
+        inline Value(Value &&other) noexcept : type(other.type)
+        {
+            std::memcpy(&payload, &other.payload, sizeof(Payload));
+            other.type = ValueType::Null;
+        }
+
+        inline Value &operator=(const Value &other)
+        {
+            if (this != &other)
+            {
+                other.retain();
+                release();
+                type = other.type;
+                std::memcpy(&payload, &other.payload, sizeof(Payload));
+            }
+            return *this;
+        }
+
+        inline Value &operator=(Value &&other) noexcept
+        {
+            if (this != &other)
+            {
+                release();
+                type = other.type;
+                std::memcpy(&payload, &other.payload, sizeof(Payload));
+                other.type = ValueType::Null;
+            }
+            return *this;
+        }
+
+        inline ~Value() { release(); }
+
+        // --- Payload accessors (the caller checks `type`) ---
+        inline NUMBER asNumber() const { return payload.number; }
+        inline bool asBool() const { return payload.boolean; }
+        inline _half asHalf() const { return payload.fp16; }
+        inline const std::string &asString() const { return payload.string->str; }
+        inline std::vector<Value> &asArray() const { return payload.array->elements; }
+        inline std::vector<double> &asFloat64Array() const { return payload.f64->elements; }
+        inline std::vector<float> &asFloat32Array() const { return payload.f32->elements; }
+        inline std::vector<_half> &asFloat16Array() const { return payload.f16->elements; }
+        inline ObjectData &asObject() const { return *payload.object; }
+
+        // --- Arrays ---
+        /**
+         * @returns True for Array and every typed array.
+         */
+        inline bool isArray() const { return type >= ValueType::Array; }
+
+        /**
+         * @returns The element count of an array, the length of a string, 0 otherwise.
+         */
+        inline size_t length() const;
+
+        /**
+         * Reads element `index` of an array (or character of a string).
+         * Typed array elements are widened to numbers.
+         * @returns The element, or null when `index` is out of range.
+         */
+        inline Value at(size_t index) const;
+
+        /**
+         * Writes element `index` of an array; typed arrays convert `value` to
+         * their element type. An Array grows to fit `index` (new elements are
+         * null), typed arrays ignore writes past their end.
+         * @returns False if this is not an array.
+         */
+        inline bool setAt(size_t index, const Value &value) const;
 
         inline size_t size() const
         {
-            size_t total = sizeof(*this); // shallow size (tag + variant)
+            size_t total = sizeof(*this); // shallow size (tag + payload)
 
             switch (type)
             {
             case ValueType::String:
             {
-                const auto &s = std::get<std::string>(data);
+                const auto &s = asString();
+                total += sizeof(StringData); // shared, refcounted header
 
                 // Detect if string is using heap storage
                 // Detect SSO (Short String Optimization) threshold based on compiler/STL
@@ -116,18 +305,53 @@ namespace TS
                 break;
             }
 
+            // Element storage; nested arrays are counted as their 16-byte Value
+            case ValueType::Array:
+                total += sizeof(ArrayData<Value>) + asArray().capacity() * sizeof(Value);
+                break;
+            case ValueType::Float64Array:
+                total += sizeof(ArrayData<double>) + asFloat64Array().capacity() * sizeof(double);
+                break;
+            case ValueType::Float32Array:
+                total += sizeof(ArrayData<float>) + asFloat32Array().capacity() * sizeof(float);
+                break;
+            case ValueType::Float16Array:
+                total += sizeof(ArrayData<_half>) + asFloat16Array().capacity() * sizeof(_half);
+                break;
+            case ValueType::Object:
+                total += sizeof(ObjectData) + asObject().slots.capacity() * sizeof(Value);
+                break;
+
             case ValueType::Number:
             case ValueType::Boolean:
             case ValueType::Null:
             case ValueType::Undefined:
             case ValueType::NaN:
+            case ValueType::Half:
                 // No extra heap allocation for these
                 break;
             }
             return total;
         }
 
+        /**
+         * Strict equality (===): same type and same value.
+         */
+        bool strictEquals(const Value &other) const;
+
+        /**
+         * Loose equality (==): null equals undefined, and numbers, booleans,
+         * halves and numeric strings compare by numeric value.
+         */
+        bool looseEquals(const Value &other) const;
+
         std::string toString() const;
+
+        /**
+         * Appends the string form of the value to `out`, without temporaries.
+         */
+        void appendTo(std::string &out) const;
+
         NUMBER toNumber() const;
         bool toBool() const;
         inline bool isTruthy() const;
@@ -138,7 +362,7 @@ namespace TS
         // Prefix increment
         inline Value &operator++()
         {
-            std::get<NUMBER>(data) += 1.0;
+            payload.number += 1.0;
             return *this;
         }
 
@@ -153,7 +377,7 @@ namespace TS
         // Prefix decrement
         inline Value &operator--()
         {
-            std::get<NUMBER>(data) -= 1.0;
+            payload.number -= 1.0;
             return *this;
         }
 
@@ -174,25 +398,27 @@ namespace TS
         // Unary minus
         inline Value operator-() const
         {
-            return Value{-std::get<NUMBER>(data)};
+            return Value{-payload.number};
         }
 
         // Binary addition
         inline Value operator+(const Value &rhs) const
         {
-            return Value{std::get<NUMBER>(data) + std::get<NUMBER>(rhs.data)};
+            return Value{payload.number + rhs.payload.number};
         }
 
         // Binary subtraction
         inline Value operator-(const Value &rhs) const
         {
-            return Value{std::get<NUMBER>(data) - std::get<NUMBER>(rhs.data)};
+            return Value{payload.number - rhs.payload.number};
         }
 
         // Explicit conversion to NUMBER
         explicit operator NUMBER() const { return toNumber(); }
 
+#ifndef USE_FLOAT_NUMBER
         explicit operator float() const { return static_cast<float>(toNumber()); }
+#endif
 
         explicit operator int32_t() const { return static_cast<int32_t>(std::round(toNumber())); }
 
@@ -205,32 +431,337 @@ namespace TS
         {
             return toString();
         }
+
+    private:
+        // The reference counted payload, or nullptr for inline ones
+        inline SharedData *shared() const
+        {
+            switch (type)
+            {
+            case ValueType::String:
+                return payload.string;
+            case ValueType::Array:
+                return payload.array;
+            case ValueType::Float64Array:
+                return payload.f64;
+            case ValueType::Float32Array:
+                return payload.f32;
+            case ValueType::Float16Array:
+                return payload.f16;
+            case ValueType::Object:
+                return payload.object;
+            default:
+                return nullptr;
+            }
+        }
+
+        inline void retain() const
+        {
+            if (SharedData *data = shared())
+                data->refs.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        inline void release()
+        {
+            SharedData *data = shared();
+            if (data && data->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                destroyShared();
+        }
+
+        // Frees the payload once the last reference is released
+        void destroyShared();
+    };
+
+    static_assert(sizeof(Value) == 16, "TS::Value should stay a 16-byte tag + payload");
+
+    inline size_t Value::length() const
+    {
+        switch (type)
+        {
+        case ValueType::String:
+            return asString().size();
+        case ValueType::Array:
+            return asArray().size();
+        case ValueType::Float64Array:
+            return asFloat64Array().size();
+        case ValueType::Float32Array:
+            return asFloat32Array().size();
+        case ValueType::Float16Array:
+            return asFloat16Array().size();
+        default:
+            return 0;
+        }
+    }
+
+    inline Value Value::at(size_t index) const
+    {
+        if (index >= length())
+            return Value();
+        switch (type)
+        {
+        case ValueType::String:
+            return Value(std::string(1, asString()[index]));
+        case ValueType::Array:
+            return asArray()[index];
+        case ValueType::Float64Array:
+            return Value(static_cast<NUMBER>(asFloat64Array()[index]));
+        case ValueType::Float32Array:
+            return Value(static_cast<NUMBER>(asFloat32Array()[index]));
+        case ValueType::Float16Array:
+            return Value(static_cast<NUMBER>(static_cast<float>(asFloat16Array()[index])));
+        default:
+            return Value();
+        }
+    }
+
+    inline bool Value::setAt(size_t index, const Value &value) const
+    {
+        switch (type)
+        {
+        case ValueType::Array:
+        {
+            Value element = value; // `value` may live in the storage a resize moves
+            std::vector<Value> &elements = asArray();
+            if (index >= elements.size())
+                elements.resize(index + 1);
+            elements[index] = std::move(element);
+            return true;
+        }
+        case ValueType::Float64Array:
+            if (index < asFloat64Array().size())
+                asFloat64Array()[index] = static_cast<double>(value.toNumber());
+            return true;
+        case ValueType::Float32Array:
+            if (index < asFloat32Array().size())
+                asFloat32Array()[index] = static_cast<float>(value.toNumber());
+            return true;
+        case ValueType::Float16Array:
+            if (index < asFloat16Array().size())
+                asFloat16Array()[index] = _half(static_cast<float>(value.toNumber()));
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    // --- Atoms ---
+    /**
+     * @fn
+     * @short Interns an identifier (e.g. "x", "Math.sin" or "Point.norm").
+     * The compiler stores the atom of every name it resolves, so variable and
+     * callable lookups at run time compare small integers instead of hashing
+     * strings. Atoms are dense and stable for the life of the process, but not
+     * across processes, so they are never written to compiled artifacts.
+     * Thread-safe; every runtime in the process shares the table.
+     * @returns The atom; the same name always yields the same atom.
+     */
+    uint32_t atom(std::string_view name);
+
+    /**
+     * @fn
+     * @short Looks up the atom of a name without interning it.
+     * @returns False if `name` was never interned (so nothing can be named by it).
+     */
+    bool findAtom(std::string_view name, uint32_t &outAtom);
+
+    /**
+     * @fn
+     * @returns The name an atom was interned from.
+     */
+    const std::string &atomName(uint32_t atom);
+
+    /**
+     * @class
+     * @short Named variables of a scope, keyed by atom.
+     * An open addressing (linear probing) table of pointers to the values,
+     * which never move once inserted: pointers from find stay valid while
+     * other names are added.
+     */
+    class AtomMap
+    {
+    public:
+        struct Entry
+        {
+            uint32_t atom;
+            Value value;
+        };
+
+        AtomMap() = default;
+        AtomMap(const AtomMap &) = delete;
+        AtomMap &operator=(const AtomMap &) = delete;
+
+        /**
+         * @returns The value of `atom`, or nullptr if it is not in the map.
+         */
+        inline Value *find(uint32_t atom) const
+        {
+            if (buckets.empty())
+                return nullptr;
+            size_t mask = buckets.size() - 1;
+            for (size_t i = hash(atom) & mask;; i = (i + 1) & mask)
+            {
+                const Bucket &bucket = buckets[i];
+                if (bucket.atom == atom)
+                    return bucket.value;
+                if (!bucket.value)
+                    return nullptr;
+            }
+        }
+
+        /**
+         * @returns The value of `atom`, inserted as null if it is not in the map.
+         */
+        Value &operator[](uint32_t atom);
+
+        size_t size() const { return entries.size(); }
+        bool empty() const { return entries.empty(); }
+
+        /**
+         * Every entry, in insertion order.
+         */
+        const std::vector<std::unique_ptr<Entry>> &all() const { return entries; }
+
+    private:
+        struct Bucket
+        {
+            uint32_t atom = UINT32_MAX;
+            Value *value = nullptr; // nullptr: empty
+        };
+
+        std::vector<Bucket> buckets; // power of two, at most half full
+        std::vector<std::unique_ptr<Entry>> entries;
+
+        static inline size_t hash(uint32_t atom)
+        {
+            uint32_t h = atom * 0x9E3779B1u; // atoms are dense: spread them
+            return h ^ (h >> 16);
+        }
+
+        void grow();
     };
 
     // --- Variable Environment ---
-    using Environment = std::unordered_map<std::string, Value>;
+    /**
+     * @struct
+     * @short Lexical scope.
+     * Function frames keep parameters and `let` locals in `slots` (indices are
+     * resolved when the function is compiled) and fall back to `parent` for
+     * every other name, so a call never copies the enclosing scope.
+     */
+    struct Environment
+    {
+        AtomMap vars;                                // Named variables of this scope
+        Environment *parent = nullptr;              // Enclosing scope, nullptr for globals
+        Value *slots = nullptr;                     // Slot-indexed locals of a function frame
+        uint32_t slotCount = 0;                     // Number of entries in `slots`
+
+        Environment() = default;
+        explicit Environment(Environment *parent, Value *slots = nullptr, uint32_t slotCount = 0)
+            : parent(parent), slots(slots), slotCount(slotCount) {}
+
+        // Non-copyable: frames are referenced by pointer from nested scopes
+        Environment(const Environment &) = delete;
+        Environment &operator=(const Environment &) = delete;
+
+        /**
+         * Finds a named variable in this scope or any enclosing one.
+         * @returns Pointer to the value, or nullptr when it is not defined.
+         */
+        inline Value *lookup(uint32_t atom)
+        {
+            for (Environment *env = this; env; env = env->parent)
+            {
+                if (Value *value = env->vars.find(atom))
+                    return value;
+            }
+            return nullptr;
+        }
+
+        inline const Value *lookup(uint32_t atom) const
+        {
+            return const_cast<Environment *>(this)->lookup(atom);
+        }
+
+        // By name, for callers without a compiled atom
+        inline Value *lookup(std::string_view name)
+        {
+            uint32_t id;
+            return findAtom(name, id) ? lookup(id) : nullptr;
+        }
+
+        inline const Value *lookup(std::string_view name) const
+        {
+            return const_cast<Environment *>(this)->lookup(name);
+        }
+    };
+
+    // --- Number Conversions ---
+    /**
+     * Longest text formatNumber can produce (e.g. "-1.2345678901234567e-308").
+     */
+    constexpr size_t kNumberTextMax = 32;
+
+    /**
+     * @fn
+     * @short Formats a number like JavaScript's Number#toString (shortest round-trip digits).
+     * @returns The number of characters written to `buffer` (at most kNumberTextMax).
+     */
+    size_t formatNumber(double value, char *buffer);
+    size_t formatNumber(float value, char *buffer);
+
+    /**
+     * @fn
+     * @short Parses text like JavaScript's Number(text), without throwing.
+     * Surrounding whitespace is ignored, empty text is 0, and anything that is
+     * not entirely a number is NaN.
+     */
+    NUMBER parseNumber(std::string_view text);
 
     // --- Environment Helpers ---
     /**
      * @fn
-     * @short Set Varible.
+     * @short Set Varible (in the given scope).
      */
     bool setVar(Environment &env, const std::string &name, const Value &value);
+    bool setVar(Environment &env, uint32_t atom, const Value &value);
     /**
      * @fn
-     * @short Get Varible.
+     * @short Get Varible (searching enclosing scopes).
      */
     std::optional<Value> getVar(const Environment &env, const std::string &name);
     /**
      * @fn
      * @short Var Exists?
-     * @returns wheter the var exists in the current enviroment.
+     * @returns wheter the var exists in the current enviroment or an enclosing one.
      */
     bool varExists(const Environment &env, const std::string &name);
+    /**
+     * @short Annotated parameter types ("any" when not annotated) of each declared function.
+     */
+    using FunctionSignatures = std::unordered_map<std::string, std::vector<std::string>>;
+
+    /**
+     * @struct
+     * @short Everything a type check produces.
+     */
+    struct TypeCheckResult
+    {
+        std::vector<TypeError> errors;  // Errors in source order
+        FunctionSignatures signatures; // Functions the source declares
+    };
+
+    /**
+     * @fn
+     * @short Check For type Errors and collect function signatures.
+     */
+    TypeCheckResult checkTypes(std::string_view source);
+
     /**
      * @fn
      * @short Check For type Errors.
+     * Lexes `source` once and checks literal arguments of calls against the
+     * annotated parameter types of the functions it declares.
      */
-    std::vector<TypeError> checkTypesInSource(const std::string &source);
+    std::vector<TypeError> checkTypesInSource(std::string_view source);
 
 } // namespace TS
\ No newline at end of file
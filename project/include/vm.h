@@ -0,0 +1,257 @@
+#pragma once
+
+#include "interpreter.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Interpreter
+{
+    /**
+     * Instructions of the bytecode tier, in X-macro form so the opcode enum
+     * and the dispatch table of runBytecode cannot drift apart.
+     *
+     * Registers come in two files: numbers (`N`, unboxed NUMBER) and values
+     * (`V`, TS::Value). Every instruction producing a result writes it to `a`.
+     * Jump targets are instruction indices.
+     *
+     * Path ops resolve dotted names as the interpreter does (resolvePath,
+     * assignPath, callPathMethod, callPathStatement); the first part of the
+     * name is the local in V[c], or looked up by name if the op is `global`.
+     */
+#define INTERPRETER_BYTECODE_OPS(X)                                                          \
+    X(Jump)            /* goto a */                                                          \
+    X(JumpIf)          /* if (V[b]) goto a */                                                \
+    X(JumpUnless)      /* if (!V[b]) goto a */                                               \
+    X(JumpIfN)         /* if (N[b] is truthy) goto a */                                      \
+    X(JumpUnlessN)     /* if (N[b] is falsy) goto a */                                       \
+    X(JumpIfLt)        /* if (N[b] < N[c]) goto a, likewise for the other comparisons */     \
+    X(JumpIfGt)                                                                              \
+    X(JumpIfLe)                                                                              \
+    X(JumpIfGe)                                                                              \
+    X(JumpIfEq)                                                                              \
+    X(JumpIfNe)                                                                              \
+    X(JumpUnlessLt)    /* if (!(N[b] < N[c])) goto a, likewise for the other comparisons */  \
+    X(JumpUnlessGt)                                                                          \
+    X(JumpUnlessLe)                                                                          \
+    X(JumpUnlessGe)                                                                          \
+    X(JumpUnlessEq)                                                                          \
+    X(JumpUnlessNe)                                                                          \
+    X(MoveN)           /* N[a] = N[b] */                                                     \
+    X(MoveV)           /* V[a] = V[b] */                                                     \
+    X(Box)             /* V[a] = Value(N[b]) */                                              \
+    X(Unbox)           /* N[a] = V[b].toNumber() */                                          \
+    X(LoadConstant)    /* V[a] = values[b] */                                                \
+    X(LoadGlobal)      /* V[a] = the variable names[b] (undefined if none) */                \
+    X(StoreGlobal)     /* the variable names[a] = V[b], created as a global if new */        \
+    X(LoadPath)        /* V[a] = names[b] from its local V[c] (see path ops) */              \
+    X(StorePath)       /* names[a] from its local V[c] = V[b] */                             \
+    X(GetMember)       /* V[a] = property paths[b] of V[c] */                                \
+    X(MakeObject)      /* V[a] = object of shape paths[b] holding V[c], ..., V[c + d - 1] */ \
+    X(AddN)            /* N[a] = N[b] + N[c], likewise Sub, Mul, Div, Mod and Pow */         \
+    X(SubN)                                                                                  \
+    X(MulN)                                                                                  \
+    X(DivN)                                                                                  \
+    X(ModN)                                                                                  \
+    X(PowN)                                                                                  \
+    X(NegN)            /* N[a] = -N[b] */                                                    \
+    X(LtN)             /* V[a] = Value(N[b] < N[c]), likewise for the other comparisons */   \
+    X(GtN)                                                                                   \
+    X(LeN)                                                                                   \
+    X(GeN)                                                                                   \
+    X(EqN)                                                                                   \
+    X(NeN)                                                                                   \
+    X(Binary)          /* V[a] = applyOpVal(operator, V[b], V[c]) */                         \
+    X(Unary)           /* V[a] = applyUnaryOpVal(operator, V[b]) */                          \
+    X(IndexN)          /* V[a] = V[b][N[c]] */                                               \
+    X(MakeArray)       /* V[a] = [V[b], ..., V[b + c - 1]] */                                \
+    X(Call)            /* V[a] = callee b (V[c], ..., V[c + d - 1]) */                       \
+    X(CallStatement)   /* callee b named names[a] (V[c], ...), as a call statement */        \
+    X(New)             /* V[a] = new names[b] (V[c + 1], ..., V[c + d]) into V[c] */         \
+    X(CallMethod)      /* V[a] = method paths[b] of V[c] (V[c + 1], ..., V[c + d]) */        \
+    X(CallPath)        /* V[a] = names[b] from its local V[c] (V[c + 1], ...) */             \
+    X(CallPathStatement) /* likewise, as a call statement */                                 \
+    X(CheckArray)      /* unless the target (see SetElement) is an array: report, goto c */  \
+    X(SetElement)      /* target[N[b]] = V[c]; the target is V[a], or names[d] if global */  \
+    X(Return)          /* return V[a] */                                                     \
+    X(ReturnN)         /* return Value(N[a]) */                                              \
+    X(ReturnUndefined) /* return undefined */
+
+    enum class BytecodeOp : uint8_t
+    {
+#define INTERPRETER_BYTECODE_ENUM(name) name,
+        INTERPRETER_BYTECODE_OPS(INTERPRETER_BYTECODE_ENUM)
+#undef INTERPRETER_BYTECODE_ENUM
+    };
+
+    /**
+     * One register instruction; the meaning of the operands depends on `op`.
+     */
+    struct Instruction
+    {
+        BytecodeOp op = BytecodeOp::ReturnUndefined;
+        OpCode oper = OpCode::Add; // Binary and Unary: the operator applied
+        bool global = false;       // CheckArray and SetElement: the target is names[d]; path ops: the name is no local
+        uint32_t a = 0;
+        uint32_t b = 0;
+        uint32_t c = 0;
+        uint32_t d = 0;
+    };
+
+    /**
+     * A user function compiled for the register VM.
+     */
+    struct Bytecode
+    {
+        /**
+         * Where an argument is copied to on entry.
+         */
+        struct Parameter
+        {
+            bool number = false; // declared `number`: an unboxed N register, guarded on entry
+            uint32_t reg = 0;
+        };
+
+        /**
+         * Exceptions raised in [begin, end) are reported and execution resumes
+         * at `resume`, as the interpreter does for `let` and assignments.
+         */
+        struct Handler
+        {
+            uint32_t begin = 0;
+            uint32_t end = 0;
+            uint32_t resume = 0;
+        };
+
+        std::vector<Instruction> code;
+        std::vector<Parameter> params;
+        std::vector<Handler> handlers;
+
+        /**
+         * Numeric literals, preloaded into N[firstConstant...] on every call.
+         */
+        std::vector<NUMBER> numbers;
+        uint32_t firstConstant = 0;
+
+        /**
+         * Other literals (LoadConstant).
+         */
+        std::vector<TS::Value> values;
+
+        /**
+         * Variable and callee names, their atoms (for variable lookups) and,
+         * for dotted names and property accesses, their property paths
+         * (whose inline caches the instructions using them share).
+         */
+        std::vector<std::string> names;
+        std::vector<uint32_t> atoms;
+        std::vector<PropertyPathPtr> paths;
+
+        uint32_t numberRegisters = 0;
+        uint32_t valueRegisters = 0;
+    };
+
+    /**
+     * Compiles a user function to register bytecode.
+     * Parameters declared `number`, and locals that provably only ever hold
+     * numbers, live in unboxed N registers. Functions containing nested
+     * `function` or `class` definitions, named (unresolved) `let`s or parse
+     * errors are not compiled.
+     *
+     * @param def The function definition.
+     * @returns The bytecode, or nullptr if the body has no bytecode form.
+     */
+    std::shared_ptr<const Bytecode> compileBytecode(const FunctionDef &def);
+
+    /**
+     * Runs compiled bytecode with computed-goto dispatch (a switch on
+     * compilers without labels as values).
+     *
+     * @param code The compiled function.
+     * @param args The arguments, already checked against the parameter count.
+     * @param ctx The context of the call.
+     * @param result Receives the returned value.
+     * @returns False, without running anything, if an argument of a `number`
+     * parameter is not a number: the caller runs the call interpreted instead.
+     */
+    bool runBytecode(const Bytecode &code, Args args, Context &ctx, TS::Value &result);
+
+    // --- Shared with the tree-walking interpreter, so both tiers behave the same ---
+
+    /**
+     * Calls `name` as a call statement does: unknown callees and mismatched
+     * user function arguments are reported, and the result is discarded.
+     * `argTypes` (optional) holds the static type of each argument.
+     */
+    void callStatement(const std::string &name, uint32_t callee, Args args, Context &ctx,
+                       const DeclaredType *argTypes = nullptr);
+
+    /**
+     * Calls a call statement of a dotted name (`console.log(...)`,
+     * `p.move(...)`): the function of that name if there is one, else the
+     * method the last part names of the object the rest resolves to (see
+     * callPathMethod). `args[0]` is free for the receiver, the `argc`
+     * arguments follow it.
+     */
+    void callPathStatement(const std::string &name, uint32_t callee, const PropertyPath &path, const TS::Value *local,
+                           TS::Value *args, size_t argc, Context &ctx, TS::Environment &env, const DeclaredType *argTypes = nullptr);
+
+    /**
+     * Finds what a dotted name (`p.x.y`) refers to. The first part names a
+     * variable (`local`, the value of the local it is bound to, or else the
+     * variable of that name in `env`) and the other parts its properties.
+     * A global that is not an object leaves the variable named by the whole
+     * (`whole`, e.g. a class static "Point.origin" or "Math.PI"), or a
+     * property of the variable named by all parts but the last.
+     *
+     * @returns The value, or nullptr if there is none.
+     */
+    const TS::Value *resolvePath(const PropertyPath &path, const TS::Value *local, uint32_t whole, TS::Environment &env);
+
+    /**
+     * Assigns the property a dotted name refers to (see resolvePath),
+     * adding it to its object if it is new.
+     *
+     * @returns False if what holds the property is not an object: the
+     * caller assigns the variable named by the whole instead.
+     */
+    bool assignPath(const PropertyPath &path, const TS::Value *local, TS::Environment &env, const TS::Value &value);
+
+    /**
+     * Calls method `path.keys.back()` of `argv[0]` (the user function
+     * "ClassName.key" of its class) with the instance as `this`, followed
+     * by the rest of `argv`.
+     *
+     * @returns False, leaving `result` alone, if `argv[0]` has no such method.
+     */
+    bool callMethod(const PropertyPath &path, const TS::Value *argv, size_t argc, const CallableRegistry &callables,
+                    Context *ctx, TS::Value &result);
+
+    /**
+     * Calls a dotted name that names no function as a method: `p.move(...)`
+     * calls method `move` of the object `p` resolves to (see resolvePath),
+     * stored into `argv[0]`. The arguments follow it.
+     *
+     * @returns The result, undefined if there is no such method.
+     */
+    TS::Value callPathMethod(const PropertyPath &path, const TS::Value *local, TS::Value *argv, size_t argc,
+                             const CallableRegistry &callables, Context *ctx, TS::Environment &env);
+
+    /**
+     * Evaluates `new`: creates an instance of shape `path.shape` into
+     * `argv[0]` and calls the constructor `constructor` of its class with
+     * it, followed by the arguments.
+     *
+     * @returns The instance, or undefined if the class has no constructor.
+     */
+    TS::Value construct(const PropertyPath &path, uint32_t constructor, TS::Value *argv, size_t argc,
+                        const CallableRegistry &callables, Context *ctx);
+
+    /**
+     * Evaluates an object literal: an object of shape `path.shape` with
+     * property `path.keys[i]` set to `values[i]`.
+     */
+    TS::Value objectLiteral(const PropertyPath &path, const TS::Value *values, size_t count);
+
+} // namespace Interpreter
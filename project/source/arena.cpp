@@ -0,0 +1,128 @@
+// arena.cpp
+#include "arena.h"
+#include <cstdint>
+#include <new>
+
+namespace TS
+{
+    namespace
+    {
+        constexpr size_t kHeaderAlign = alignof(std::max_align_t);
+
+        inline uintptr_t alignUp(uintptr_t p, size_t alignment)
+        {
+            return (p + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1);
+        }
+
+        // Chunk memory starts right after the header
+        inline char *dataOf(void *chunk, size_t headerSize)
+        {
+            return static_cast<char *>(chunk) + headerSize;
+        }
+    } // namespace
+
+    Arena::Arena(std::pmr::memory_resource *upstream, size_t chunkSize)
+        : source(upstream), chunkSize(chunkSize)
+    {
+    }
+
+    Arena::Arena(void *buffer, size_t size, std::pmr::memory_resource *upstream, size_t chunkSize)
+        : source(upstream), chunkSize(chunkSize)
+    {
+        uintptr_t start = alignUp(reinterpret_cast<uintptr_t>(buffer), alignof(Chunk));
+        uintptr_t end = reinterpret_cast<uintptr_t>(buffer) + size;
+        if (buffer && start + sizeof(Chunk) < end)
+        {
+            head = ::new (reinterpret_cast<void *>(start)) Chunk{nullptr, end - start - sizeof(Chunk), false};
+            current = head;
+        }
+    }
+
+    Arena::~Arena()
+    {
+        reset();
+        shrink();
+    }
+
+    void *Arena::do_allocate(size_t bytes, size_t alignment)
+    {
+        for (;;)
+        {
+            if (current)
+            {
+                char *base = dataOf(current, sizeof(Chunk));
+                uintptr_t p = alignUp(reinterpret_cast<uintptr_t>(base) + used, alignment);
+                if (p + bytes <= reinterpret_cast<uintptr_t>(base) + current->size)
+                {
+                    used = p + bytes - reinterpret_cast<uintptr_t>(base);
+                    return reinterpret_cast<void *>(p);
+                }
+            }
+
+            // Move on to the next cached chunk if the request fits there...
+            Chunk *next = current ? current->next : head;
+            if (next && next->size >= bytes + alignment)
+            {
+                current = next;
+                used = 0;
+                continue;
+            }
+
+            // ...or get a new one from upstream and link it in before it
+            size_t size = bytes + alignment > chunkSize ? bytes + alignment : chunkSize;
+            void *memory = source->allocate(sizeof(Chunk) + size, kHeaderAlign);
+            Chunk *chunk = ::new (memory) Chunk{next, size, true};
+            if (current)
+                current->next = chunk;
+            else
+                head = chunk;
+            current = chunk;
+            used = 0;
+        }
+    }
+
+    void Arena::do_deallocate(void *p, size_t bytes, size_t)
+    {
+        // Only the most recent allocation can be taken back individually
+        // (this is what lets a growing vector reuse its old block)
+        if (!current)
+            return;
+        char *base = dataOf(current, sizeof(Chunk));
+        if (static_cast<char *>(p) + bytes == base + used && static_cast<char *>(p) >= base)
+            used = static_cast<size_t>(static_cast<char *>(p) - base);
+    }
+
+    void Arena::shrink()
+    {
+        Chunk *kept = head && !head->owned ? head : nullptr;
+        Chunk *chunk = kept ? head->next : head;
+        while (chunk)
+        {
+            Chunk *next = chunk->next;
+            size_t size = chunk->size;
+            chunk->~Chunk();
+            source->deallocate(chunk, sizeof(Chunk) + size, kHeaderAlign);
+            chunk = next;
+        }
+        if (kept)
+            kept->next = nullptr;
+        head = kept;
+        current = kept;
+        used = 0;
+    }
+
+    void Arena::setUpstream(std::pmr::memory_resource *resource)
+    {
+        shrink();
+        source = resource ? resource : std::pmr::get_default_resource();
+    }
+
+    size_t Arena::capacity() const
+    {
+        size_t total = 0;
+        for (const Chunk *chunk = head; chunk; chunk = chunk->next)
+            total += chunk->size;
+        return total;
+    }
+
+} // namespace TS
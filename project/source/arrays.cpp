@@ -0,0 +1,466 @@
+// arrays.cpp
+#include "arrays.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace TS
+{
+    namespace
+    {
+        constexpr NUMBER kNaN = std::numeric_limits<NUMBER>::quiet_NaN();
+
+        // Element access shared by every array kind
+        inline NUMBER load(const Value &v) { return v.toNumber(); }
+        inline NUMBER load(double v) { return static_cast<NUMBER>(v); }
+        inline NUMBER load(float v) { return static_cast<NUMBER>(v); }
+        inline void store(Value &out, NUMBER v) { out = Value(v); }
+        inline void store(double &out, NUMBER v) { out = static_cast<double>(v); }
+        inline void store(float &out, NUMBER v) { out = static_cast<float>(v); }
+#ifdef ADD_STD_HALF
+        inline NUMBER load(const half &v) { return static_cast<NUMBER>(static_cast<float>(v)); }
+        inline void store(half &out, NUMBER v) { out = half(static_cast<float>(v)); }
+#endif
+
+        // Calls fn with the element vector of `array`; returns false if it is not an array
+        template <typename Fn>
+        bool visitElements(const Value &array, Fn &&fn)
+        {
+            switch (array.type)
+            {
+            case ValueType::Array:
+                fn(array.asArray());
+                return true;
+            case ValueType::Float64Array:
+                fn(array.asFloat64Array());
+                return true;
+            case ValueType::Float32Array:
+                fn(array.asFloat32Array());
+                return true;
+            case ValueType::Float16Array:
+                fn(array.asFloat16Array());
+                return true;
+            default:
+                return false;
+            }
+        }
+
+        NUMBER applyUnary(Simd::Unary op, NUMBER x)
+        {
+            switch (op)
+            {
+            case Simd::Unary::Sqrt:
+                return std::sqrt(x);
+            case Simd::Unary::Abs:
+                return std::fabs(x);
+            case Simd::Unary::Floor:
+                return std::floor(x);
+            case Simd::Unary::Sin:
+                return std::sin(x);
+            case Simd::Unary::Cos:
+                return std::cos(x);
+            }
+            return kNaN;
+        }
+
+        NUMBER applyBinary(Simd::Binary op, NUMBER a, NUMBER b)
+        {
+            switch (op)
+            {
+            case Simd::Binary::Add:
+                return a + b;
+            case Simd::Binary::Sub:
+                return a - b;
+            case Simd::Binary::Mul:
+                return a * b;
+            case Simd::Binary::Div:
+                return a / b;
+            }
+            return kNaN;
+        }
+
+        // Typed arrays of one kind can share a kernel call
+        inline bool sameTypedKind(const Value &a, const Value &b)
+        {
+            return a.type == b.type && a.type != ValueType::Array && a.isArray();
+        }
+
+#ifdef ADD_STD_HALF
+        constexpr size_t kHalfChunk = 256;
+
+        // Streams Float16Array elements through float chunks: fn(x, y, count)
+        // gets the converted chunk of `a` (and of `b`, when given) and may
+        // modify x, which is converted back into `out` when given.
+        template <typename Fn>
+        void halfChunks(const half *a, const half *b, half *out, size_t n, Fn &&fn)
+        {
+            float x[kHalfChunk];
+            float y[kHalfChunk];
+            for (size_t offset = 0; offset < n; offset += kHalfChunk)
+            {
+                size_t count = std::min(kHalfChunk, n - offset);
+                half::toFloats(a + offset, x, count);
+                if (b)
+                    half::toFloats(b + offset, y, count);
+                fn(x, static_cast<const float *>(y), count);
+                if (out)
+                    half::fromFloats(x, out + offset, count);
+            }
+        }
+#endif
+
+        // Reductions of min and max share the NaN and empty rules
+        template <bool Max>
+        NUMBER extreme(const Value &array)
+        {
+            size_t n = array.length();
+            switch (array.type)
+            {
+            case ValueType::Float64Array:
+                return static_cast<NUMBER>(Max ? Simd::max(array.asFloat64Array().data(), n)
+                                               : Simd::min(array.asFloat64Array().data(), n));
+            case ValueType::Float32Array:
+                return static_cast<NUMBER>(Max ? Simd::max(array.asFloat32Array().data(), n)
+                                               : Simd::min(array.asFloat32Array().data(), n));
+#ifdef ADD_STD_HALF
+            case ValueType::Float16Array:
+            {
+                double best = Max ? -INFINITY : INFINITY;
+                halfChunks(array.asFloat16Array().data(), nullptr, nullptr, n, [&best](float *x, const float *, size_t count)
+                           {
+                               double r = Max ? Simd::max(x, count) : Simd::min(x, count);
+                               best = std::isnan(r) || std::isnan(best) ? kNaN : (Max ? std::max(best, r) : std::min(best, r)); });
+                return static_cast<NUMBER>(best);
+            }
+#endif
+            case ValueType::Array:
+            {
+                NUMBER best = Max ? -INFINITY : INFINITY;
+                for (const Value &e : array.asArray())
+                {
+                    NUMBER x = e.toNumber();
+                    if (std::isnan(x))
+                        return kNaN;
+                    best = Max ? std::max(best, x) : std::min(best, x);
+                }
+                return best;
+            }
+            default:
+                return kNaN;
+            }
+        }
+    } // namespace
+
+    Value makeArrayFrom(ValueType type, const Value &source)
+    {
+        if (!source.isArray())
+        {
+            NUMBER n = source.toNumber();
+            size_t length = n > 0 ? static_cast<size_t>(n) : 0;
+            return Value::makeTypedArray(type, length);
+        }
+
+        if (type == ValueType::Array)
+        {
+            std::vector<Value> elements;
+            elements.reserve(source.length());
+            for (size_t i = 0; i < source.length(); ++i)
+                elements.push_back(source.at(i));
+            return Value::makeArray(std::move(elements));
+        }
+
+        Value out = Value::makeTypedArray(type, source.length());
+        size_t n = source.length();
+        switch (source.type == type ? type : ValueType::Null)
+        {
+        case ValueType::Float64Array:
+            out.asFloat64Array() = source.asFloat64Array();
+            return out;
+        case ValueType::Float32Array:
+            out.asFloat32Array() = source.asFloat32Array();
+            return out;
+        case ValueType::Float16Array:
+            out.asFloat16Array() = source.asFloat16Array();
+            return out;
+        default:
+            break;
+        }
+#ifdef ADD_STD_HALF
+        // fp16 <-> fp32 goes through the batch conversions
+        if (type == ValueType::Float16Array && source.type == ValueType::Float32Array)
+        {
+            half::fromFloats(source.asFloat32Array().data(), out.asFloat16Array().data(), n);
+            return out;
+        }
+        if (type == ValueType::Float32Array && source.type == ValueType::Float16Array)
+        {
+            half::toFloats(source.asFloat16Array().data(), out.asFloat32Array().data(), n);
+            return out;
+        }
+#endif
+        visitElements(out, [&source, n](auto &dst)
+                      { visitElements(source, [&dst, n](auto &src)
+                                      {
+                                          for (size_t i = 0; i < n; ++i)
+                                              store(dst[i], load(src[i])); }); });
+        return out;
+    }
+
+    Value copyArray(const Value &array)
+    {
+        if (!array.isArray())
+            return Value();
+        return makeArrayFrom(array.type, array);
+    }
+
+    void fillArray(const Value &array, const Value &value)
+    {
+        switch (array.type)
+        {
+        case ValueType::Array:
+        {
+            std::vector<Value> &elements = array.asArray();
+            Value element = value; // `value` may be one of the elements
+            std::fill(elements.begin(), elements.end(), element);
+            break;
+        }
+        // Convert once, then fill the raw storage
+        case ValueType::Float64Array:
+            std::fill(array.asFloat64Array().begin(), array.asFloat64Array().end(), static_cast<double>(value.toNumber()));
+            break;
+        case ValueType::Float32Array:
+            std::fill(array.asFloat32Array().begin(), array.asFloat32Array().end(), static_cast<float>(value.toNumber()));
+            break;
+        case ValueType::Float16Array:
+            std::fill(array.asFloat16Array().begin(), array.asFloat16Array().end(), _half(static_cast<float>(value.toNumber())));
+            break;
+        default:
+            break;
+        }
+    }
+
+    NUMBER sumArray(const Value &array)
+    {
+        size_t n = array.length();
+        switch (array.type)
+        {
+        case ValueType::Float64Array:
+            return static_cast<NUMBER>(Simd::sum(array.asFloat64Array().data(), n));
+        case ValueType::Float32Array:
+            return static_cast<NUMBER>(Simd::sum(array.asFloat32Array().data(), n));
+#ifdef ADD_STD_HALF
+        case ValueType::Float16Array:
+        {
+            double total = 0;
+            halfChunks(array.asFloat16Array().data(), nullptr, nullptr, n, [&total](float *x, const float *, size_t count)
+                       { total += Simd::sum(x, count); });
+            return static_cast<NUMBER>(total);
+        }
+#endif
+        case ValueType::Array:
+        {
+            NUMBER total = 0;
+            for (const Value &e : array.asArray())
+                total += e.toNumber();
+            return total;
+        }
+        default:
+            return kNaN;
+        }
+    }
+
+    NUMBER dotArrays(const Value &a, const Value &b)
+    {
+        size_t n = std::min(a.length(), b.length());
+        if (sameTypedKind(a, b))
+        {
+            switch (a.type)
+            {
+            case ValueType::Float64Array:
+                return static_cast<NUMBER>(Simd::dot(a.asFloat64Array().data(), b.asFloat64Array().data(), n));
+            case ValueType::Float32Array:
+                return static_cast<NUMBER>(Simd::dot(a.asFloat32Array().data(), b.asFloat32Array().data(), n));
+#ifdef ADD_STD_HALF
+            case ValueType::Float16Array:
+            {
+                double total = 0;
+                halfChunks(a.asFloat16Array().data(), b.asFloat16Array().data(), nullptr, n, [&total](float *x, const float *y, size_t count)
+                           { total += Simd::dot(x, y, count); });
+                return static_cast<NUMBER>(total);
+            }
+#endif
+            default:
+                break;
+            }
+        }
+
+        NUMBER total = 0;
+        bool bothArrays = false;
+        visitElements(a, [&](auto &x)
+                      { bothArrays = visitElements(b, [&](auto &y)
+                                                   {
+                                                       for (size_t i = 0; i < n; ++i)
+                                                           total += load(x[i]) * load(y[i]); }); });
+        return bothArrays ? total : kNaN;
+    }
+
+    void scaleArray(const Value &array, NUMBER factor)
+    {
+        size_t n = array.length();
+        switch (array.type)
+        {
+        case ValueType::Float64Array:
+            Simd::scale(array.asFloat64Array().data(), static_cast<double>(factor), n);
+            break;
+        case ValueType::Float32Array:
+            Simd::scale(array.asFloat32Array().data(), static_cast<float>(factor), n);
+            break;
+#ifdef ADD_STD_HALF
+        case ValueType::Float16Array:
+        {
+            half *data = array.asFloat16Array().data();
+            halfChunks(data, nullptr, data, n, [factor](float *x, const float *, size_t count)
+                       { Simd::scale(x, static_cast<float>(factor), count); });
+            break;
+        }
+#endif
+        case ValueType::Array:
+            for (Value &e : array.asArray())
+                e = Value(e.toNumber() * factor);
+            break;
+        default:
+            break;
+        }
+    }
+
+    void addArrays(const Value &dst, const Value &src)
+    {
+        size_t n = std::min(dst.length(), src.length());
+        if (sameTypedKind(dst, src))
+        {
+            switch (dst.type)
+            {
+            case ValueType::Float64Array:
+            {
+                double *d = dst.asFloat64Array().data();
+                Simd::combine(Simd::Binary::Add, d, src.asFloat64Array().data(), d, n);
+                return;
+            }
+            case ValueType::Float32Array:
+            {
+                float *d = dst.asFloat32Array().data();
+                Simd::combine(Simd::Binary::Add, d, src.asFloat32Array().data(), d, n);
+                return;
+            }
+#ifdef ADD_STD_HALF
+            case ValueType::Float16Array:
+            {
+                half *d = dst.asFloat16Array().data();
+                halfChunks(d, src.asFloat16Array().data(), d, n, [](float *x, const float *y, size_t count)
+                           { Simd::combine(Simd::Binary::Add, x, y, x, count); });
+                return;
+            }
+#endif
+            default:
+                break;
+            }
+        }
+
+        visitElements(dst, [&src, n](auto &x)
+                      { visitElements(src, [&x, n](auto &y)
+                                      {
+                                          for (size_t i = 0; i < n; ++i)
+                                              store(x[i], load(x[i]) + load(y[i])); }); });
+    }
+
+    NUMBER minArray(const Value &array) { return extreme<false>(array); }
+    NUMBER maxArray(const Value &array) { return extreme<true>(array); }
+
+    Value mapArray(Simd::Unary op, const Value &array)
+    {
+        if (!array.isArray())
+            return Value();
+        size_t n = array.length();
+        Value out = Value::makeTypedArray(array.type, n);
+        switch (array.type)
+        {
+        case ValueType::Float64Array:
+            Simd::map(op, array.asFloat64Array().data(), out.asFloat64Array().data(), n);
+            break;
+        case ValueType::Float32Array:
+            Simd::map(op, array.asFloat32Array().data(), out.asFloat32Array().data(), n);
+            break;
+#ifdef ADD_STD_HALF
+        case ValueType::Float16Array:
+            halfChunks(array.asFloat16Array().data(), nullptr, out.asFloat16Array().data(), n, [op](float *x, const float *, size_t count)
+                       { Simd::map(op, x, x, count); });
+            break;
+#endif
+        default:
+            for (size_t i = 0; i < n; ++i)
+                out.asArray()[i] = Value(applyUnary(op, array.asArray()[i].toNumber()));
+            break;
+        }
+        return out;
+    }
+
+    Value powArray(const Value &array, NUMBER exponent)
+    {
+        if (!array.isArray())
+            return Value();
+        size_t n = array.length();
+        Value out = Value::makeTypedArray(array.type, n);
+        switch (array.type)
+        {
+        case ValueType::Float64Array:
+            Simd::pow(array.asFloat64Array().data(), static_cast<double>(exponent), out.asFloat64Array().data(), n);
+            break;
+        case ValueType::Float32Array:
+            Simd::pow(array.asFloat32Array().data(), static_cast<float>(exponent), out.asFloat32Array().data(), n);
+            break;
+#ifdef ADD_STD_HALF
+        case ValueType::Float16Array:
+            halfChunks(array.asFloat16Array().data(), nullptr, out.asFloat16Array().data(), n, [exponent](float *x, const float *, size_t count)
+                       { Simd::pow(x, static_cast<float>(exponent), x, count); });
+            break;
+#endif
+        default:
+            for (size_t i = 0; i < n; ++i)
+                out.asArray()[i] = Value(static_cast<NUMBER>(std::pow(array.asArray()[i].toNumber(), exponent)));
+            break;
+        }
+        return out;
+    }
+
+    Value combineArrays(Simd::Binary op, const Value &a, const Value &b)
+    {
+        if (!a.isArray() || !b.isArray())
+            return Value();
+        size_t n = std::min(a.length(), b.length());
+        Value out = Value::makeTypedArray(a.type, n);
+        if (sameTypedKind(a, b))
+        {
+            switch (a.type)
+            {
+            case ValueType::Float64Array:
+                Simd::combine(op, a.asFloat64Array().data(), b.asFloat64Array().data(), out.asFloat64Array().data(), n);
+                return out;
+            case ValueType::Float32Array:
+                Simd::combine(op, a.asFloat32Array().data(), b.asFloat32Array().data(), out.asFloat32Array().data(), n);
+                return out;
+#ifdef ADD_STD_HALF
+            case ValueType::Float16Array:
+                halfChunks(a.asFloat16Array().data(), b.asFloat16Array().data(), out.asFloat16Array().data(), n, [op](float *x, const float *y, size_t count)
+                           { Simd::combine(op, x, y, x, count); });
+                return out;
+#endif
+            default:
+                break;
+            }
+        }
+        for (size_t i = 0; i < n; ++i)
+            out.setAt(i, Value(applyBinary(op, a.at(i).toNumber(), b.at(i).toNumber())));
+        return out;
+    }
+
+} // namespace TS
@@ -0,0 +1,1457 @@
+// compiler.cpp
+#include "compiler.h"
+#include "interpreter.h"
+#include "lexer.h"
+#include "optimizer.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <atomic>
+#include <limits>
+#include <mutex>
+#include <shared_mutex>
+#include <string_view>
+#include <unordered_map>
+
+namespace Interpreter
+{
+    namespace
+    {
+        std::string_view trim(std::string_view s)
+        {
+            auto start = s.find_first_not_of(" \t\r\n");
+            auto end = s.find_last_not_of(" \t\r\n");
+            if (start == std::string_view::npos)
+                return {};
+            return s.substr(start, end - start + 1);
+        }
+
+        std::string_view stripSemicolon(std::string_view s)
+        {
+            s = trim(s);
+            if (!s.empty() && s.back() == ';')
+                s.remove_suffix(1);
+            return trim(s);
+        }
+
+        // Finds the ')' (or ']') matching the '(' (or '[') at `open`, skipping string literals.
+        size_t findMatchingParen(std::string_view s, size_t open)
+        {
+            const char openChar = s[open];
+            const char closeChar = openChar == '[' ? ']' : ')';
+            int depth = 0;
+            char quote = '\0';
+            for (size_t i = open; i < s.size(); ++i)
+            {
+                char c = s[i];
+                if (quote)
+                {
+                    if (c == quote && s[i - 1] != '\\')
+                        quote = '\0';
+                    continue;
+                }
+                if (c == '"' || c == '\'')
+                    quote = c;
+                else if (c == openChar)
+                    depth++;
+                else if (c == closeChar && --depth == 0)
+                    return i;
+            }
+            return std::string_view::npos;
+        }
+
+        // Position of the first '}' that closes more braces than the line opened.
+        size_t findUnmatchedClose(std::string_view s)
+        {
+            int depth = 0;
+            char quote = '\0';
+            for (size_t i = 0; i < s.size(); ++i)
+            {
+                char c = s[i];
+                if (quote)
+                {
+                    if (c == quote && s[i - 1] != '\\')
+                        quote = '\0';
+                    continue;
+                }
+                if (c == '"' || c == '\'')
+                    quote = c;
+                else if (c == '/' && i + 1 < s.size() && s[i + 1] == '/')
+                    break;
+                else if (c == '{')
+                    depth++;
+                else if (c == '}' && --depth < 0)
+                    return i;
+            }
+            return std::string_view::npos;
+        }
+
+        bool isKeyword(std::string_view line, std::string_view keyword)
+        {
+            size_t n = keyword.size();
+            if (line.substr(0, n) != keyword)
+                return false;
+            return line.size() == n || !(std::isalnum(static_cast<unsigned char>(line[n])) || line[n] == '_');
+        }
+
+        bool startsWith(std::string_view line, std::string_view prefix)
+        {
+            return line.substr(0, prefix.size()) == prefix;
+        }
+
+        // Splits "a, f(b, c), 'd,e'" into top-level comma separated parts.
+        // The parts are views into `argsStr`.
+        std::vector<std::string_view> splitArguments(std::string_view argsStr)
+        {
+            std::vector<std::string_view> args;
+            size_t argStart = 0;
+            bool inString = false;
+            char stringChar = '\0';
+            int parenDepth = 0;
+
+            for (size_t i = 0; i < argsStr.size(); ++i)
+            {
+                char c = argsStr[i];
+
+                if ((c == '"' || c == '\'') && !inString)
+                {
+                    inString = true;
+                    stringChar = c;
+                }
+                else if (inString && c == stringChar)
+                    inString = false;
+                else if (!inString && (c == '(' || c == '[' || c == '{'))
+                    parenDepth++;
+                else if (!inString && (c == ')' || c == ']' || c == '}'))
+                    parenDepth--;
+                else if (!inString && parenDepth == 0 && c == ',')
+                {
+                    // End of argument
+                    std::string_view argTrimmed = trim(argsStr.substr(argStart, i - argStart));
+                    if (!argTrimmed.empty())
+                        args.push_back(argTrimmed);
+                    argStart = i + 1;
+                }
+            }
+
+            // Last argument (if any)
+            std::string_view argTrimmed = trim(argsStr.substr(argStart));
+            if (!argTrimmed.empty())
+                args.push_back(argTrimmed);
+            return args;
+        }
+
+        struct OperatorInfo
+        {
+            OpCode op;
+            int precedence;
+            bool rightAssoc;
+        };
+
+        // Binary operator table, highest precedence first
+        bool binaryOperator(std::string_view tok, OperatorInfo &info)
+        {
+            static const std::unordered_map<std::string_view, OperatorInfo> table = {
+                {"**", {OpCode::Pow, 7, true}}, // Exponentiation
+                {"*", {OpCode::Mul, 6, false}}, // Multiplicative
+                {"/", {OpCode::Div, 6, false}},
+                {"%", {OpCode::Mod, 6, false}},
+                {"+", {OpCode::Add, 5, false}}, // Additive
+                {"-", {OpCode::Sub, 5, false}},
+                {"<", {OpCode::Lt, 4, false}}, // Relational
+                {">", {OpCode::Gt, 4, false}},
+                {"<=", {OpCode::Le, 4, false}},
+                {">=", {OpCode::Ge, 4, false}},
+                {"==", {OpCode::Eq, 3, false}}, // Equality
+                {"!=", {OpCode::Ne, 3, false}},
+                {"===", {OpCode::StrictEq, 3, false}},
+                {"!==", {OpCode::StrictNe, 3, false}},
+                {"&&", {OpCode::And, 2, false}}, // Logical AND
+                {"||", {OpCode::Or, 1, false}},  // Logical OR
+            };
+            auto it = table.find(tok);
+            if (it == table.end())
+                return false;
+            info = it->second;
+            return true;
+        }
+
+        bool unaryOperator(std::string_view tok, OperatorInfo &info)
+        {
+            if (tok == "-")
+                info = {OpCode::Neg, 8, true};
+            else if (tok == "+")
+                info = {OpCode::Plus, 8, true};
+            else if (tok == "!")
+                info = {OpCode::Not, 8, true};
+            else
+                return false;
+            return true;
+        }
+
+        std::string unescape(std::string_view literal)
+        {
+            std::string out;
+            out.reserve(literal.size());
+            // Strip surrounding quotes (an unterminated literal has only the opening one)
+            size_t end = literal.size() > 1 && literal.back() == literal.front() ? literal.size() - 1 : literal.size();
+            for (size_t i = 1; i < end; ++i)
+            {
+                char c = literal[i];
+                if (c != '\\' || i + 1 >= end)
+                {
+                    out.push_back(c);
+                    continue;
+                }
+                switch (char e = literal[++i])
+                {
+                case 'n':
+                    out.push_back('\n');
+                    break;
+                case 't':
+                    out.push_back('\t');
+                    break;
+                case 'r':
+                    out.push_back('\r');
+                    break;
+                case '0':
+                    out.push_back('\0');
+                    break;
+                default:
+                    out.push_back(e);
+                    break;
+                }
+            }
+            return out;
+        }
+
+        // --- Shunting Yard with function call support ---
+        std::shared_ptr<Expression> compileRpn(std::string_view source)
+        {
+            auto expr = std::make_shared<Expression>();
+            expr->source = std::string(source);
+            std::vector<RpnToken> &output = expr->code;
+
+            struct Pending
+            {
+                enum Kind : uint8_t
+                {
+                    Op,
+                    Paren,
+                    Func,   // `name(`
+                    Method, // `.name(` after an operand
+                    New,    // `new name(`
+                    Bracket,
+                    Brace   // object literal
+                } kind;
+                OperatorInfo info;
+                std::string name; // Func, Method and New; Brace: the keys so far, comma separated
+                uint32_t argc;    // Paren of a call, Bracket of an array literal, Brace
+                bool call;        // Paren opened right after a function name, Bracket of an index
+            };
+            std::vector<Pending> ops;
+
+            auto callee = [&ops]()
+            {
+                return !ops.empty() && (ops.back().kind == Pending::Func || ops.back().kind == Pending::Method ||
+                                        ops.back().kind == Pending::New);
+            };
+
+            auto emitOp = [&output](OpCode op)
+            {
+                RpnToken t;
+                t.kind = TokenKind::Operator;
+                t.op = op;
+                output.push_back(std::move(t));
+            };
+            auto emitLiteral = [&output](TS::Value v)
+            {
+                RpnToken t;
+                t.kind = TokenKind::Literal;
+                t.value = std::move(v);
+                output.push_back(std::move(t));
+            };
+
+            std::vector<TS::Token> tokens = TS::lex(source);
+            bool expectOperand = true;
+
+            // Reads the key after the `{` or `,` at tokens[i] of an object
+            // literal (`key: value`, or `key` alone for `key: key`)
+            auto objectKey = [&](size_t i)
+            {
+                if (i + 1 >= tokens.size())
+                    return i;
+                const TS::Token &key = tokens[i + 1];
+                bool named = i + 2 < tokens.size() && tokens[i + 2].is(":");
+                bool shorthand = key.type == TS::TokenType::Identifier &&
+                                 (i + 2 >= tokens.size() || tokens[i + 2].is(",") || tokens[i + 2].is("}"));
+                if ((key.type != TS::TokenType::Identifier && key.type != TS::TokenType::String) || (!named && !shorthand))
+                    return i;
+                Pending &brace = ops.back();
+                if (brace.argc++ > 0)
+                    brace.name += ',';
+                brace.name += key.type == TS::TokenType::String ? unescape(key.text) : std::string(key.text);
+                if (named)
+                    return i + 2;
+                RpnToken t;
+                t.kind = TokenKind::Variable;
+                t.name = key.text;
+                linkToken(t);
+                output.push_back(std::move(t));
+                return i + 1;
+            };
+
+            for (size_t i = 0; i < tokens.size(); ++i)
+            {
+                std::string_view tok = tokens[i].text;
+                OperatorInfo info;
+
+                if (tokens[i].type == TS::TokenType::Number)
+                {
+                    emitLiteral(TS::Value(TS::parseNumber(tok)));
+                    expectOperand = false;
+                }
+                else if (tokens[i].type == TS::TokenType::String)
+                {
+                    emitLiteral(TS::Value(unescape(tok)));
+                    expectOperand = false;
+                }
+                else if (tokens[i].type == TS::TokenType::Identifier)
+                {
+                    // `new Name(args)`
+                    if (tok == "new" && i + 2 < tokens.size() && tokens[i + 1].type == TS::TokenType::Identifier && tokens[i + 2].is("("))
+                    {
+                        ops.push_back({Pending::New, {}, std::string(tokens[i + 1].text), 0, false});
+                        ++i;
+                        continue;
+                    }
+                    // Function call detection: identifier followed by '('
+                    if (i + 1 < tokens.size() && tokens[i + 1].is("("))
+                    {
+                        ops.push_back({Pending::Func, {}, std::string(tok), 0, false});
+                        continue;
+                    }
+                    // `name.length` reads the length of `name`
+                    constexpr std::string_view lengthSuffix = ".length";
+                    if (tok.size() > lengthSuffix.size() && tok.substr(tok.size() - lengthSuffix.size()) == lengthSuffix)
+                    {
+                        RpnToken t;
+                        t.kind = TokenKind::Variable;
+                        t.name = tok.substr(0, tok.size() - lengthSuffix.size());
+                        linkToken(t);
+                        output.push_back(std::move(t));
+                        emitOp(OpCode::Length);
+                    }
+                    else if (tok == "true")
+                        emitLiteral(TS::Value(true));
+                    else if (tok == "false")
+                        emitLiteral(TS::Value(false));
+                    else if (tok == "undefined" || tok == "null")
+                        emitLiteral(TS::Value());
+                    else if (tok == "NaN")
+                        emitLiteral(TS::Value(std::numeric_limits<NUMBER>::quiet_NaN()));
+                    else
+                    {
+                        RpnToken t;
+                        t.kind = TokenKind::Variable;
+                        t.name = tok;
+                        linkToken(t);
+                        output.push_back(std::move(t));
+                    }
+                    expectOperand = false;
+                }
+                else if (tok == "(")
+                {
+                    bool call = callee();
+                    bool empty = i + 1 < tokens.size() && tokens[i + 1].is(")");
+                    ops.push_back({Pending::Paren, {}, "", call && !empty ? 1u : 0u, call});
+                    expectOperand = true;
+                }
+                else if (tok == "[")
+                {
+                    // An index after an operand, otherwise an array literal
+                    bool index = !expectOperand;
+                    bool empty = i + 1 < tokens.size() && tokens[i + 1].is("]");
+                    ops.push_back({Pending::Bracket, {}, "", !index && !empty ? 1u : 0u, index});
+                    expectOperand = true;
+                }
+                else if (tok == "]")
+                {
+                    while (!ops.empty() && ops.back().kind == Pending::Op)
+                    {
+                        emitOp(ops.back().info.op);
+                        ops.pop_back();
+                    }
+                    if (ops.empty() || ops.back().kind != Pending::Bracket)
+                        continue;
+                    Pending bracket = ops.back();
+                    ops.pop_back();
+                    if (bracket.call)
+                        emitOp(OpCode::Index);
+                    else
+                    {
+                        RpnToken t;
+                        t.kind = TokenKind::Array;
+                        t.argc = bracket.argc;
+                        output.push_back(std::move(t));
+                    }
+                    expectOperand = false;
+                }
+                else if (tok == "{" && expectOperand)
+                {
+                    // Object literal: {key: value, ...}
+                    ops.push_back({Pending::Brace, {}, "", 0, false});
+                    i = objectKey(i);
+                }
+                else if (tok == "}")
+                {
+                    while (!ops.empty() && ops.back().kind == Pending::Op)
+                    {
+                        emitOp(ops.back().info.op);
+                        ops.pop_back();
+                    }
+                    if (ops.empty() || ops.back().kind != Pending::Brace)
+                        continue;
+                    RpnToken t;
+                    t.kind = TokenKind::Object;
+                    t.name = std::move(ops.back().name);
+                    t.argc = ops.back().argc;
+                    linkToken(t);
+                    output.push_back(std::move(t));
+                    ops.pop_back();
+                    expectOperand = false;
+                }
+                else if (tok == "." && !expectOperand && i + 1 < tokens.size() && tokens[i + 1].type == TS::TokenType::Identifier)
+                {
+                    // Properties of any operand: `f(x).y`, `a[i].length`, `p.next().x`
+                    std::string_view parts = tokens[++i].text;
+                    bool call = i + 1 < tokens.size() && tokens[i + 1].is("(");
+                    while (true)
+                    {
+                        size_t dot = parts.find('.');
+                        std::string_view key = parts.substr(0, dot);
+                        if (dot == std::string_view::npos && call)
+                        {
+                            ops.push_back({Pending::Method, {}, std::string(key), 0, false});
+                            break;
+                        }
+                        if (key == "length")
+                            emitOp(OpCode::Length);
+                        else
+                        {
+                            RpnToken t;
+                            t.kind = TokenKind::Member;
+                            t.name = key;
+                            linkToken(t);
+                            output.push_back(std::move(t));
+                        }
+                        if (dot == std::string_view::npos)
+                            break;
+                        parts = parts.substr(dot + 1);
+                    }
+                }
+                else if (tok == ",")
+                {
+                    // Pop until left paren (or bracket)
+                    while (!ops.empty() && ops.back().kind == Pending::Op)
+                    {
+                        emitOp(ops.back().info.op);
+                        ops.pop_back();
+                    }
+                    if (!ops.empty() && (ops.back().kind == Pending::Paren || ops.back().kind == Pending::Bracket))
+                        ops.back().argc++;
+                    else if (!ops.empty() && ops.back().kind == Pending::Brace)
+                        i = objectKey(i);
+                    expectOperand = true;
+                }
+                else if (tok == ")")
+                {
+                    while (!ops.empty() && ops.back().kind == Pending::Op)
+                    {
+                        emitOp(ops.back().info.op);
+                        ops.pop_back();
+                    }
+                    if (ops.empty() || ops.back().kind != Pending::Paren)
+                        continue;
+                    Pending paren = ops.back();
+                    ops.pop_back();
+
+                    // If the paren belonged to a call, emit it with its arg count
+                    if (paren.call && callee())
+                    {
+                        RpnToken t;
+                        t.kind = ops.back().kind == Pending::Method ? TokenKind::Method
+                                 : ops.back().kind == Pending::New  ? TokenKind::New
+                                                                    : TokenKind::Call;
+                        t.name = ops.back().name;
+                        t.argc = paren.argc;
+                        linkToken(t);
+                        output.push_back(std::move(t));
+                        ops.pop_back();
+                    }
+                    expectOperand = false;
+                }
+                else if (expectOperand && unaryOperator(tok, info))
+                {
+                    ops.push_back({Pending::Op, info, "", 0, false});
+                }
+                else if (binaryOperator(tok, info))
+                {
+                    while (!ops.empty() && ops.back().kind == Pending::Op &&
+                           (ops.back().info.precedence > info.precedence ||
+                            (ops.back().info.precedence == info.precedence && !info.rightAssoc)))
+                    {
+                        emitOp(ops.back().info.op);
+                        ops.pop_back();
+                    }
+                    ops.push_back({Pending::Op, info, "", 0, false});
+                    expectOperand = true;
+                }
+                // Anything else (stray '=', ';', ...) is ignored
+            }
+            while (!ops.empty())
+            {
+                if (ops.back().kind == Pending::Op)
+                    emitOp(ops.back().info.op);
+                ops.pop_back();
+            }
+            return expr;
+        }
+
+        // Lets the cache be probed with a string_view into the source buffer
+        struct TextHash
+        {
+            using is_transparent = void;
+            size_t operator()(std::string_view text) const { return std::hash<std::string_view>{}(text); }
+        };
+
+        // Shared by every runtime in the process: lookups take a shared lock,
+        // only inserting a new expression takes it exclusively
+        struct ExpressionCache
+        {
+            std::unordered_map<std::string, ExpressionPtr, TextHash, std::equal_to<>> entries;
+            std::atomic<uint64_t> hits{0};
+            std::atomic<uint64_t> misses{0};
+            std::shared_mutex lock;
+        };
+
+        ExpressionCache &expressionCache()
+        {
+            static ExpressionCache cache;
+            return cache;
+        }
+
+        using SlotMap = std::unordered_map<std::string, int32_t>;
+
+        // The local a name reads: the first part of a dotted name (`p` of `p.x`)
+        SlotMap::const_iterator findLocal(const SlotMap &slots, const std::string &name, bool dotted)
+        {
+            return slots.find(dotted ? name.substr(0, name.find('.')) : name);
+        }
+
+        // Assigns a slot to every `let` of a function body (function scoped).
+        void collectLocals(const Block &body, SlotMap &slots)
+        {
+            for (auto &stmt : body)
+            {
+                if (stmt.kind == StatementKind::Let)
+                    slots.emplace(stmt.name, static_cast<int32_t>(slots.size()));
+                else if (stmt.kind == StatementKind::If || stmt.kind == StatementKind::While || stmt.kind == StatementKind::For)
+                {
+                    collectLocals(stmt.init, slots);
+                    collectLocals(stmt.body, slots);
+                    collectLocals(stmt.elseBody, slots);
+                }
+            }
+        }
+
+        // Returns `expr` with its local variables resolved to slots.
+        // Expressions without locals keep sharing the cached program.
+        ExpressionPtr bindExpression(const ExpressionPtr &expr, const SlotMap &slots)
+        {
+            std::shared_ptr<Expression> bound;
+            for (size_t i = 0; i < expr->code.size(); ++i)
+            {
+                const RpnToken &tok = expr->code[i];
+                if (tok.kind != TokenKind::Variable && !(tok.kind == TokenKind::Call && tok.path))
+                    continue;
+                auto it = findLocal(slots, tok.name, tok.path != nullptr);
+                if (it == slots.end())
+                    continue;
+                if (!bound)
+                    bound = std::make_shared<Expression>(*expr);
+                bound->code[i].slot = it->second;
+            }
+            return bound ? bound : expr;
+        }
+
+        void bindBlock(Block &body, const SlotMap &slots)
+        {
+            for (auto &stmt : body)
+            {
+                // Nested functions and classes get their own scopes
+                if (stmt.kind == StatementKind::Function || stmt.kind == StatementKind::Class)
+                    continue;
+                if (stmt.kind == StatementKind::Let)
+                    stmt.slot = slots.at(stmt.name);
+                else if (stmt.kind == StatementKind::Assign || (stmt.kind == StatementKind::Call && stmt.path))
+                {
+                    // Names that are not locals assign to an enclosing scope
+                    auto it = findLocal(slots, stmt.name, stmt.path != nullptr);
+                    if (it != slots.end())
+                        stmt.slot = it->second;
+                }
+                if (stmt.expr)
+                    stmt.expr = bindExpression(stmt.expr, slots);
+                if (stmt.index)
+                    stmt.index = bindExpression(stmt.index, slots);
+                for (auto &arg : stmt.args)
+                    arg = bindExpression(arg, slots);
+                bindBlock(stmt.init, slots);
+                bindBlock(stmt.body, slots);
+                bindBlock(stmt.elseBody, slots);
+                bindBlock(stmt.update, slots);
+            }
+        }
+
+        // Resolves parameters and locals of a function to frame slots.
+        void resolveSlots(FunctionDef &def)
+        {
+            SlotMap slots;
+            for (auto &param : def.params)
+                slots.emplace(param, static_cast<int32_t>(slots.size()));
+            collectLocals(def.body, slots);
+            bindBlock(def.body, slots);
+            def.slotCount = static_cast<uint32_t>(slots.size());
+        }
+
+        Statement makeError(size_t line, const std::string &message)
+        {
+            Statement stmt;
+            stmt.kind = StatementKind::Error;
+            stmt.line = line;
+            stmt.name = message;
+            return stmt;
+        }
+
+        /**
+         * Recursive-descent statement parser reading lines from a SourceCursor.
+         * `pending` holds the unconsumed remainder of the current line, e.g. the
+         * text after a `{` or the ` else {` following a closing `}`.
+         * All text the parser inspects is a view into the cursor's buffer.
+         */
+        class Parser
+        {
+        public:
+            explicit Parser(SourceCursor &source)
+                : source(source) {}
+
+            Block parseBlock(bool nested, const std::string &className = "")
+            {
+                Block block;
+                std::string_view text;
+                size_t lineNo;
+                while (nextLine(text, lineNo))
+                {
+                    if (nested && text[0] == '}')
+                    {
+                        setPending(text.substr(1), lineNo);
+                        return block;
+                    }
+
+                    // A closing brace later on the line, e.g. "foo(); }"
+                    if (nested)
+                    {
+                        size_t close = findUnmatchedClose(text);
+                        if (close != std::string_view::npos)
+                        {
+                            setPending(text.substr(close), lineNo);
+                            text = trim(text.substr(0, close));
+                            if (text.empty())
+                                continue;
+                        }
+                    }
+
+                    if (!className.empty())
+                        parseMember(text, lineNo, className, block);
+                    else
+                        block.push_back(parseStatement(text, lineNo));
+                }
+                return block;
+            }
+
+        private:
+            SourceCursor &source;
+            std::string_view pending;
+            size_t pendingLine = 0;
+            bool hasPending = false;
+
+            void setPending(std::string_view text, size_t lineNo)
+            {
+                pending = text;
+                pendingLine = lineNo;
+                hasPending = true;
+            }
+
+            // Next non-empty, non-comment line (trimmed).
+            bool nextLine(std::string_view &out, size_t &lineNo)
+            {
+                while (true)
+                {
+                    if (hasPending)
+                    {
+                        hasPending = false;
+                        out = trim(pending);
+                        lineNo = pendingLine;
+                    }
+                    else if (source.next(out, lineNo))
+                        out = trim(out);
+                    else
+                        return false;
+
+                    if (out.empty() || startsWith(out, "//"))
+                        continue; // skip comments
+                    return true;
+                }
+            }
+
+            // Consumes the `{` that opens a body, on `rest` or on the next line.
+            bool openBody(std::string_view rest, size_t lineNo)
+            {
+                auto brace = rest.find('{');
+                if (brace != std::string_view::npos)
+                {
+                    setPending(rest.substr(brace + 1), lineNo);
+                    return true;
+                }
+                std::string_view next;
+                size_t nextNo;
+                if (nextLine(next, nextNo))
+                {
+                    if (next[0] == '{')
+                    {
+                        setPending(next.substr(1), nextNo);
+                        return true;
+                    }
+                    setPending(next, nextNo);
+                }
+                return false;
+            }
+
+            Statement parseStatement(std::string_view line, size_t lineNo)
+            {
+                // Handle variable declaration: let x = 10; or let x:any = 10;
+                if (startsWith(line, "let "))
+                    return parseLet(line.substr(4), lineNo);
+
+                // Handle function definition: function name(param1, param2) { ... }
+                if (startsWith(line, "function "))
+                    return parseFunction(line.substr(9), lineNo, "");
+
+                if (isKeyword(line, "if"))
+                    return parseIf(line, lineNo);
+
+                if (startsWith(line, "class "))
+                    return parseClass(line, lineNo);
+
+                if (isKeyword(line, "while"))
+                    return parseWhile(line, lineNo);
+
+                if (isKeyword(line, "for"))
+                    return parseFor(line, lineNo);
+
+                if (isKeyword(line, "break") || isKeyword(line, "continue"))
+                {
+                    Statement stmt;
+                    stmt.kind = line[0] == 'b' ? StatementKind::Break : StatementKind::Continue;
+                    stmt.line = lineNo;
+                    return stmt;
+                }
+
+                if (isKeyword(line, "return"))
+                {
+                    Statement stmt;
+                    stmt.kind = StatementKind::Return;
+                    stmt.line = lineNo;
+                    stmt.expr = compileExpression(stripSemicolon(line.substr(6)));
+                    return stmt;
+                }
+
+                // --- Assignments: name = expr; name += expr; name++; ---
+                Statement assign;
+                if (parseAssignment(line, lineNo, assign))
+                    return assign;
+
+                // --- Function calls: name(arg1, arg2, ...) ---
+                auto parenOpen = line.find('(');
+                auto parenClose = line.rfind(')'); // use rfind to get the last closing parenthesis
+                if (parenOpen != std::string_view::npos && parenClose != std::string_view::npos && parenClose > parenOpen)
+                {
+                    Statement stmt;
+                    stmt.kind = StatementKind::Call;
+                    stmt.line = lineNo;
+                    stmt.name = trim(line.substr(0, parenOpen));
+                    stmt.atom = callableId(stmt.name);
+                    stmt.path = propertyPath(stmt.name);
+                    for (auto arg : splitArguments(line.substr(parenOpen + 1, parenClose - parenOpen - 1)))
+                    {
+                        stmt.args.push_back(compileExpression(arg));
+                        stmt.argTypes.push_back(staticType(*stmt.args.back()));
+                    }
+                    return stmt;
+                }
+
+                return makeError(lineNo, "Error: Unrecognized statement: " + std::string(line));
+            }
+
+            Statement parseLet(std::string_view decl, size_t lineNo)
+            {
+                auto eqPos = decl.find('=');
+                if (eqPos == std::string_view::npos)
+                    return makeError(lineNo, "SyntaxError: Missing '=' in let statement");
+
+                Statement stmt;
+                stmt.kind = StatementKind::Let;
+                stmt.line = lineNo;
+                std::string_view name = trim(decl.substr(0, eqPos));
+
+                // Keep the optional type annotation
+                if (auto colonPos = name.find(':'); colonPos != std::string_view::npos)
+                {
+                    stmt.type = trim(name.substr(colonPos + 1));
+                    name = trim(name.substr(0, colonPos));
+                }
+                if (name.empty())
+                    return makeError(lineNo, "SyntaxError: Missing variable name");
+
+                stmt.name = name;
+                stmt.atom = TS::atom(stmt.name);
+                stmt.expr = compileExpression(stripSemicolon(decl.substr(eqPos + 1)));
+                return stmt;
+            }
+
+            // `header` is everything after the `function` keyword.
+            // Methods take the instance as an implicit first parameter, `this`.
+            Statement parseFunction(std::string_view header, size_t lineNo, const std::string &prefix, bool method = false)
+            {
+                auto parenOpen = header.find('(');
+                auto parenClose = parenOpen == std::string_view::npos ? std::string_view::npos : header.find(')', parenOpen);
+                if (parenClose == std::string_view::npos)
+                    return makeError(lineNo, "SyntaxError: malformed function declaration");
+
+                Statement stmt;
+                stmt.kind = StatementKind::Function;
+                stmt.line = lineNo;
+                stmt.name = prefix + std::string(trim(header.substr(0, parenOpen)));
+                stmt.function = std::make_shared<FunctionDef>();
+                FunctionDef &def = *stmt.function;
+                if (method)
+                    addThis(def);
+
+                // Parse parameters with optional type annotations
+                std::string_view params = header.substr(parenOpen + 1, parenClose - parenOpen - 1);
+                while (!params.empty())
+                {
+                    auto comma = params.find(',');
+                    std::string_view param = trim(params.substr(0, comma));
+                    params = comma == std::string_view::npos ? std::string_view() : params.substr(comma + 1);
+                    if (param.empty())
+                        continue;
+
+                    std::string_view paramName = param;
+                    std::string_view paramType = "any"; // default
+
+                    auto colonPos = param.find(':');
+                    if (colonPos != std::string_view::npos)
+                    {
+                        paramName = trim(param.substr(0, colonPos));
+                        paramType = trim(param.substr(colonPos + 1));
+                    }
+
+                    def.params.emplace_back(paramName);
+                    def.paramTypes.emplace_back(paramType);
+                    def.declaredTypes.push_back(declaredType(paramType));
+                }
+
+                if (openBody(header.substr(parenClose + 1), lineNo))
+                    def.body = parseBlock(true);
+                resolveSlots(def);
+                return stmt;
+            }
+
+            Statement parseIf(std::string_view line, size_t lineNo)
+            {
+                // Extract condition between parentheses
+                auto condStart = line.find('(');
+                auto condEnd = condStart == std::string_view::npos ? std::string_view::npos : findMatchingParen(line, condStart);
+                if (condEnd == std::string_view::npos)
+                    return makeError(lineNo, "SyntaxError: malformed if statement");
+
+                Statement stmt;
+                stmt.kind = StatementKind::If;
+                stmt.line = lineNo;
+                stmt.expr = compileExpression(trim(line.substr(condStart + 1, condEnd - condStart - 1)));
+
+                if (!openBody(line.substr(condEnd + 1), lineNo))
+                    return makeError(lineNo, "SyntaxError: if without block");
+                stmt.body = parseBlock(true);
+
+                // Peek for else, either after the closing brace or on the next line
+                std::string_view next;
+                size_t nextNo;
+                if (!nextLine(next, nextNo))
+                    return stmt;
+                if (!isKeyword(next, "else"))
+                {
+                    setPending(next, nextNo);
+                    return stmt;
+                }
+
+                std::string_view rest = trim(next.substr(4));
+                if (isKeyword(rest, "if"))
+                    stmt.elseBody.push_back(parseIf(rest, nextNo));
+                else if (openBody(rest, nextNo))
+                    stmt.elseBody = parseBlock(true);
+                else
+                    stmt.elseBody.push_back(makeError(nextNo, "SyntaxError: else without block"));
+                return stmt;
+            }
+
+            // Assignments are compiled to `name = expr`: "x += e" becomes "x = x + (e)"
+            bool parseAssignment(std::string_view text, size_t lineNo, Statement &stmt)
+            {
+                text = stripSemicolon(text);
+                std::string_view prefixOp;
+                if (startsWith(text, "++") || startsWith(text, "--"))
+                {
+                    prefixOp = text.substr(0, 2);
+                    text = trim(text.substr(2));
+                }
+
+                size_t nameEnd = 0;
+                while (nameEnd < text.size() && (std::isalnum(static_cast<unsigned char>(text[nameEnd])) ||
+                                                 text[nameEnd] == '_' || text[nameEnd] == '$' || text[nameEnd] == '.'))
+                    ++nameEnd;
+                if (nameEnd == 0 || std::isdigit(static_cast<unsigned char>(text[0])))
+                    return false;
+
+                std::string name(text.substr(0, nameEnd));
+                std::string_view rest = trim(text.substr(nameEnd));
+                std::string value;
+
+                // Element assignment: name[index] = expr
+                std::string target = name;
+                std::string_view index;
+                if (!rest.empty() && rest[0] == '[')
+                {
+                    size_t close = findMatchingParen(rest, 0);
+                    if (close == std::string_view::npos)
+                        return false;
+                    index = trim(rest.substr(1, close - 1));
+                    target += "[" + std::string(index) + "]";
+                    rest = trim(rest.substr(close + 1));
+                }
+
+                if (!prefixOp.empty())
+                {
+                    if (!rest.empty())
+                        return false;
+                    value = target + (prefixOp == "++" ? " + 1" : " - 1");
+                }
+                else if (rest == "++" || rest == "--")
+                    value = target + (rest == "++" ? " + 1" : " - 1");
+                else if (startsWith(rest, "**="))
+                    value = target + " ** (" + std::string(trim(rest.substr(3))) + ")";
+                else if (rest.size() >= 2 && rest[1] == '=' && std::string_view("+-*/%").find(rest[0]) != std::string_view::npos)
+                    value = target + " " + rest[0] + " (" + std::string(trim(rest.substr(2))) + ")";
+                else if (!rest.empty() && rest[0] == '=' && !startsWith(rest, "=="))
+                    value = trim(rest.substr(1));
+                else
+                    return false;
+
+                stmt.kind = StatementKind::Assign;
+                stmt.line = lineNo;
+                stmt.name = std::move(name);
+                stmt.atom = TS::atom(stmt.name);
+                stmt.path = propertyPath(stmt.name);
+                stmt.expr = compileExpression(value);
+                if (!index.empty())
+                    stmt.index = compileExpression(index);
+                return true;
+            }
+
+            Statement parseWhile(std::string_view line, size_t lineNo)
+            {
+                auto condStart = line.find('(');
+                auto condEnd = condStart == std::string_view::npos ? std::string_view::npos : findMatchingParen(line, condStart);
+                if (condEnd == std::string_view::npos)
+                    return makeError(lineNo, "SyntaxError: malformed while statement");
+
+                Statement stmt;
+                stmt.kind = StatementKind::While;
+                stmt.line = lineNo;
+                stmt.expr = compileExpression(trim(line.substr(condStart + 1, condEnd - condStart - 1)));
+
+                if (!openBody(line.substr(condEnd + 1), lineNo))
+                    return makeError(lineNo, "SyntaxError: while without block");
+                stmt.body = parseBlock(true);
+                return stmt;
+            }
+
+            Statement parseFor(std::string_view line, size_t lineNo)
+            {
+                auto headStart = line.find('(');
+                auto headEnd = headStart == std::string_view::npos ? std::string_view::npos : findMatchingParen(line, headStart);
+                if (headEnd == std::string_view::npos)
+                    return makeError(lineNo, "SyntaxError: malformed for statement");
+
+                // Split "init; cond; update" at top-level semicolons
+                std::string_view head = line.substr(headStart + 1, headEnd - headStart - 1);
+                std::vector<std::string_view> parts;
+                size_t partStart = 0;
+                char quote = '\0';
+                int depth = 0;
+                for (size_t i = 0; i < head.size(); ++i)
+                {
+                    char c = head[i];
+                    if (quote)
+                    {
+                        if (c == quote && head[i - 1] != '\\')
+                            quote = '\0';
+                    }
+                    else if (c == '"' || c == '\'')
+                        quote = c;
+                    else if (c == '(')
+                        depth++;
+                    else if (c == ')')
+                        depth--;
+                    else if (c == ';' && depth == 0)
+                    {
+                        parts.push_back(trim(head.substr(partStart, i - partStart)));
+                        partStart = i + 1;
+                    }
+                }
+                parts.push_back(trim(head.substr(partStart)));
+                if (parts.size() != 3)
+                    return makeError(lineNo, "SyntaxError: for needs 'init; condition; update'");
+
+                Statement stmt;
+                stmt.kind = StatementKind::For;
+                stmt.line = lineNo;
+                if (!parts[0].empty())
+                    stmt.init.push_back(parseStatement(parts[0], lineNo));
+                if (!parts[1].empty())
+                    stmt.expr = compileExpression(parts[1]);
+                if (!parts[2].empty())
+                    stmt.update.push_back(parseStatement(parts[2], lineNo));
+
+                if (!openBody(line.substr(headEnd + 1), lineNo))
+                    return makeError(lineNo, "SyntaxError: for without block");
+                stmt.body = parseBlock(true);
+                return stmt;
+            }
+
+            static void addThis(FunctionDef &def)
+            {
+                def.params.emplace_back("this");
+                def.paramTypes.emplace_back("any");
+                def.declaredTypes.push_back(DeclaredType::Any);
+            }
+
+            Statement parseClass(std::string_view line, size_t lineNo)
+            {
+                // Extract class name
+                auto nameEnd = line.find('{', 6);
+                Statement stmt;
+                stmt.kind = StatementKind::Class;
+                stmt.line = lineNo;
+                stmt.name = trim(line.substr(6, nameEnd == std::string_view::npos ? std::string_view::npos : nameEnd - 6));
+                if (openBody(nameEnd == std::string_view::npos ? std::string_view() : line.substr(nameEnd), lineNo))
+                    stmt.body = parseBlock(true, stmt.name);
+
+                // `new` calls "ClassName.constructor" on the new instance: it
+                // initializes the fields, then runs the declared constructor (if any)
+                Block fields;
+                Block members;
+                for (Statement &member : stmt.body)
+                    (member.kind == StatementKind::Assign ? fields : members).push_back(std::move(member));
+                std::string constructorName = stmt.name + ".constructor";
+                auto constructor = std::find_if(members.begin(), members.end(), [&](const Statement &member)
+                                                { return member.kind == StatementKind::Function && member.name == constructorName; });
+                if (constructor == members.end())
+                {
+                    Statement defined;
+                    defined.kind = StatementKind::Function;
+                    defined.line = lineNo;
+                    defined.name = constructorName;
+                    defined.function = std::make_shared<FunctionDef>();
+                    addThis(*defined.function);
+                    constructor = members.insert(members.end(), std::move(defined));
+                }
+                FunctionDef &def = *constructor->function;
+                def.body.insert(def.body.begin(), std::make_move_iterator(fields.begin()), std::make_move_iterator(fields.end()));
+                resolveSlots(def);
+                stmt.body = std::move(members);
+                return stmt;
+            }
+
+            // Class members become qualified functions and variables:
+            // "ClassName.member". Fields become assignments to `this`, which
+            // parseClass moves into the constructor.
+            void parseMember(std::string_view line, size_t lineNo, const std::string &className, Block &block)
+            {
+                bool isStatic = startsWith(line, "static ");
+                std::string_view rest = isStatic ? trim(line.substr(7)) : line;
+                auto parenPos = rest.find('(');
+                auto eqPos = rest.find('=');
+
+                // Method: [static] name(params) { ... }, or constructor(params) { ... }
+                if (parenPos != std::string_view::npos && (eqPos == std::string_view::npos || parenPos < eqPos))
+                {
+                    block.push_back(parseFunction(rest, lineNo, className + ".", !isStatic));
+                }
+                // Field: name[: type] [= value];
+                else if (!isStatic)
+                {
+                    std::string_view decl = stripSemicolon(rest);
+                    auto assign = decl.find('=');
+                    std::string_view name = trim(decl.substr(0, std::min(assign, decl.find(':'))));
+                    if (name.empty() || !std::all_of(name.begin(), name.end(), [](char c)
+                                                     { return std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '$'; }))
+                    {
+                        block.push_back(makeError(lineNo, "SyntaxError: Unrecognized class member: " + std::string(line)));
+                        return;
+                    }
+                    Statement field;
+                    field.kind = StatementKind::Assign;
+                    field.line = lineNo;
+                    field.name = "this." + std::string(name);
+                    field.atom = TS::atom(field.name);
+                    field.path = propertyPath(field.name);
+                    field.expr = compileExpression(assign == std::string_view::npos ? "undefined" : trim(decl.substr(assign + 1)));
+                    block.push_back(std::move(field));
+                }
+                // Property: static name = value;
+                else if (eqPos != std::string_view::npos)
+                {
+                    Statement stmt = parseLet(rest, lineNo);
+                    if (stmt.kind == StatementKind::Let)
+                    {
+                        stmt.name = className + "." + stmt.name;
+                        stmt.atom = TS::atom(stmt.name);
+                    }
+                    block.push_back(std::move(stmt));
+                }
+            }
+        };
+    } // namespace
+
+    int braceBalance(std::string_view line)
+    {
+        int depth = 0;
+        char quote = '\0';
+        for (size_t i = 0; i < line.size(); ++i)
+        {
+            char c = line[i];
+            if (quote)
+            {
+                if (c == quote && line[i - 1] != '\\')
+                    quote = '\0';
+                continue;
+            }
+            if (c == '"' || c == '\'')
+                quote = c;
+            else if (c == '/' && i + 1 < line.size() && line[i + 1] == '/')
+                break;
+            else if (c == '{')
+                depth++;
+            else if (c == '}')
+                depth--;
+        }
+        return depth;
+    }
+
+    ExpressionPtr compileExpression(std::string_view expr)
+    {
+        ExpressionCache &cache = expressionCache();
+        {
+            std::shared_lock<std::shared_mutex> reading(cache.lock);
+            auto it = cache.entries.find(expr);
+            if (it != cache.entries.end())
+            {
+                cache.hits.fetch_add(1, std::memory_order_relaxed);
+                return it->second;
+            }
+        }
+        cache.misses.fetch_add(1, std::memory_order_relaxed);
+
+        // Compiled outside the lock; if another thread got there first, share its copy
+        ExpressionPtr compiled = compileRpn(expr);
+        std::unique_lock<std::shared_mutex> writing(cache.lock);
+        return cache.entries.emplace(expr, std::move(compiled)).first->second;
+    }
+
+    PropertyPathPtr propertyPath(std::string_view name)
+    {
+        size_t dot = name.find('.');
+        if (dot == std::string_view::npos)
+            return nullptr;
+        auto path = std::make_shared<PropertyPath>();
+        path->base = TS::atom(name.substr(0, dot));
+        path->owner = TS::atom(name.substr(0, name.rfind('.')));
+        while (dot != std::string_view::npos)
+        {
+            size_t next = name.find('.', dot + 1);
+            path->keys.push_back(TS::atom(name.substr(dot + 1, next == std::string_view::npos ? next : next - dot - 1)));
+            dot = next;
+        }
+        path->caches.resize(path->keys.size());
+        return path;
+    }
+
+    void linkToken(RpnToken &tok)
+    {
+        switch (tok.kind)
+        {
+        case TokenKind::Variable:
+        case TokenKind::Call:
+            tok.atom = TS::atom(tok.name);
+            tok.path = propertyPath(tok.name);
+            break;
+
+        case TokenKind::Member:
+        case TokenKind::Method:
+        {
+            auto path = std::make_shared<PropertyPath>();
+            tok.atom = TS::atom(tok.name);
+            path->keys.push_back(tok.atom);
+            path->caches.resize(1);
+            tok.path = std::move(path);
+            break;
+        }
+
+        case TokenKind::Object:
+        {
+            // Every evaluation creates an object of the same shape
+            auto path = std::make_shared<PropertyPath>();
+            path->shape = TS::Shape::root();
+            std::string_view keys = tok.name;
+            for (uint32_t i = 0; i < tok.argc; ++i)
+            {
+                size_t comma = keys.find(',');
+                uint32_t key = TS::atom(keys.substr(0, comma));
+                path->keys.push_back(key);
+                path->shape = path->shape->with(key);
+                keys = comma == std::string_view::npos ? std::string_view() : keys.substr(comma + 1);
+            }
+            tok.path = std::move(path);
+            break;
+        }
+
+        case TokenKind::New:
+        {
+            auto path = std::make_shared<PropertyPath>();
+            path->base = TS::atom(tok.name);
+            path->shape = TS::Shape::root(path->base);
+            tok.atom = TS::atom(tok.name + ".constructor");
+            tok.path = std::move(path);
+            break;
+        }
+
+        default:
+            break;
+        }
+    }
+
+    DeclaredType declaredType(std::string_view annotation)
+    {
+        if (annotation.empty() || annotation == "any")
+            return DeclaredType::Any;
+        if (annotation == "number")
+            return DeclaredType::Number;
+        if (annotation == "string")
+            return DeclaredType::String;
+        if (annotation == "boolean")
+            return DeclaredType::Boolean;
+        return DeclaredType::Other;
+    }
+
+    DeclaredType staticType(const Expression &expr)
+    {
+        // Mirrors applyOpVal and applyUnaryOpVal: only results that do not depend on the operands are typed
+        std::vector<DeclaredType> stack;
+        auto pop = [&stack]()
+        {
+            if (stack.empty())
+                return DeclaredType::Any;
+            DeclaredType top = stack.back();
+            stack.pop_back();
+            return top;
+        };
+        for (const RpnToken &tok : expr.code)
+        {
+            switch (tok.kind)
+            {
+            case TokenKind::Literal:
+                switch (tok.value.type)
+                {
+                case TS::ValueType::Number:
+                    stack.push_back(DeclaredType::Number);
+                    break;
+                case TS::ValueType::String:
+                    stack.push_back(DeclaredType::String);
+                    break;
+                case TS::ValueType::Boolean:
+                    stack.push_back(DeclaredType::Boolean);
+                    break;
+                default:
+                    stack.push_back(DeclaredType::Any);
+                    break;
+                }
+                break;
+            case TokenKind::Variable:
+                stack.push_back(DeclaredType::Any);
+                break;
+            case TokenKind::Call:
+            case TokenKind::Array:
+            case TokenKind::Object:
+            case TokenKind::New:
+                for (uint32_t i = 0; i < tok.argc; ++i)
+                    pop();
+                stack.push_back(DeclaredType::Any);
+                break;
+            case TokenKind::Member:
+                pop();
+                stack.push_back(DeclaredType::Any);
+                break;
+            case TokenKind::Method:
+                for (uint32_t i = 0; i <= tok.argc; ++i)
+                    pop();
+                stack.push_back(DeclaredType::Any);
+                break;
+            case TokenKind::Operator:
+                switch (tok.op)
+                {
+                case OpCode::Neg:
+                case OpCode::Plus:
+                    pop();
+                    stack.push_back(DeclaredType::Number);
+                    break;
+                case OpCode::Not:
+                    pop();
+                    stack.push_back(DeclaredType::Boolean);
+                    break;
+                case OpCode::Length:
+                    pop();
+                    stack.push_back(DeclaredType::Any);
+                    break;
+                case OpCode::Add:
+                {
+                    // A string operand makes a string, two numbers a number
+                    DeclaredType b = pop();
+                    DeclaredType a = pop();
+                    if (a == DeclaredType::String || b == DeclaredType::String)
+                        stack.push_back(DeclaredType::String);
+                    else if (a == DeclaredType::Number && b == DeclaredType::Number)
+                        stack.push_back(DeclaredType::Number);
+                    else
+                        stack.push_back(DeclaredType::Any);
+                    break;
+                }
+                case OpCode::Index:
+                    pop();
+                    pop();
+                    stack.push_back(DeclaredType::Any);
+                    break;
+                case OpCode::Sub:
+                case OpCode::Mul:
+                case OpCode::Div:
+                case OpCode::Mod:
+                case OpCode::Pow:
+                    pop();
+                    pop();
+                    stack.push_back(DeclaredType::Number);
+                    break;
+                default: // comparisons and logical operators
+                    pop();
+                    pop();
+                    stack.push_back(DeclaredType::Boolean);
+                    break;
+                }
+                break;
+            }
+        }
+        return stack.size() == 1 ? stack.back() : DeclaredType::Any;
+    }
+
+    ExpressionCacheStats expressionCacheStats()
+    {
+        ExpressionCache &cache = expressionCache();
+        std::shared_lock<std::shared_mutex> reading(cache.lock);
+        ExpressionCacheStats stats;
+        stats.hits = cache.hits.load(std::memory_order_relaxed);
+        stats.misses = cache.misses.load(std::memory_order_relaxed);
+        stats.entries = cache.entries.size();
+        return stats;
+    }
+
+    void clearExpressionCache()
+    {
+        // Programs already holding compiled expressions keep them alive
+        ExpressionCache &cache = expressionCache();
+        std::unique_lock<std::shared_mutex> writing(cache.lock);
+        cache.entries.clear();
+        cache.hits = 0;
+        cache.misses = 0;
+    }
+
+    std::vector<std::string_view> splitLines(std::string_view source)
+    {
+        std::vector<std::string_view> lines;
+        while (!source.empty())
+        {
+            auto newline = source.find('\n');
+            lines.push_back(source.substr(0, newline));
+            if (newline == std::string_view::npos)
+                break;
+            source.remove_prefix(newline + 1);
+        }
+        return lines;
+    }
+
+    SourceCursor::SourceCursor(const std::vector<std::string_view> &lines, size_t firstLine)
+        : lines(lines.data()), count(lines.size()), firstLine(firstLine) {}
+
+    bool SourceCursor::next(std::string_view &line, size_t &lineNo)
+    {
+        if (pos >= count)
+            return false;
+        line = lines[pos];
+        lineNo = firstLine + pos;
+        ++pos;
+        return true;
+    }
+
+    Block compileScript(SourceCursor &source)
+    {
+        Parser parser(source);
+        Block program = parser.parseBlock(false);
+        optimizeProgram(program);
+        return program;
+    }
+
+    Block compileScript(const std::vector<std::string> &lines, size_t firstLine)
+    {
+        std::vector<std::string_view> views(lines.begin(), lines.end());
+        SourceCursor cursor(views, firstLine);
+        return compileScript(cursor);
+    }
+
+    Block compileSource(std::string_view source, size_t firstLine)
+    {
+        std::vector<std::string_view> lines = splitLines(source);
+        SourceCursor cursor(lines, firstLine);
+        return compileScript(cursor);
+    }
+
+} // namespace Interpreter
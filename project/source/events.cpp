@@ -0,0 +1,231 @@
+// events.cpp
+#include "events.h"
+#include "interpreter.h"
+#include "os.h"
+#include "vm.h"
+#include <algorithm>
+
+namespace Interpreter
+{
+    EventLoop::EventLoop() = default;
+
+    EventLoop::~EventLoop()
+    {
+        for (auto &entry : watches)
+            OS::closeStream(entry.second.stream);
+    }
+
+    uint32_t EventLoop::setTimer(std::string callback, std::vector<TS::Value> args, uint64_t delayMs, bool repeat)
+    {
+        uint32_t id = nextId++;
+        Timer &timer = timers[id];
+        timer.task = Task{std::move(callback), std::move(args)};
+        timer.intervalMs = repeat ? std::max<uint64_t>(delayMs, 1) : 0;
+        schedule(id, OS::getMillis() + delayMs);
+        return id;
+    }
+
+    bool EventLoop::clearTimer(uint32_t id)
+    {
+        return timers.erase(id) != 0;
+    }
+
+    void EventLoop::queueMicrotask(std::string callback, std::vector<TS::Value> args)
+    {
+        microtasks.push_back(Task{std::move(callback), std::move(args)});
+    }
+
+    uint32_t EventLoop::watchLines(const std::string &path, std::string callback)
+    {
+        int stream = OS::openStream(path);
+        if (stream < 0)
+            return 0;
+        if (!poller)
+            poller = std::make_unique<OS::Poller>();
+        poller->add(stream);
+
+        uint32_t id = nextId++;
+        Watch &watch = watches[id];
+        watch.stream = stream;
+        watch.callback = std::move(callback);
+        return id;
+    }
+
+    bool EventLoop::unwatch(uint32_t id)
+    {
+        auto it = watches.find(id);
+        if (it == watches.end())
+            return false;
+        poller->remove(it->second.stream);
+        OS::closeStream(it->second.stream);
+        watches.erase(it);
+        return true;
+    }
+
+    void EventLoop::addJob(std::function<bool(Context &)> step)
+    {
+        jobs.push_back(std::move(step));
+    }
+
+    void EventLoop::run(Context &ctx)
+    {
+        std::vector<int> ready;
+        runMicrotasks(ctx);
+        while (pending())
+        {
+            // Cleared timers are dropped when they reach the front
+            while (!expiries.empty() && !timers.count(expiries.top().id))
+                expiries.pop();
+
+            int64_t timeout = -1; // no timers: wait for input only
+            if (!jobs.empty())
+                timeout = 0;
+            else if (!expiries.empty())
+            {
+                uint64_t now = OS::getMillis();
+                uint64_t at = expiries.top().at;
+                timeout = at > now ? static_cast<int64_t>(at - now) : 0;
+            }
+
+            ctx.console->flush();
+            if (watches.empty())
+            {
+                if (timeout > 0)
+                    OS::sleepMillis(static_cast<uint64_t>(timeout));
+            }
+            else
+            {
+                poller->wait(timeout, ready);
+                for (int stream : ready)
+                    readStream(ctx, stream);
+            }
+            runTimers(ctx);
+            runJobs(ctx);
+        }
+    }
+
+    void EventLoop::schedule(uint32_t id, uint64_t at)
+    {
+        expiries.push(Expiry{at, nextSequence++, id});
+    }
+
+    void EventLoop::call(Context &ctx, const Task &task)
+    {
+        callStatement(task.callback, callableId(task.callback),
+                      Args(task.args.data(), task.args.size(), &ctx), ctx);
+    }
+
+    void EventLoop::runMicrotasks(Context &ctx)
+    {
+        // Microtasks queued by microtasks run in the same pass
+        while (!microtasks.empty())
+        {
+            Task task = std::move(microtasks.front());
+            microtasks.pop_front();
+            call(ctx, task);
+        }
+    }
+
+    void EventLoop::runTimers(Context &ctx)
+    {
+        // Timers set by these callbacks wait for the next pass, even with no delay
+        uint64_t now = OS::getMillis();
+        uint64_t last = nextSequence;
+        while (!expiries.empty() && expiries.top().at <= now && expiries.top().sequence < last)
+        {
+            Expiry expiry = expiries.top();
+            expiries.pop();
+            auto it = timers.find(expiry.id);
+            if (it == timers.end())
+                continue; // cleared
+
+            // The callback may set or clear timers, so it runs on a copy
+            Task task;
+            if (it->second.intervalMs)
+            {
+                task = it->second.task;
+                schedule(expiry.id, now + it->second.intervalMs);
+            }
+            else
+            {
+                task = std::move(it->second.task);
+                timers.erase(it);
+            }
+            call(ctx, task);
+            runMicrotasks(ctx);
+        }
+    }
+
+    void EventLoop::runJobs(Context &ctx)
+    {
+        // Jobs added by these steps start on the next pass
+        std::vector<std::function<bool(Context &)>> running = std::move(jobs);
+        jobs.clear();
+        std::vector<std::function<bool(Context &)>> kept;
+        for (auto &step : running)
+        {
+            if (step(ctx))
+                kept.push_back(std::move(step));
+            runMicrotasks(ctx);
+        }
+        kept.insert(kept.end(), std::make_move_iterator(jobs.begin()), std::make_move_iterator(jobs.end()));
+        jobs = std::move(kept);
+    }
+
+    void EventLoop::readStream(Context &ctx, int stream)
+    {
+        auto find = [this, stream]()
+        {
+            auto it = watches.begin();
+            while (it != watches.end() && it->second.stream != stream)
+                ++it;
+            return it;
+        };
+        auto it = find();
+        if (it == watches.end())
+            return; // unwatched by an earlier callback of this pass
+
+        char buffer[65536];
+        long n = OS::readStream(stream, buffer, sizeof(buffer));
+        if (n < 0)
+            return; // nothing after all
+
+        // Complete lines are handed out; the callback may end the watch
+        std::string callback = it->second.callback;
+        std::string text = std::move(it->second.partial);
+        text.append(buffer, static_cast<size_t>(n));
+        size_t start = 0;
+        size_t newline;
+        std::vector<std::string> lines;
+        while ((newline = text.find('\n', start)) != std::string::npos)
+        {
+            size_t end = newline > start && text[newline - 1] == '\r' ? newline - 1 : newline;
+            lines.push_back(text.substr(start, end - start));
+            start = newline + 1;
+        }
+        it->second.partial = text.substr(start);
+        if (n == 0 && !it->second.partial.empty())
+            lines.push_back(std::move(it->second.partial));
+
+        for (const std::string &line : lines)
+        {
+            if (find() == watches.end())
+                return;
+            call(ctx, Task{callback, {TS::Value(line)}});
+            runMicrotasks(ctx);
+        }
+
+        if (n == 0)
+        {
+            // End of the stream
+            it = find();
+            if (it == watches.end())
+                return;
+            uint32_t id = it->first;
+            unwatch(id);
+            call(ctx, Task{callback, {TS::Value()}});
+            runMicrotasks(ctx);
+        }
+    }
+
+} // namespace Interpreter
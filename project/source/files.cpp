@@ -0,0 +1,53 @@
+// files.cpp
+#include "files.h"
+
+namespace Interpreter
+{
+    uint32_t FileTable::open(const std::string &path, const std::string &mode)
+    {
+        OpenFile file;
+        if (mode == "r")
+        {
+            file.reader = std::make_unique<OS::FileReader>();
+            if (!file.reader->open(path))
+                return 0;
+        }
+        else if (mode == "w" || mode == "a")
+        {
+            file.writer = std::make_unique<OS::FileWriter>();
+            if (!file.writer->open(path, mode == "a"))
+                return 0;
+        }
+        else
+        {
+            return 0;
+        }
+
+        uint32_t handle = nextHandle++;
+        files.emplace(handle, std::move(file));
+        return handle;
+    }
+
+    OS::FileReader *FileTable::reader(uint32_t handle)
+    {
+        auto it = files.find(handle);
+        return it == files.end() ? nullptr : it->second.reader.get();
+    }
+
+    OS::FileWriter *FileTable::writer(uint32_t handle)
+    {
+        auto it = files.find(handle);
+        return it == files.end() ? nullptr : it->second.writer.get();
+    }
+
+    bool FileTable::close(uint32_t handle)
+    {
+        auto it = files.find(handle);
+        if (it == files.end())
+            return false;
+        bool ok = !it->second.writer || it->second.writer->close();
+        files.erase(it);
+        return ok;
+    }
+
+} // namespace Interpreter
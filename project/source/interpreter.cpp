@@ -1,6 +1,9 @@
 // interpreter.cpp
-#include "project\include\interpreter.h"
-#include "project/include/os.h"
+#include "interpreter.h"
+#include "arrays.h"
+#include "module.h"
+#include "os.h"
+#include "vm.h"
 #include <sstream>
 #include <algorithm>
 #include <cmath>
@@ -11,322 +14,415 @@
 #include <queue>
 #include <fstream>
 #include <sstream>
-#include "project/include/iostream_virt.h"
+#include "iostream_virt.h"
 #ifdef ADD_STD_HALF
 #include "half.h"
 #endif
 
 namespace Interpreter
 {
+    static inline void __trim(std::string &s);
+    std::string _stringify_type(TS::ValueType v);
 
-    // Main evaluator: takes expression string + environment
-    TS::Value evalSimpleExpression(
-        const std::string &expr,
-        TS::Environment &env,
-        const std::unordered_map<std::string,
-                                 std::function<TS::Value(const std::vector<TS::Value> &)>> &builtins)
+    TS::Value applyOpVal(OpCode op, const TS::Value &a, const TS::Value &b)
     {
-        // --- Tokenizer ---
-        auto tokenize = [](const std::string &s)
+        // Two numbers (the common case) need none of the coercions below
+        if (a.type == TS::ValueType::Number && b.type == TS::ValueType::Number)
         {
-            std::vector<std::string> tokens;
-            std::string cur;
-            for (size_t i = 0; i < s.size(); ++i)
+            NUMBER x = a.asNumber();
+            NUMBER y = b.asNumber();
+            switch (op)
             {
-                char c = s[i];
-                if (std::isspace(c))
-                    continue;
+            case OpCode::Add:
+                return TS::Value(x + y);
+            case OpCode::Sub:
+                return TS::Value(x - y);
+            case OpCode::Mul:
+                return TS::Value(x * y);
+            case OpCode::Div:
+                return TS::Value(y == 0 ? std::numeric_limits<NUMBER>::quiet_NaN() : x / y);
+            case OpCode::Lt:
+                return TS::Value(x < y);
+            case OpCode::Gt:
+                return TS::Value(x > y);
+            case OpCode::Le:
+                return TS::Value(x <= y);
+            case OpCode::Ge:
+                return TS::Value(x >= y);
+            case OpCode::Eq:
+            case OpCode::StrictEq:
+                return TS::Value(x == y);
+            case OpCode::Ne:
+            case OpCode::StrictNe:
+                return TS::Value(x != y);
+            default:
+                break;
+            }
+        }
 
-                // Number
-                if (std::isdigit(c) || (c == '.' && i + 1 < s.size() && std::isdigit(s[i + 1])))
-                {
-                    cur.clear();
-                    while (i < s.size() && (std::isdigit(s[i]) || s[i] == '.'))
-                        cur.push_back(s[i++]);
-                    --i;
-                    tokens.push_back(cur);
-                }
-                // Identifier
-                else if (std::isalpha(c) || c == '_' || c == '$')
-                {
-                    cur.clear();
-                    while (i < s.size() && (std::isalnum(s[i]) || s[i] == '_' || s[i] == '.'))
-                        cur.push_back(s[i++]);
-                    --i;
-                    tokens.push_back(cur);
-                }
-                // String literal
-                else if (c == '"' || c == '\'')
-                {
-                    char quote = c;
-                    cur.clear();
-                    cur.push_back(c);
-                    ++i;
-                    while (i < s.size())
-                    {
-                        cur.push_back(s[i]);
-                        if (s[i] == quote && s[i - 1] != '\\')
-                            break;
-                        ++i;
-                    }
-                    tokens.push_back(cur);
-                }
-                // Single char tokens
-                else
-                {
-                    tokens.push_back(std::string(1, c));
-                }
+        switch (op)
+        {
+        case OpCode::Add:
+            if (a.type == TS::ValueType::String || b.type == TS::ValueType::String)
+            {
+                // Build the result in place: one allocation, no temporaries
+                auto sizeHint = [](const TS::Value &v)
+                { return v.type == TS::ValueType::String ? v.asString().size() : TS::kNumberTextMax; };
+                std::string joined;
+                joined.reserve(sizeHint(a) + sizeHint(b));
+                a.appendTo(joined);
+                b.appendTo(joined);
+                return TS::Value(std::move(joined));
             }
-            return tokens;
-        };
+            return TS::Value(a.toNumber() + b.toNumber());
+        case OpCode::Sub:
+            return TS::Value(a.toNumber() - b.toNumber());
+        case OpCode::Mul:
+            return TS::Value(a.toNumber() * b.toNumber());
+        case OpCode::Div:
+            return TS::Value(b.toNumber() == 0 ? std::numeric_limits<NUMBER>::quiet_NaN()
+                                               : a.toNumber() / b.toNumber());
+        case OpCode::Mod:
+            return TS::Value(std::fmod(a.toNumber(), b.toNumber()));
+        case OpCode::Pow:
+            return TS::Value(static_cast<NUMBER>(std::pow(a.toNumber(), b.toNumber())));
+
+        // Comparisons
+        case OpCode::Eq:
+            return TS::Value(a.looseEquals(b));
+        case OpCode::Ne:
+            return TS::Value(!a.looseEquals(b));
+        case OpCode::StrictEq:
+            return TS::Value(a.strictEquals(b));
+        case OpCode::StrictNe:
+            return TS::Value(!a.strictEquals(b));
+        case OpCode::Lt:
+            return TS::Value(a.toNumber() < b.toNumber());
+        case OpCode::Gt:
+            return TS::Value(a.toNumber() > b.toNumber());
+        case OpCode::Le:
+            return TS::Value(a.toNumber() <= b.toNumber());
+        case OpCode::Ge:
+            return TS::Value(a.toNumber() >= b.toNumber());
+
+        // Logical
+        case OpCode::And:
+            return TS::Value(a.toBool() && b.toBool());
+        case OpCode::Or:
+            return TS::Value(a.toBool() || b.toBool());
+
+        // Element access (out of range and non-integer indices are null)
+        case OpCode::Index:
+        {
+            NUMBER i = b.toNumber();
+            if (!(i >= 0) || i != std::floor(i))
+                return TS::Value();
+            return a.at(static_cast<size_t>(i));
+        }
+        default:
+            return TS::Value();
+        }
+    }
 
-        auto precedence = [](const std::string &op) -> int
+    TS::Value applyUnaryOpVal(OpCode op, const TS::Value &a)
+    {
+        switch (op)
         {
-            // Highest precedence first
-            if (op == "**")
-                return 7; // Exponentiation
-            if (op == "*" || op == "/" || op == "%")
-                return 6; // Multiplicative
-            if (op == "+" || op == "-")
-                return 5; // Additive
-            if (op == "<" || op == ">" || op == "<=" || op == ">=")
-                return 4; // Relational
-            if (op == "==" || op == "!=" || op == "===" || op == "!==")
-                return 3; // Equality
-            if (op == "&&")
-                return 2; // Logical AND
-            if (op == "||")
-                return 1; // Logical OR
+        case OpCode::Neg:
+            return TS::Value(-a.toNumber());
+        case OpCode::Plus:
+            return TS::Value(a.toNumber());
+        case OpCode::Not:
+            return TS::Value(!a.toBool());
+        case OpCode::Length:
+            if (!a.isArray() && a.type != TS::ValueType::String)
+                return TS::Value();
+            return TS::Value(static_cast<NUMBER>(a.length()));
+        default:
+            return TS::Value();
+        }
+    }
 
-            return -1; // Unknown operator
-        };
+    // --- Objects ---
 
-        auto isOperator = [](const std::string &tok)
-        {
-            return tok == "+" || tok == "-" || tok == "*" || tok == "/" || tok == "%" ||
-                       tok == "==" || tok == "!=" || tok == "<" || tok == ">" || tok == "<=" || tok == ">=" ||
-                       tok == "&&" || tok == "||" || tok == "**" || tok == "===" || tok == "!==",
-                   "=", "+=", "-=", "*=", "/=", "%=";
-        };
+    // What holds the property the last part of a dotted name refers to:
+    // for `p.x.y` the value of `p.x`, for `p.x` the value of `p`
+    static const TS::Value *pathOwner(const PropertyPath &path, const TS::Value *local, TS::Environment &env)
+    {
+        const TS::Value *value = local ? local : env.lookup(path.base);
+        if (path.keys.size() == 1)
+            return value;
+        if (!value || value->type != TS::ValueType::Object)
+            return local ? nullptr : env.lookup(path.owner);
+        for (size_t i = 0; value && i + 1 < path.keys.size(); ++i)
+            value = TS::findProperty(*value, path.keys[i], path.caches[i]);
+        return value;
+    }
 
-        auto tokens = tokenize(expr);
+    const TS::Value *resolvePath(const PropertyPath &path, const TS::Value *local, uint32_t whole, TS::Environment &env)
+    {
+        const TS::Value *owner = pathOwner(path, local, env);
+        if (const TS::Value *value = owner ? TS::findProperty(*owner, path.keys.back(), path.caches.back()) : nullptr)
+            return value;
+        return local ? nullptr : env.lookup(whole);
+    }
 
-        // --- Shunting Yard with function call support ---
-        std::vector<std::string> output;
-        std::stack<std::string> ops;
-        std::stack<int> argCount; // track args for functions
+    bool assignPath(const PropertyPath &path, const TS::Value *local, TS::Environment &env, const TS::Value &value)
+    {
+        const TS::Value *owner = pathOwner(path, local, env);
+        return owner && TS::setProperty(*owner, path.keys.back(), value, path.caches.back());
+    }
 
-        for (size_t i = 0; i < tokens.size(); ++i)
-        {
-            const std::string &tok = tokens[i];
+    bool callMethod(const PropertyPath &path, const TS::Value *argv, size_t argc, const CallableRegistry &callables,
+                    Context *ctx, TS::Value &result)
+    {
+        uint32_t function;
+        if (argc == 0 || !TS::findMethod(argv[0], path.keys.back(), path.method, function))
+            return false;
+        const Callable *callee = callables.find(function);
+        if (!callee)
+            return false;
+        result = callee->fn(Args(argv, argc, ctx));
+        return true;
+    }
 
-            // Literals / identifiers
-            if (std::isdigit(tok[0]) || tok[0] == '"' || tok[0] == '\'' ||
-                std::isalpha(tok[0]) || tok[0] == '_' || tok[0] == '$')
-            {
-                // Function call detection: identifier followed by '('
-                if (i + 1 < tokens.size() && tokens[i + 1] == "(")
-                {
-                    ops.push(tok); // function name
-                }
-                else
-                {
-                    output.push_back(tok);
-                }
-            }
-            else if (tok == ",")
-            {
-                // Pop until left paren
-                while (!ops.empty() && ops.top() != "(")
-                {
-                    output.push_back(ops.top());
-                    ops.pop();
-                }
-                if (!argCount.empty())
-                    argCount.top()++;
-            }
-            else if (isOperator(tok))
-            {
-                while (!ops.empty() && isOperator(ops.top()) &&
-                       precedence(ops.top()) >= precedence(tok))
-                {
-                    output.push_back(ops.top());
-                    ops.pop();
-                }
-                ops.push(tok);
-            }
-            else if (tok == "(")
-            {
-                ops.push(tok);
-                // If previous token was a function name, start arg count
-                if (i > 0 && (std::isalpha(tokens[i - 1][0]) || tokens[i - 1][0] == '_' || tokens[i - 1][0] == '$'))
-                {
-                    argCount.push(1); // at least 1 arg unless empty
-                }
-            }
-            else if (tok == ")")
-            {
-                while (!ops.empty() && ops.top() != "(")
-                {
-                    output.push_back(ops.top());
-                    ops.pop();
-                }
-                if (!ops.empty() && ops.top() == "(")
-                    ops.pop();
+    TS::Value callPathMethod(const PropertyPath &path, const TS::Value *local, TS::Value *argv, size_t argc,
+                             const CallableRegistry &callables, Context *ctx, TS::Environment &env)
+    {
+        const TS::Value *receiver = pathOwner(path, local, env);
+        TS::Value self = receiver ? *receiver : TS::Value(); // `receiver` may be argv[0] itself
+        argv[0] = std::move(self);
+        TS::Value result; // undefined when there is no such method
+        callMethod(path, argv, argc + 1, callables, ctx, result);
+        return result;
+    }
 
-                // If top of ops is a function name, pop it to output
-                if (!ops.empty() && !isOperator(ops.top()) && ops.top() != "(")
-                {
-                    std::string funcName = ops.top();
-                    ops.pop();
-                    // Append arg count marker
-                    int argc = 0;
-                    if (!argCount.empty())
-                    {
-                        argc = argCount.top();
-                        argCount.pop();
-                    }
-                    output.push_back("#" + std::to_string(argc)); // arg count marker
-                    output.push_back("@" + funcName);             // function marker
-                }
-            }
-        }
-        while (!ops.empty())
+    TS::Value construct(const PropertyPath &path, uint32_t constructor, TS::Value *argv, size_t argc,
+                        const CallableRegistry &callables, Context *ctx)
+    {
+        const Callable *callee = callables.find(constructor);
+        if (!callee)
+            return TS::Value(); // like a call of an unknown function
+        argv[0] = TS::Value::makeObject(path.shape);
+        callee->fn(Args(argv, argc, ctx));
+        return argv[0];
+    }
+
+    TS::Value objectLiteral(const PropertyPath &path, const TS::Value *values, size_t count)
+    {
+        // A key repeated in the literal has one slot, holding the last value
+        count = std::min(count, path.keys.size());
+        if (count == path.shape->keys.size())
+            return TS::Value::makeObject(path.shape, std::vector<TS::Value>(values, values + count));
+        std::vector<TS::Value> slots(path.shape->keys.size());
+        for (size_t i = 0; i < count; ++i)
         {
-            output.push_back(ops.top());
-            ops.pop();
+            int32_t slot = path.shape->slotOf(path.keys[i]);
+            if (slot >= 0)
+                slots[slot] = values[i];
         }
+        return TS::Value::makeObject(path.shape, std::move(slots));
+    }
 
+    // Stack buffer for evaluations that have no context arena
+    constexpr size_t kLocalScratchBytes = 1024;
+
+    // Evaluates `expr`; `ctx` (nullptr when context-free) is handed to builtins
+    static TS::Value evaluate(
+        const Expression &expr,
+        TS::Environment &env,
+        const CallableRegistry &callables,
+        TS::Arena &scratch,
+        Context *ctx)
+    {
         // --- Evaluate RPN ---
-        std::stack<TS::Value> vals;
+        // The stack never grows past the token count, so nested calls can
+        // take scratch memory above it without it moving.
+        TS::Arena::Scope scope(scratch);
+        std::pmr::vector<TS::Value> vals(&scratch);
+        vals.reserve(expr.code.size());
 
-        auto applyOpVal = [&env](const std::string &op, TS::Value a, TS::Value b) -> TS::Value
+        auto pop = [&vals]() -> TS::Value
         {
-            if (op == "+")
-            {
-                if (a.type == TS::ValueType::String || b.type == TS::ValueType::String)
-                    return TS::Value(a.toString() + b.toString());
-                return TS::Value(a.toNumber() + b.toNumber());
-            }
-            if (op == "-")
-                return TS::Value(a.toNumber() - b.toNumber());
-            if (op == "*")
-                return TS::Value(a.toNumber() * b.toNumber());
-            if (op == "/")
-                return TS::Value(b.toNumber() == 0 ? std::numeric_limits<NUMBER>::quiet_NaN()
-                                                   : a.toNumber() / b.toNumber());
-            if (op == "%")
-                return TS::Value(std::fmod(a.toNumber(), b.toNumber()));
-
-            // Comparisons
-            if (op == "==")
-                return TS::Value(a.data == b.data);
-            if (op == "!=")
-                return TS::Value(a.data != b.data);
-            if (op == "===")
-                return TS::Value(a.type == b.type && a.data == b.data);
-            if (op == "!==")
-                return TS::Value(a.type != b.type || a.data != b.data);
-            if (op == "<")
-                return TS::Value(a.toNumber() < b.toNumber());
-            if (op == ">")
-                return TS::Value(a.toNumber() > b.toNumber());
-            if (op == "<=")
-                return TS::Value(a.toNumber() <= b.toNumber());
-            if (op == ">=")
-                return TS::Value(a.toNumber() >= b.toNumber());
-
-            // Logical
-            if (op == "&&")
-                return TS::Value(a.toBool() && b.toBool());
-            if (op == "||")
-                return TS::Value(a.toBool() || b.toBool());
-            if (op == "**")
-                return TS::Value(std::pow(a.toNumber(), b.toNumber()));
-
-            return TS::Value();
+            if (vals.empty())
+                return TS::Value();
+            TS::Value v = std::move(vals.back());
+            vals.pop_back();
+            return v;
         };
 
-        for (size_t i = 0; i < output.size(); ++i)
+        for (const RpnToken &tok : expr.code)
         {
-            const std::string &tok = output[i];
-
-            if (isOperator(tok))
+            switch (tok.kind)
             {
-                TS::Value b = vals.top();
-                vals.pop();
-                TS::Value a = vals.top();
-                vals.pop();
-                vals.push(applyOpVal(tok, a, b));
-            }
-            else if (!tok.empty() && tok[0] == '@')
+            case TokenKind::Literal:
+                vals.push_back(tok.value);
+                break;
+
+            case TokenKind::Variable:
             {
-                // Function call
-                std::string fname = tok.substr(1);
-                int argc = 0;
-                if (i > 0 && output[i - 1][0] == '#')
+                if (tok.path)
                 {
-                    argc = std::stoi(output[i - 1].substr(1));
-                    // Remove arg count marker from stack processing
+                    const TS::Value *local = tok.slot >= 0 ? &env.slots[tok.slot] : nullptr;
+                    const TS::Value *v = resolvePath(*tok.path, local, tok.atom, env);
+                    vals.push_back(v ? *v : TS::Value());
+                    break;
                 }
-                std::vector<TS::Value> args(argc);
-                for (int j = argc - 1; j >= 0; --j)
+                if (tok.slot >= 0)
                 {
-                    args[j] = vals.top();
-                    vals.pop();
+                    vals.push_back(env.slots[tok.slot]);
+                    break;
                 }
-                auto itB = builtins.find(fname);
-                if (itB != builtins.end())
+                const TS::Value *v = env.lookup(tok.atom);
+                vals.push_back(v ? *v : TS::Value());
+                break;
+            }
+
+            case TokenKind::Operator:
+                if (tok.op == OpCode::Neg || tok.op == OpCode::Plus || tok.op == OpCode::Not || tok.op == OpCode::Length)
                 {
-                    vals.push(itB->second(args));
+                    TS::Value a = pop();
+                    vals.push_back(applyUnaryOpVal(tok.op, a));
                 }
                 else
                 {
-                    vals.push(TS::Value()); // undefined
+                    TS::Value b = pop();
+                    TS::Value a = pop();
+                    vals.push_back(applyOpVal(tok.op, a, b));
                 }
+                break;
+
+            case TokenKind::Array:
+            {
+                // Array literal
+                size_t argc = std::min<size_t>(tok.argc, vals.size());
+                std::vector<TS::Value> elements(std::make_move_iterator(vals.end() - argc),
+                                                std::make_move_iterator(vals.end()));
+                vals.resize(vals.size() - argc);
+                vals.push_back(TS::Value::makeArray(std::move(elements)));
+                break;
             }
-            else if (!tok.empty() && tok[0] == '#')
+
+            case TokenKind::Member:
             {
-                // arg count marker — skip, handled above
-                continue;
+                if (vals.empty())
+                    break;
+                const TS::Value *found = TS::findProperty(vals.back(), tok.atom, tok.path->caches[0]);
+                TS::Value v = found ? *found : TS::Value(); // `found` lives in the value it replaces
+                vals.back() = std::move(v);
+                break;
+            }
+
+            case TokenKind::Object:
+            {
+                size_t argc = std::min<size_t>(tok.argc, vals.size());
+                TS::Value object = objectLiteral(*tok.path, vals.data() + vals.size() - argc, argc);
+                vals.resize(vals.size() - argc);
+                vals.push_back(std::move(object));
+                break;
             }
-            else if ((tok.front() == '"' && tok.back() == '"') ||
-                     (tok.front() == '\'' && tok.back() == '\''))
+
+            case TokenKind::New:
             {
-                vals.push(TS::Value(tok.substr(1, tok.size() - 2)));
+                // The instance goes in front of the arguments, as `this`
+                size_t argc = std::min<size_t>(tok.argc, vals.size());
+                size_t base = vals.size() - argc;
+                vals.insert(vals.begin() + base, TS::Value());
+                TS::Value instance = construct(*tok.path, tok.atom, vals.data() + base, argc + 1, callables, ctx);
+                vals.resize(base);
+                vals.push_back(std::move(instance));
+                break;
             }
-            else if (tok == "true")
-                vals.push(TS::Value(true));
-            else if (tok == "false")
-                vals.push(TS::Value(false));
-            else if (tok == "undefined" || tok == "null")
-                vals.push(TS::Value());
-            else if (tok == "NaN")
-                vals.push(TS::Value(std::numeric_limits<NUMBER>::quiet_NaN()));
-            else
+
+            case TokenKind::Method:
+            {
+                // The receiver is below the arguments, where `this` goes
+                size_t argc = std::min<size_t>(tok.argc, vals.size());
+                if (vals.size() == argc)
+                    vals.insert(vals.begin(), TS::Value());
+                size_t base = vals.size() - argc - 1;
+                TS::Value result; // undefined when there is no such method
+                callMethod(*tok.path, vals.data() + base, argc + 1, callables, ctx, result);
+                vals.resize(base);
+                vals.push_back(std::move(result));
+                break;
+            }
+
+            case TokenKind::Call:
             {
-                // Number or variable
-                try
+                // Function call
+                size_t argc = std::min<size_t>(tok.argc, vals.size());
+                size_t base = vals.size() - argc;
+                const Callable *callee = callables.find(tok.atom);
+                TS::Value result; // undefined when the callee is unknown
+                if (callee)
                 {
-                    NUMBER num = std::stod(tok);
-                    vals.push(TS::Value(num));
+#ifndef REMOVE_PROFILER
+                    // User functions open their own frame in runFunctionBody
+                    Profiler::Frame frame(ctx && !callee->user ? ctx->profiler : nullptr, tok.name, true);
+#endif
+                    // Fixed-arity builtins take their operands in place
+                    if (argc == 1 && callee->fn1)
+                        result = callee->fn1(vals[base]);
+                    else if (argc == 2 && callee->fn2)
+                        result = callee->fn2(vals[base], vals[base + 1]);
+                    else
+                        result = callee->fn(Args(vals.data() + base, argc, ctx));
                 }
-                catch (...)
+                else if (tok.path)
                 {
-                    auto it = env.find(tok);
-                    if (it != env.end())
-                        vals.push(it->second);
-                    else
-                        vals.push(TS::Value());
+                    // `p.move(...)`: a method of the object `p` holds
+                    vals.insert(vals.begin() + base, TS::Value());
+                    const TS::Value *local = tok.slot >= 0 ? &env.slots[tok.slot] : nullptr;
+                    result = callPathMethod(*tok.path, local, vals.data() + base, argc, callables, ctx, env);
                 }
+                vals.resize(base);
+                vals.push_back(std::move(result));
+                break;
+            }
             }
         }
 
         if (!vals.empty())
-            return vals.top();
+            return vals.back();
         return TS::Value();
     }
 
+    TS::Value evalExpression(
+        const Expression &expr,
+        TS::Environment &env,
+        Context &ctx)
+    {
+        return evaluate(expr, env, ctx.callables, ctx.scratch, &ctx);
+    }
+
+    TS::Value evalExpression(
+        const Expression &expr,
+        TS::Environment &env,
+        const CallableRegistry &callables)
+    {
+        alignas(std::max_align_t) char buffer[kLocalScratchBytes];
+        TS::Arena scratch(buffer, sizeof(buffer));
+        return evaluate(expr, env, callables, scratch, nullptr);
+    }
+
+    // Main evaluator: takes expression string + environment
+    TS::Value evalSimpleExpression(
+        const std::string &expr,
+        TS::Environment &env,
+        Context &ctx)
+    {
+        return evalExpression(*compileExpression(expr), env, ctx);
+    }
+
+    TS::Value evalSimpleExpression(
+        const std::string &expr,
+        TS::Environment &env,
+        const CallableRegistry &callables)
+    {
+        return evalExpression(*compileExpression(expr), env, callables);
+    }
+
     static std::string trim(const std::string &s)
     {
         auto start = s.find_first_not_of(" \t\r\n");
@@ -336,151 +432,243 @@ namespace Interpreter
         return s.substr(start, end - start + 1);
     }
 
-    void init(Context &ctx)
+    void CallableRegistry::set(std::string_view name, Callable callable)
+    {
+        uint32_t id = callableId(name);
+        if (id >= entries.size())
+            entries.resize(id + 1);
+        entries[id] = std::move(callable);
+    }
+
+    // Gives a fixed-arity builtin the generic entry point used for any other
+    // argument count: extra arguments are ignored, missing ones yield NaN.
+    static void completeBuiltin(Callable &builtin)
+    {
+        if (builtin.fn)
+            return;
+        if (builtin.fn1)
+        {
+            builtin.fn = [fn1 = builtin.fn1](Args args) -> TS::Value
+            {
+                if (args.empty())
+                    return TS::Value(std::numeric_limits<NUMBER>::quiet_NaN());
+                return fn1(args[0]);
+            };
+        }
+        else if (builtin.fn2)
+        {
+            builtin.fn = [fn2 = builtin.fn2](Args args) -> TS::Value
+            {
+                if (args.size() < 2)
+                    return TS::Value(std::numeric_limits<NUMBER>::quiet_NaN());
+                return fn2(args[0], args[1]);
+            };
+        }
+    }
+
+    // Math.random: splitmix64, 53 random bits scaled to [0, 1)
+    static double nextRandom(uint64_t &state)
+    {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        z ^= z >> 31;
+        return static_cast<double>(z >> 11) * 0x1.0p-53;
+    }
+
+    // setTimeout and setInterval: (callback, ms, ...args)
+    static TS::Value setTimer(Args args, bool repeat)
+    {
+        Context *caller = args.context();
+        if (!caller || args.empty() || args[0].type != TS::ValueType::String)
+            return TS::Value();
+        NUMBER ms = args.size() > 1 ? args[1].toNumber() : 0;
+        uint64_t delay = ms > 0 ? static_cast<uint64_t>(std::min<double>(ms, 1e15)) : 0; // NaN runs next
+        std::vector<TS::Value> rest(args.begin() + std::min<size_t>(args.size(), 2), args.end());
+        return TS::Value(static_cast<NUMBER>(caller->events.setTimer(args[0].asString(), std::move(rest), delay, repeat)));
+    }
+
+    // clearTimeout and clearInterval: (id)
+    static TS::Value clearTimer(Args args)
+    {
+        Context *caller = args.context();
+        if (!caller || args.empty() || args[0].type != TS::ValueType::Number)
+            return TS::Value(false);
+        return TS::Value(caller->events.clearTimer(static_cast<uint32_t>(args[0].asNumber())));
+    }
+
+    // File.* handle arguments
+    static OS::FileReader *fileReader(Args args)
+    {
+        Context *caller = args.context();
+        if (!caller || args.empty() || args[0].type != TS::ValueType::Number)
+            return nullptr;
+        return caller->files.reader(static_cast<uint32_t>(args[0].asNumber()));
+    }
+
+    static OS::FileWriter *fileWriter(Args args)
+    {
+        Context *caller = args.context();
+        if (!caller || args.empty() || args[0].type != TS::ValueType::Number)
+            return nullptr;
+        return caller->files.writer(static_cast<uint32_t>(args[0].asNumber()));
+    }
+
+    // Text File.write and friends write: strings as they are, anything else printed
+    static std::string fileText(const TS::Value &value)
+    {
+        return value.type == TS::ValueType::String ? value.asString() : value.toString();
+    }
+
+    // Bytes of lines File.readLinesAsync hands out per event loop pass
+    constexpr size_t kAsyncReadSlice = 65536;
+
+    // Fills `ctx` with the standard library. Builtins must not capture the
+    // context: one library serves every context (see standardLibrary).
+    static void defineBuiltins(Context &ctx)
     {
 
         // Built-in console.log
-        ctx.builtins["console.log"] = [](const std::vector<TS::Value> &args) -> TS::Value
+        // The line is assembled first and written at once, so runtimes sharing
+        // an output never interleave inside a line
+        __BUILTIN2("console.log")
         {
+            Context *caller = args.context();
+            TS::Arena localScratch;
+            TS::Arena &scratch = caller ? caller->scratch : localScratch;
+            TS::Arena::Scope scope(scratch);
+            std::pmr::string line(&scratch);
             for (size_t i = 0; i < args.size(); ++i)
             {
-                OS::print(args[i].toString());
+                if (args[i].type == TS::ValueType::String)
+                {
+                    line += args[i].asString();
+                }
+                else if (args[i].type == TS::ValueType::Number)
+                {
+                    char buffer[TS::kNumberTextMax];
+                    line.append(buffer, TS::formatNumber(args[i].asNumber(), buffer));
+                }
+                else
+                {
+                    line += args[i].toString();
+                }
                 if (i < args.size() - 1)
-                    OS::print(" ");
+                    line += ' ';
             }
-            OS::printLine("\n");
+            line += "\n\n"; // a blank line after every log
+            OS::Console &console = caller ? *caller->console : OS::standardConsole();
+            console.write(line.data(), line.size());
             return TS::Value(true); // sucess!
         };
 
-        // Built-in constants
-        TS::setVar(ctx.variables, "NaN", TS::Value(std::numeric_limits<NUMBER>::quiet_NaN()));
-        TS::setVar(ctx.variables, "undefined", TS::Value()); // null/undefined equivalent
-        TS::setVar(ctx.variables, "Math.PI", TS::Value(M_PI));
-        TS::setVar(ctx.variables, "Math.E", TS::Value(M_E));
-        TS::setVar(ctx.variables, "Math.EPSILON", TS::Value(2.220446049250313e-16));
-
 #ifndef REMOVE_MATH_LIB
 
         // Math functions
-        ctx.builtins["Math.sqrt"] = [](const std::vector<TS::Value> &args) -> TS::Value
+        __BUILTIN_1("Math.sqrt")
         {
-            if (args.empty())
-                return TS::Value(std::numeric_limits<NUMBER>::quiet_NaN());
-            return TS::Value(std::sqrt(args[0].toNumber()));
+            if (a.isArray())
+                return TS::mapArray(TS::Simd::Unary::Sqrt, a); // element-wise batch
+            return TS::Value(std::sqrt(a.toNumber()));
         };
 
-        ctx.builtins["Math.sin"] = [](const std::vector<TS::Value> &args) -> TS::Value
+        __BUILTIN_1("Math.sin")
         {
-            if (args.empty())
-                return TS::Value(std::numeric_limits<NUMBER>::quiet_NaN());
-            return TS::Value(std::sin(args[0].toNumber()));
+            if (a.isArray())
+                return TS::mapArray(TS::Simd::Unary::Sin, a); // element-wise batch
+            return TS::Value(std::sin(a.toNumber()));
         };
 
-        ctx.builtins["Math.cos"] = [](const std::vector<TS::Value> &args) -> TS::Value
+        __BUILTIN_1("Math.cos")
         {
-            if (args.empty())
-                return TS::Value(std::numeric_limits<NUMBER>::quiet_NaN());
-            return TS::Value(std::cos(args[0].toNumber()));
+            if (a.isArray())
+                return TS::mapArray(TS::Simd::Unary::Cos, a); // element-wise batch
+            return TS::Value(std::cos(a.toNumber()));
         };
 
-        ctx.builtins["Math.tan"] = [](const std::vector<TS::Value> &args) -> TS::Value
+        __BUILTIN_1("Math.tan")
         {
-            if (args.empty())
-                return TS::Value(std::numeric_limits<NUMBER>::quiet_NaN());
-            return TS::Value(std::tan(args[0].toNumber()));
+            return TS::Value(std::tan(a.toNumber()));
         };
 
-        ctx.builtins["Math.pow"] = [](const std::vector<TS::Value> &args) -> TS::Value
+        __BUILTIN_2("Math.pow")
         {
-            if (args.size() < 2)
-                return TS::Value(std::numeric_limits<NUMBER>::quiet_NaN());
-            return TS::Value(std::pow(args[0].toNumber(), args[1].toNumber()));
+            if (a.isArray())
+                return TS::powArray(a, b.toNumber());
+            return TS::Value(std::pow(a.toNumber(), b.toNumber()));
         };
 
-        ctx.builtins["Math.random"] = [](const std::vector<TS::Value> &) -> TS::Value
+        __BUILTIN2("Math.random")
         {
-            return TS::Value(static_cast<NUMBER>(std::rand()) / RAND_MAX);
+            Context *caller = args.context();
+            if (!caller)
+                return TS::Value();
+            return TS::Value(static_cast<NUMBER>(nextRandom(caller->randomState)));
         };
 
-        ctx.builtins["Math.abs"] = [](const std::vector<TS::Value> &args) -> TS::Value
+        __BUILTIN_1("Math.abs")
         {
-            if (args.empty())
-                return TS::Value(std::numeric_limits<NUMBER>::quiet_NaN());
-            return TS::Value(std::fabs(args[0].toNumber()));
+            if (a.isArray())
+                return TS::mapArray(TS::Simd::Unary::Abs, a); // element-wise batch
+            return TS::Value(std::fabs(a.toNumber()));
         };
 
-        ctx.builtins["Math.floor"] = [](const std::vector<TS::Value> &args) -> TS::Value
+        __BUILTIN_1("Math.floor")
         {
-            if (args.empty())
-                return TS::Value(0.0);
-            return TS::Value(std::floor(args[0].toNumber()));
+            if (a.isArray())
+                return TS::mapArray(TS::Simd::Unary::Floor, a); // element-wise batch
+            return TS::Value(std::floor(a.toNumber()));
         };
 
-        ctx.builtins["Math.round"] = [](const std::vector<TS::Value> &args) -> TS::Value
+        __BUILTIN_1("Math.round")
         {
-            if (args.empty())
-                return TS::Value(0.0);
-            return TS::Value(std::round(args[0].toNumber()));
+            return TS::Value(std::round(a.toNumber()));
         };
 
-        ctx.builtins["Math.ceil"] = [](const std::vector<TS::Value> &args) -> TS::Value
+        __BUILTIN_1("Math.ceil")
         {
-            if (args.empty())
-                return TS::Value(0.0);
-            return TS::Value(std::ceil(args[0].toNumber()));
+            return TS::Value(std::ceil(a.toNumber()));
         };
 
-        ctx.builtins["Math.trunc"] = [](const std::vector<TS::Value> &args) -> TS::Value
+        __BUILTIN_1("Math.trunc")
         {
-            if (args.empty())
-                return TS::Value(0.0);
-            return TS::Value(std::trunc(args[0].toNumber()));
+            return TS::Value(std::trunc(a.toNumber()));
         };
 
-        ctx.builtins["Math.exp"] = [](const std::vector<TS::Value> &args) -> TS::Value
+        __BUILTIN_1("Math.exp")
         {
-            if (args.empty())
-                return TS::Value(0.0);
-            return TS::Value(std::exp(args[0].toNumber()));
+            return TS::Value(std::exp(a.toNumber()));
         };
 
-        ctx.builtins["Math.log"] = [](const std::vector<TS::Value> &args) -> TS::Value
+        __BUILTIN_1("Math.log")
         {
-            if (args.empty())
-                return TS::Value(0.0);
-            return TS::Value(std::log(args[0].toNumber()));
+            return TS::Value(std::log(a.toNumber()));
         };
 
-        ctx.builtins["Math.atan"] = [](const std::vector<TS::Value> &args) -> TS::Value
+        __BUILTIN_1("Math.atan")
         {
-            if (args.empty())
-                return TS::Value(0.0);
-            return TS::Value(std::atan(args[0].toNumber()));
+            return TS::Value(std::atan(a.toNumber()));
         };
 
-        ctx.builtins["Math.asin"] = [](const std::vector<TS::Value> &args) -> TS::Value
+        __BUILTIN_1("Math.asin")
         {
-            if (args.empty())
-                return TS::Value(0.0);
-            return TS::Value(std::asin(args[0].toNumber()));
+            return TS::Value(std::asin(a.toNumber()));
         };
 
-        ctx.builtins["Math.acos"] = [](const std::vector<TS::Value> &args) -> TS::Value
+        __BUILTIN_1("Math.acos")
         {
-            if (args.empty())
-                return TS::Value(0.0);
-            return TS::Value(std::acos(args[0].toNumber()));
+            return TS::Value(std::acos(a.toNumber()));
         };
 
-        ctx.builtins["Math.atan2"] = [](const std::vector<TS::Value> &args) -> TS::Value
+        __BUILTIN_2("Math.atan2")
         {
-            if (args.empty())
-                return TS::Value(0.0);
-            return TS::Value(std::atan2(args[0].toNumber(), args[1].toNumber()));
+            return TS::Value(std::atan2(a.toNumber(), b.toNumber()));
         };
 
-        ctx.builtins["Math.max"] = [](const std::vector<TS::Value> &args) -> TS::Value
+        ctx.builtins["Math.max"].fn = [](Args args) -> TS::Value
         {
+            if (args.size() == 1 && args[0].isArray())
+                return TS::Value(TS::maxArray(args[0])); // reduction over the elements
             if (args.empty())
                 return TS::Value(-INFINITY);
             NUMBER m = args[0].toNumber();
@@ -491,8 +679,10 @@ namespace Interpreter
             return TS::Value(m);
         };
 
-        ctx.builtins["Math.min"] = [](const std::vector<TS::Value> &args) -> TS::Value
+        ctx.builtins["Math.min"].fn = [](Args args) -> TS::Value
         {
+            if (args.size() == 1 && args[0].isArray())
+                return TS::Value(TS::minArray(args[0]));
             if (args.empty())
                 return TS::Value(-INFINITY);
             NUMBER m = args[0].toNumber();
@@ -505,7 +695,69 @@ namespace Interpreter
 
 #endif
 
-        ctx.builtins["sizeof"] = [](const std::vector<TS::Value> &args) -> TS::Value
+        // Arrays and typed arrays
+        __BUILTIN("Array")
+        { // Array(n) has n null elements, Array(a, b, ...) holds its arguments
+            if (args.size() == 1 && args[0].type == TS::ValueType::Number)
+                return TS::makeArrayFrom(TS::ValueType::Array, args[0]);
+            return TS::Value::makeArray(std::vector<TS::Value>(args.begin(), args.end()));
+        };
+        __BUILTIN_1("Float64Array")
+        { // Float64Array(length) or Float64Array(array)
+            return TS::makeArrayFrom(TS::ValueType::Float64Array, a);
+        };
+        __BUILTIN_1("Float32Array")
+        {
+            return TS::makeArrayFrom(TS::ValueType::Float32Array, a);
+        };
+#ifdef ADD_STD_HALF
+        __BUILTIN_1("Float16Array")
+        {
+            return TS::makeArrayFrom(TS::ValueType::Float16Array, a);
+        };
+#endif
+        __BUILTIN_1("Array.isArray")
+        {
+            return TS::Value(a.type == TS::ValueType::Array);
+        };
+        __BUILTIN("Array.push")
+        { // Array.push(arr, ...values) returns the new length
+            if (args.empty() || args[0].type != TS::ValueType::Array)
+                return TS::Value();
+            std::vector<TS::Value> &elements = args[0].asArray();
+            for (size_t i = 1; i < args.size(); ++i)
+                elements.push_back(args[i]);
+            return TS::Value(static_cast<NUMBER>(elements.size()));
+        };
+        __BUILTIN_1("Array.copy")
+        {
+            return TS::copyArray(a);
+        };
+        __BUILTIN_2("Array.fill")
+        {
+            TS::fillArray(a, b);
+            return a;
+        };
+        __BUILTIN_1("Array.sum")
+        {
+            return TS::Value(TS::sumArray(a));
+        };
+        __BUILTIN_2("Array.dot")
+        {
+            return TS::Value(TS::dotArrays(a, b));
+        };
+        __BUILTIN_2("Array.scale")
+        {
+            TS::scaleArray(a, b.toNumber());
+            return a;
+        };
+        __BUILTIN_2("Array.add")
+        {
+            TS::addArrays(a, b);
+            return a;
+        };
+
+        ctx.builtins["sizeof"].fn = [](Args args) -> TS::Value
         {
             if (args.empty())
                 return TS::Value(0.0);
@@ -515,14 +767,17 @@ namespace Interpreter
             return TS::Value(static_cast<NUMBER>(sz));
         };
 
-        ctx.builtins["assert"] = [&ctx](const std::vector<TS::Value> &args) -> TS::Value
+        __BUILTIN2("assert")
         {
             if (args.empty())
             {
                 throw std::runtime_error("assert() called with no arguments");
             }
+            Context *caller = args.context();
+            if (!caller)
+                return TS::Value();
 
-            bool condition = evalSimpleExpression(args[0].toString(), ctx.variables, ctx.builtins).toBool();
+            bool condition = evalSimpleExpression(args[0].toString(), caller->variables, *caller).toBool();
             if (!condition)
             {
                 std::string msg = "Assertion failed";
@@ -538,78 +793,94 @@ namespace Interpreter
 #ifdef ADD_STD_HALF
         __BUILTIN("half")
         { // let x = half(a)
-            if (args[0].type != TS::ValueType::Number)
+            if (args.empty() || args[0].type != TS::ValueType::Number)
             {
-                return TS::Value(_half(0));
+                return TS::Value(_half(0.0f));
             }
             return TS::Value(_half(args[0].toNumber()));
-        }
-        __BUILTIN("HalfMath.add")
+        };
+        __BUILTIN_2("HalfMath.add")
         {
-            return TS::Value(std::get<_half>(args[0].data) + std::get<_half>(args[1].data));
-        }
-        __BUILTIN("HalfMath.sub")
+            if (a.type == TS::ValueType::Float16Array)
+                return TS::combineArrays(TS::Simd::Binary::Add, a, b); // element-wise, in float chunks
+            return TS::Value(a.asHalf() + b.asHalf());
+        };
+        __BUILTIN_2("HalfMath.sub")
         {
-            return TS::Value(std::get<_half>(args[0].data) - std::get<_half>(args[1].data));
-        }
-        __BUILTIN("HalfMath.div")
+            if (a.type == TS::ValueType::Float16Array)
+                return TS::combineArrays(TS::Simd::Binary::Sub, a, b); // element-wise, in float chunks
+            return TS::Value(a.asHalf() - b.asHalf());
+        };
+        __BUILTIN_2("HalfMath.div")
         {
-            return TS::Value(std::get<_half>(args[0].data) / std::get<_half>(args[1].data));
-        }
-        __BUILTIN("HalfMath.mul")
+            if (a.type == TS::ValueType::Float16Array)
+                return TS::combineArrays(TS::Simd::Binary::Div, a, b); // element-wise, in float chunks
+            return TS::Value(a.asHalf() / b.asHalf());
+        };
+        __BUILTIN_2("HalfMath.mul")
         {
-            return TS::Value(std::get<_half>(args[0].data) * std::get<_half>(args[1].data));
-        }
-        __BUILTIN("HalfMath.mod")
+            if (a.type == TS::ValueType::Float16Array)
+                return TS::combineArrays(TS::Simd::Binary::Mul, a, b); // element-wise, in float chunks
+            return TS::Value(a.asHalf() * b.asHalf());
+        };
+        __BUILTIN_2("HalfMath.mod")
         {
-            return TS::Value(std::get<_half>(args[0].data) % std::get<_half>(args[1].data));
-        }
-        __BUILTIN("Number") // Explicit Cast to Number
+            return TS::Value(a.asHalf() % b.asHalf());
+        };
+        __BUILTIN_1("Number") // Explicit Cast to Number
         {
-            return TS::Value(static_cast<NUMBER>(static_cast<float>(std::get<_half>(args[0].data))))} __BUILTIN("HalfMath.equal")
+            return TS::Value(static_cast<NUMBER>(static_cast<float>(a.asHalf())));
+        };
+        __BUILTIN_2("HalfMath.equal")
         {
-            return TS::Value(std::get<_half>(args[0].data) == std::get<_half>(args[1].data));
-        }
-        __BUILTIN("HalfMath.ln")
+            return TS::Value(a.asHalf() == b.asHalf());
+        };
+        __BUILTIN_2("HalfMath.ln")
         {
-            return TS::Value(std::get<_half>(args[0].data) < std::get<_half>(args[1].data));
-        }
-        __BUILTIN("HalfMath.bn")
+            return TS::Value(a.asHalf() < b.asHalf());
+        };
+        __BUILTIN_2("HalfMath.bn")
         {
-            return TS::Value(std::get<_half>(args[0].data) > std::get<_half>(args[1].data));
-        }
-        __BUILTIN("HalfMath.ne")
+            return TS::Value(a.asHalf() > b.asHalf());
+        };
+        __BUILTIN_2("HalfMath.ne")
         {
-            return TS::Value(std::get<_half>(args[0].data) != std::get<_half>(args[1].data));
-        }
-        __BUILTIN("HalfMath.ben")
+            return TS::Value(a.asHalf() != b.asHalf());
+        };
+        __BUILTIN_2("HalfMath.ben")
         {
-            return TS::Value(std::get<_half>(args[0].data) >= std::get<_half>(args[1].data));
-        }
-        __BUILTIN("HalfMath.sen")
+            return TS::Value(a.asHalf() >= b.asHalf());
+        };
+        __BUILTIN_2("HalfMath.sen")
         {
-            return TS::Value(std::get<_half>(args[0].data) <= std::get<_half>(args[1].data));
-        }
+            return TS::Value(a.asHalf() <= b.asHalf());
+        };
         __BUILTIN("HalfMath.zero")
         {
-            return TS::Value(_half(0));
-        }
-        __BUILTIN("HalfMath.isZero"){
-            return TS::Value((std::get<_half>(args[0].data) == _half(0)))} __BUILTIN("HalfMath.ELIPSON"){
-            return TS::Value(0.0009765625)} __BUILTIN("HalfMath.isNaN")
+            return TS::Value(_half(0.0f));
+        };
+        __BUILTIN_1("HalfMath.isZero")
         {
-            return TS::Value(std::isnan(static_cast<float>(std::get<_half>(args[0].data))));
-        }
+            return TS::Value(a.asHalf() == _half(0.0f));
+        };
+        __BUILTIN("HalfMath.ELIPSON")
+        {
+            return TS::Value(static_cast<NUMBER>(0.0009765625));
+        };
+        __BUILTIN_1("HalfMath.isNaN")
+        {
+            return TS::Value(static_cast<bool>(std::isnan(static_cast<float>(a.asHalf()))));
+        };
 
 #endif
 #ifndef REDUCE_BUILTIN
-        ctx.builtins["isNaN"] = [](const std::vector<TS::Value> &args) -> TS::Value
+        ctx.builtins["isNaN"].fn = [](Args args) -> TS::Value
         {
             if (args.empty() || args[0].type != TS::ValueType::Number)
             {
                 return TS::Value(false);
             }
-            return TS::Value(std::isnan(std::get<NUMBER>(args[0].data)));
+            return TS::Value(std::isnan(args[0].asNumber()));
         };
         __BUILTIN("typeof")
         {
@@ -621,8 +892,11 @@ namespace Interpreter
             if (args.empty() || args[0].type != TS::ValueType::String)
                 return TS::Value("undefined");
 
-            auto name = std::get<std::string>(args[0].data);
-            auto var = TS::getVar(ctx.variables, name);
+            Context *caller = args.context();
+            if (!caller)
+                return TS::Value();
+            auto name = args[0].asString();
+            auto var = TS::getVar(caller->variables, name);
             return TS::Value(var ? _stringify_type(var->type) : "undefined");
         };
 
@@ -632,7 +906,7 @@ namespace Interpreter
             {
                 return TS::Value(); // return NULL
             }
-            return TS::Value(static_cast<NUMBER>(std::get<std::string>(args[0].data).size()));
+            return TS::Value(static_cast<NUMBER>(args[0].asString().size()));
         };
 
         __BUILTIN("trimStr")
@@ -641,30 +915,240 @@ namespace Interpreter
             {
                 return TS::Value(); // return NULL
             }
-            std::string str = std::get<std::string>(args[0].data);
+            std::string str = args[0].asString();
             __trim(str);
             return TS::Value(str);
         };
 
-        __BUILTIN2("require")
+        // Event loop (see events.h): callbacks are user functions named by a string
+        __BUILTIN2("setTimeout")
+        { // setTimeout(callback, ms, ...args) runs callback(...args) once, after ms
+            return setTimer(args, false);
+        };
+        __BUILTIN2("setInterval")
+        { // setInterval(callback, ms, ...args) runs callback(...args) every ms
+            return setTimer(args, true);
+        };
+        __BUILTIN2("clearTimeout")
         {
-            if (args.empty() || args[0].type != TS::ValueType::String)
+            return clearTimer(args);
+        };
+        __BUILTIN2("clearInterval")
+        {
+            return clearTimer(args);
+        };
+        __BUILTIN2("queueMicrotask")
+        { // queueMicrotask(callback, ...args) runs callback(...args) once the current code returns
+            Context *caller = args.context();
+            if (!caller || args.empty() || args[0].type != TS::ValueType::String)
+                return TS::Value(false);
+            caller->events.queueMicrotask(args[0].asString(), std::vector<TS::Value>(args.begin() + 1, args.end()));
+            return TS::Value(true);
+        };
+        __BUILTIN2("watchLines")
+        { // watchLines(path, callback) calls callback(line) per line read, then callback(undefined)
+            Context *caller = args.context();
+            if (!caller || args.size() < 2 || args[0].type != TS::ValueType::String ||
+                args[1].type != TS::ValueType::String)
+                return TS::Value();
+            uint32_t id = caller->events.watchLines(args[0].asString(), args[1].asString());
+            return id ? TS::Value(static_cast<NUMBER>(id)) : TS::Value();
+        };
+        __BUILTIN2("unwatch")
+        {
+            Context *caller = args.context();
+            if (!caller || args.empty() || args[0].type != TS::ValueType::Number)
+                return TS::Value(false);
+            return TS::Value(caller->events.unwatch(static_cast<uint32_t>(args[0].asNumber())));
+        };
+
+        // Files, read and written a chunk or a line at a time (see files.h)
+        __BUILTIN2("File.open")
+        { // File.open(path, mode) with mode "r" (the default), "w" or "a": a handle, or undefined
+            Context *caller = args.context();
+            if (!caller || args.empty() || args[0].type != TS::ValueType::String)
+                return TS::Value();
+            std::string mode = args.size() > 1 && args[1].type == TS::ValueType::String ? args[1].asString() : "r";
+            uint32_t handle = caller->files.open(args[0].asString(), mode);
+            return handle ? TS::Value(static_cast<NUMBER>(handle)) : TS::Value();
+        };
+        __BUILTIN2("File.readLine")
+        { // File.readLine(handle): the next line, or undefined at the end
+            OS::FileReader *reader = fileReader(args);
+            std::string_view line;
+            if (!reader || !reader->readLine(line))
+                return TS::Value();
+            return TS::Value(std::string(line));
+        };
+        __BUILTIN2("File.readChunk")
+        { // File.readChunk(handle, size): up to size bytes (default 65536), or undefined at the end
+            OS::FileReader *reader = fileReader(args);
+            NUMBER size = args.size() > 1 ? args[1].toNumber() : 65536;
+            std::string_view chunk;
+            if (!reader || !(size >= 1) || !reader->read(static_cast<size_t>(std::min<double>(size, 1e9)), chunk))
+                return TS::Value();
+            return TS::Value(std::string(chunk));
+        };
+        __BUILTIN2("File.write")
+        { // File.write(handle, text)
+            OS::FileWriter *writer = fileWriter(args);
+            return TS::Value(writer && args.size() > 1 && writer->write(fileText(args[1])));
+        };
+        __BUILTIN2("File.append")
+        { // File.append(path, text) adds text to the end of a file in one call
+            if (args.size() < 2 || args[0].type != TS::ValueType::String)
+                return TS::Value(false);
+            OS::FileWriter writer;
+            bool ok = writer.open(args[0].asString(), true) && writer.write(fileText(args[1]));
+            return TS::Value(writer.close() && ok);
+        };
+        __BUILTIN2("File.close")
+        {
+            Context *caller = args.context();
+            if (!caller || args.empty() || args[0].type != TS::ValueType::Number)
+                return TS::Value(false);
+            return TS::Value(caller->files.close(static_cast<uint32_t>(args[0].asNumber())));
+        };
+        __BUILTIN2("File.readLinesAsync")
+        { // File.readLinesAsync(handle, callback): callback(line) from the event loop, then
+          // callback(undefined) and the handle is closed
+            Context *caller = args.context();
+            if (!fileReader(args) || args.size() < 2 || args[1].type != TS::ValueType::String)
+                return TS::Value(false);
+            uint32_t handle = static_cast<uint32_t>(args[0].asNumber());
+            std::string callback = args[1].asString();
+            caller->events.addJob([handle, callback](Context &ctx)
             {
+                // A slice per pass, so timers and input are served in between
+                uint32_t callee = callableId(callback);
+                size_t bytes = 0;
+                while (bytes < kAsyncReadSlice)
+                {
+                    OS::FileReader *reader = ctx.files.reader(handle);
+                    if (!reader)
+                        return false; // closed by the callback
+                    std::string_view line;
+                    TS::Value value; // undefined at the end
+                    bool more = reader->readLine(line);
+                    if (more)
+                        value = TS::Value(std::string(line));
+                    else
+                        ctx.files.close(handle);
+                    callStatement(callback, callee, Args(&value, 1, &ctx), ctx);
+                    if (!more)
+                        return false;
+                    bytes += line.size() + 1;
+                }
+                return true;
+            });
+            return TS::Value(true);
+        };
+        __BUILTIN2("File.writeAsync")
+        { // File.writeAsync(handle, text, callback): writes from the event loop, then callback(ok)
+            Context *caller = args.context();
+            if (!fileWriter(args) || args.size() < 3 || args[2].type != TS::ValueType::String)
                 return TS::Value(false);
-            }
-            std::string temp;
-            OS::readFile(args[0].toString() + ".ts", temp);
-            std::istringstream iss(temp);
-            std::vector<std::string> lines;
-            std::string line;
-            while (std::getline(iss, line))
+            uint32_t handle = static_cast<uint32_t>(args[0].asNumber());
+            std::string text = fileText(args[1]);
+            std::string callback = args[2].asString();
+            caller->events.addJob([handle, text = std::move(text), callback](Context &ctx)
             {
-                lines.push_back(line);
-            }
-            executeScript(lines, ctx);
+                OS::FileWriter *writer = ctx.files.writer(handle);
+                TS::Value ok(writer && writer->write(text) && writer->flush());
+                callStatement(callback, callableId(callback), Args(&ok, 1, &ctx), ctx);
+                return false;
+            });
             return TS::Value(true);
         };
+
+        __BUILTIN2("require")
+        {
+            if (args.empty() || args[0].type != TS::ValueType::String)
+            {
+                return TS::Value(false);
+            }
+            Context *caller = args.context();
+            if (!caller)
+                return TS::Value();
+            return TS::Value(requireModule(*caller, args[0].toString() + ".ts"));
+        };
 #endif
+
+        // Publish every builtin in the callable registry once
+        for (auto &builtin : ctx.builtins)
+        {
+            completeBuiltin(builtin.second);
+            ctx.callables.set(builtin.first, builtin.second);
+        }
+    }
+
+    // The standard library: built on first use (thread-safe), then only read
+    static const Context &standardLibrary()
+    {
+        struct Library
+        {
+            Context ctx;
+            Library() { defineBuiltins(ctx); }
+        };
+        static const Library library;
+        return library.ctx;
+    }
+
+    // Built-in constants, defined by init and substituted by constant folding
+    struct StandardConstant
+    {
+        const char *name;
+        TS::Value value;
+    };
+
+    static const std::vector<StandardConstant> &standardConstants()
+    {
+        static const std::vector<StandardConstant> constants = {
+            {"NaN", TS::Value(std::numeric_limits<NUMBER>::quiet_NaN())},
+            {"undefined", TS::Value()}, // null/undefined equivalent
+            {"Math.PI", TS::Value(M_PI)},
+            {"Math.E", TS::Value(M_E)},
+            {"Math.EPSILON", TS::Value(2.220446049250313e-16)},
+        };
+        return constants;
+    }
+
+    const TS::Value *standardConstant(std::string_view name)
+    {
+        for (const StandardConstant &constant : standardConstants())
+        {
+            if (name == constant.name)
+                return &constant.value;
+        }
+        return nullptr;
+    }
+
+    const Callable *standardBuiltin(std::string_view name)
+    {
+        return standardLibrary().callables.find(name);
+    }
+
+    bool isPureBuiltin(std::string_view name)
+    {
+        static const std::unordered_set<std::string_view> pure = {
+            "Math.sqrt", "Math.sin", "Math.cos", "Math.tan", "Math.pow", "Math.abs",
+            "Math.floor", "Math.round", "Math.ceil", "Math.trunc", "Math.exp", "Math.log",
+            "Math.atan", "Math.asin", "Math.acos", "Math.atan2", "Math.max", "Math.min",
+            "typeof", "lenStr", "trimStr"};
+        return pure.count(name) && standardBuiltin(name);
+    }
+
+    void init(Context &ctx)
+    {
+        for (const StandardConstant &constant : standardConstants())
+            TS::setVar(ctx.variables, constant.name, constant.value);
+
+        ctx.callables.setShared(&standardLibrary().callables);
+    }
+
+    void seedRandom(Context &ctx, uint64_t seed)
+    {
+        ctx.randomState = seed;
     }
     // Needed to advoid errors.
     static inline void __trim(std::string &s)
@@ -700,672 +1184,469 @@ namespace Interpreter
             return "null";
         case TS::ValueType::String:
             return "string";
+        case TS::ValueType::Object:
+        case TS::ValueType::Array:
+        case TS::ValueType::Float64Array:
+        case TS::ValueType::Float32Array:
+        case TS::ValueType::Float16Array:
+            return "object";
         default:
             return "any";
         }
     }
 
-    void executeLine(const std::string &rawLine, Context &ctx)
+    /**
+     * How a statement finished: normally, or by transferring control out of its block.
+     */
+    enum class Completion : uint8_t
     {
-        std::string line = trim(rawLine);
-        if (line.empty() || line[0] == '/' && line[1] == '/')
-            return; // skip comments
+        Normal,
+        Break,
+        Continue,
+        Return // the returned value is in the `result` passed to executeStatement
+    };
 
-        // Handle variable declaration: let x = 10; or let x:any = 10;
-        if (line.rfind("let ", 0) == 0)
-        {
-            line = line.substr(4);
-            auto eqPos = line.find('=');
-            if (eqPos == std::string::npos)
-            {
-                OS::printLine("SyntaxError: Missing '=' in let statement");
-                return;
-            }
+    static Completion executeStatement(const Statement &stmt, Context &ctx, TS::Environment &scope, TS::Value &result);
+    static Completion executeBlock(const Block &block, Context &ctx, TS::Environment &scope, TS::Value &result);
 
-            std::string varName = trim(line.substr(0, eqPos));
-            if (varName.empty())
-            {
-                OS::printLine("SyntaxError: Missing variable name");
-                return;
-            }
+    // Runs a user function body in a fresh local scope and returns its result.
+    static TS::Value runFunctionBody(const std::string &name, const FunctionDef &def, Args args, Context &ctx);
 
-            // Strip optional type annotation
-            if (auto colonPos = varName.find(':'); colonPos != std::string::npos)
+    void registerBuiltin(Context &ctx, const std::string &name, Function fn)
+    {
+        Callable &builtin = ctx.builtins[name];
+        builtin = Callable{std::move(fn)};
+        ctx.callables.set(name, builtin);
+    }
+
+    // Methods and constructors take their instance as an implicit first argument, `this`
+    static size_t implicitArgs(const FunctionDef &def)
+    {
+        return !def.params.empty() && def.params[0] == "this" ? 1 : 0;
+    }
+
+    void defineFunction(Context &ctx, const std::string &name, const FunctionDef &def)
+    {
+        FunctionDef &stored = ctx.userFunctions[name];
+        stored = def;
+        const FunctionDef *defPtr = &stored;
+
+        // Wrap the user function once so expressions can call it like a builtin
+        Callable callable;
+        callable.user = defPtr;
+        callable.fn = [&ctx, name, defPtr](Args args) -> TS::Value
+        {
+            // Simple arg count check
+            if (args.size() != defPtr->params.size())
             {
-                varName = trim(varName.substr(0, colonPos));
+                size_t implicit = implicitArgs(*defPtr);
+                ctx.console->printLine("Error: Function '" + name + "' expects " +
+                              std::to_string(defPtr->params.size() - implicit) + " args, got " +
+                              std::to_string(args.size() - std::min(implicit, args.size())));
+                return TS::Value();
             }
+            return runFunctionBody(name, *defPtr, args, ctx);
+        };
+        ctx.callables.set(name, std::move(callable));
+    }
 
-            std::string expr = trim(line.substr(eqPos + 1));
-            if (!expr.empty() && expr.back() == ';')
-                expr.pop_back();
+    // Frames with at most this many slots live entirely on the C++ stack (larger ones in ctx.scratch)
+    constexpr uint32_t kInlineFrameSlots = 8;
 
-            try
-            {
-                // Merge builtins + user functions into one callable map
-                std::unordered_map<std::string, std::function<TS::Value(const std::vector<TS::Value> &)>> callables(ctx.builtins);
+#ifndef REMOVE_VM
+    // Counts a call of `def` and compiles it once hot; true if it has bytecode
+    static bool tierUp(const FunctionDef &def, const Context &ctx)
+    {
+        FunctionTier &tier = def.tier;
+        if (tier.code)
+            return true;
+        if (tier.unsupported || ctx.hotCallThreshold == 0 || ++tier.calls < ctx.hotCallThreshold)
+            return false;
+        tier.code = compileBytecode(def);
+        tier.unsupported = !tier.code;
+        return tier.code != nullptr;
+    }
+#endif
 
-                // Wrap user functions so they look like builtins
-                for (auto &uf : ctx.userFunctions)
-                {
-                    callables[uf.first] = [&ctx, name = uf.first](const std::vector<TS::Value> &args) -> TS::Value
-                    {
-                        auto &def = ctx.userFunctions.at(name);
-
-                        // Simple arg count check
-                        if (args.size() != def.params.size())
-                        {
-                            OS::printLine("Error: Function '" + name + "' expects " +
-                                          std::to_string(def.params.size()) + " args, got " +
-                                          std::to_string(args.size()));
-                            return TS::Value();
-                        }
-
-                        // Local scope
-                        Interpreter::Context localCtx = ctx;
-                        for (size_t i = 0; i < def.params.size(); ++i)
-                        {
-                            TS::setVar(localCtx.variables, def.params[i], args[i]);
-                        }
-
-                        // Execute body
-                        for (auto &bodyLine : def.bodyLines)
-                        {
-                            std::string trimmed = trim(bodyLine);
-                            if (trimmed.rfind("return", 0) == 0)
-                            {
-                                // Strip "return" and optional semicolon
-                                std::string retExpr = trim(trimmed.substr(6));
-                                if (!retExpr.empty() && retExpr.back() == ';')
-                                    retExpr.pop_back();
-
-                                // Evaluate and return immediately
-                                return evalSimpleExpression(retExpr, localCtx.variables, /* merged callables */ ctx.builtins);
-                            }
-
-                            Interpreter::executeLine(bodyLine, localCtx);
-                        }
-                        return TS::Value(); // no return yet
-                    };
-                }
+    static TS::Value runFunctionBody(const std::string &name, const FunctionDef &def, Args args, Context &ctx)
+    {
+#ifndef REMOVE_VM
+        // Hot functions run as bytecode; profiled runs stay interpreted so
+        // every statement is still reported
+        if (!ctx.profiler && tierUp(def, ctx))
+        {
+            std::shared_ptr<const Bytecode> code = def.tier.code; // survives a redefinition during the call
+            TS::Value result;
+            if (runBytecode(*code, args, ctx, result))
+                return result;
+        }
+#endif
+#ifndef REMOVE_PROFILER
+        Profiler::Frame profilerFrame(ctx.profiler, name);
+#endif
+        // Local scope: a frame holding only the parameters and locals, chained to the globals
+        TS::Value inlineSlots[kInlineFrameSlots];
+        TS::Arena::Scope frameScope(ctx.scratch);
+        std::pmr::vector<TS::Value> arenaSlots(&ctx.scratch);
+        TS::Value *slots = inlineSlots;
+        if (def.slotCount > kInlineFrameSlots)
+        {
+            arenaSlots.resize(def.slotCount);
+            slots = arenaSlots.data();
+        }
+        for (size_t i = 0; i < def.params.size(); ++i)
+        {
+            slots[i] = args[i];
+        }
+        TS::Environment frame(&ctx.variables, slots, def.slotCount);
 
-                // Now evaluate with both builtins and user functions
-                TS::Value val = evalSimpleExpression(expr, ctx.variables, callables);
-                TS::setVar(ctx.variables, varName, val);
-            }
-            catch (const std::exception &e)
-            {
-                OS::printLine(std::string("Error evaluating expression: ") + e.what());
-            }
+        // Execute body; a `return` anywhere inside it completes the call
+        TS::Value result;
+        if (executeBlock(def.body, ctx, frame, result) != Completion::Return)
+            return TS::Value(); // no return
+        return result;
+    }
+
+    void callStatement(const std::string &funcName, uint32_t calleeId, Args args, Context &ctx, const DeclaredType *argTypes)
+    {
+        const Callable *callee = ctx.callables.find(calleeId);
+        if (!callee)
+        {
+            ctx.console->printLine("Error: Unknown function '" + funcName + "'");
             return;
         }
 
-        // Handle function definition: function name(param1, param2) { ... }
-        if (line.rfind("function ", 0) == 0)
+        // --- Built-in function? ---
+        if (!callee->user)
         {
-            std::string header = line;
-
-            // Extract function name and params
-            auto nameStart = header.find(' ') + 1;
-            auto parenOpen = header.find('(', nameStart);
-            auto parenClose = header.find(')', parenOpen);
+#ifndef REMOVE_PROFILER
+            Profiler::Frame frame(ctx.profiler, funcName, true);
+#endif
+            callee->fn(args);
+            return;
+        }
 
-            std::string funcName = trim(header.substr(nameStart, parenOpen - nameStart));
-            std::string paramsStr = header.substr(parenOpen + 1, parenClose - parenOpen - 1);
+        // --- User-defined function ---
+        const FunctionDef &def = *callee->user;
 
-            FunctionDef def;
+        // Type checking
+        if (args.size() != def.params.size())
+        {
+            size_t implicit = implicitArgs(def);
+            ctx.console->printLine("Error: Function '" + funcName + "' expects " +
+                          std::to_string(def.params.size() - implicit) + " arguments, got " +
+                          std::to_string(args.size() - std::min(implicit, args.size())));
+            return;
+        }
 
-            // Parse parameters with optional type annotations
-            std::istringstream pss(paramsStr);
-            std::string param;
-            while (std::getline(pss, param, ','))
+        // Declared types were resolved at compile time; arguments whose type
+        // the compiler proved need no check
+        for (size_t i = 0; i < def.params.size(); ++i)
+        {
+            DeclaredType expected = def.declaredTypes[i];
+            if (expected == DeclaredType::Any || (argTypes && argTypes[i] == expected))
+                continue;
+            if (!hasDeclaredType(args[i], expected))
             {
-                param = trim(param);
-                if (param.empty())
-                    continue;
-
-                std::string paramName = param;
-                std::string paramType = "any"; // default
-
-                auto colonPos = param.find(':');
-                if (colonPos != std::string::npos)
-                {
-                    paramName = trim(param.substr(0, colonPos));
-                    paramType = trim(param.substr(colonPos + 1));
-                }
-
-                def.params.push_back(paramName);
-                def.paramTypes.push_back(paramType);
+                ctx.console->printLine("TypeError: Argument '" + def.params[i] + "' expected " +
+                              def.paramTypes[i] + ", got " + args[i].toString());
+                return;
             }
+        }
 
-            // --- Multi-line body capture ---
-            std::string bodyLine;
-            int braceDepth = 0;
-
-            // If the opening brace is on the same line
-            auto braceOpen = header.find('{', parenClose);
-            if (braceOpen != std::string::npos)
-            {
-                braceDepth = 1;
-                std::string afterBrace = trim(header.substr(braceOpen + 1));
-                if (!afterBrace.empty())
-                    def.bodyLines.push_back(afterBrace);
-            }
+        runFunctionBody(funcName, def, args, ctx);
+    }
 
-            // Read subsequent lines until matching closing brace
-            while (braceDepth > 0 && std::getline(std::cin, bodyLine))
-            {
-                std::string trimmed = trim(bodyLine);
-                if (trimmed.find('{') != std::string::npos)
-                    braceDepth++;
-                if (trimmed.find('}') != std::string::npos)
-                {
-                    braceDepth--;
-                    if (braceDepth <= 0)
-                        break;
-                }
-                if (!trimmed.empty() && braceDepth > 0)
-                {
-                    def.bodyLines.push_back(trimmed);
-                }
-            }
+    static void executeCall(const Statement &stmt, Context &ctx, TS::Environment &scope)
+    {
+        TS::Arena::Scope argsScope(ctx.scratch);
+        std::pmr::vector<TS::Value> args(&ctx.scratch);
+        args.reserve(stmt.args.size());
+        for (auto &arg : stmt.args)
+            args.push_back(evalExpression(*arg, scope, ctx));
 
-            ctx.userFunctions[funcName] = def;
+        if (stmt.path)
+        {
+            // args[0] is left for the instance, should the call be a method call
+            args.insert(args.begin(), TS::Value());
+            const TS::Value *local = stmt.slot >= 0 ? &scope.slots[stmt.slot] : nullptr;
+            callPathStatement(stmt.name, stmt.atom, *stmt.path, local, args.data(), stmt.args.size(), ctx, scope,
+                              stmt.argTypes.data());
             return;
         }
+        callStatement(stmt.name, stmt.atom, Args(args, &ctx), ctx, stmt.argTypes.data());
+    }
 
-        if (line.rfind("if ", 0) == 0)
+    void callPathStatement(const std::string &name, uint32_t callee, const PropertyPath &path, const TS::Value *local,
+                           TS::Value *args, size_t argc, Context &ctx, TS::Environment &env, const DeclaredType *argTypes)
+    {
+        if (ctx.callables.find(callee))
         {
-            // Merge builtins + user functions into one callable map
-            std::unordered_map<std::string, std::function<TS::Value(const std::vector<TS::Value> &)>> callables(ctx.builtins);
+            callStatement(name, callee, Args(args + 1, argc, &ctx), ctx, argTypes);
+            return;
+        }
+        const TS::Value *receiver = pathOwner(path, local, env);
+        uint32_t method;
+        if (receiver && TS::findMethod(*receiver, path.keys.back(), path.method, method))
+        {
+            TS::Value self = *receiver; // `receiver` may be args[0] itself
+            args[0] = std::move(self);
+            // Reported as the class member it runs; argument types are checked at the call
+            callStatement(TS::atomName(method), method, Args(args, argc + 1, &ctx), ctx);
+            return;
+        }
+        ctx.console->printLine("Error: Unknown function '" + name + "'");
+    }
 
-            // Wrap user functions so they look like builtins
-            for (auto &uf : ctx.userFunctions)
-            {
-                callables[uf.first] = [&ctx, name = uf.first](const std::vector<TS::Value> &args) -> TS::Value
-                {
-                    auto &def = ctx.userFunctions.at(name);
-
-                    // Simple arg count check
-                    if (args.size() != def.params.size())
-                    {
-                        OS::printLine("Error: Function '" + name + "' expects " +
-                                      std::to_string(def.params.size()) + " args, got " +
-                                      std::to_string(args.size()));
-                        return TS::Value();
-                    }
-                    // Local scope
-                    Interpreter::Context localCtx = ctx;
-                    for (size_t i = 0; i < def.params.size(); ++i)
-                    {
-                        TS::setVar(localCtx.variables, def.params[i], args[i]);
-                    }
-
-                    // Execute body
-                    for (auto &bodyLine : def.bodyLines)
-                    {
-                        std::string trimmed = trim(bodyLine);
-                        if (trimmed.rfind("return", 0) == 0)
-                        {
-                            // Strip "return" and optional semicolon
-                            std::string retExpr = trim(trimmed.substr(6));
-                            if (!retExpr.empty() && retExpr.back() == ';')
-                                retExpr.pop_back();
-
-                            // Evaluate and return immediately
-                            return evalSimpleExpression(retExpr, localCtx.variables, /* merged callables */ ctx.builtins);
-                        }
-
-                        Interpreter::executeLine(bodyLine, localCtx);
-                    }
-                    return TS::Value(); // no return
-                };
-            }
+    // Profiler memory accounting: strings and arrays a statement stores or returns
+    static inline void profileValue(Context &ctx, const TS::Value &val)
+    {
+#ifndef REMOVE_PROFILER
+        if (ctx.profiler && (val.type == TS::ValueType::String || val.isArray()))
+            ctx.profiler->allocated(val.size());
+#else
+        (void)ctx;
+        (void)val;
+#endif
+    }
 
-            // Extract condition between parentheses
-            auto condStart = line.find('(');
-            auto condEnd = line.find(')', condStart);
-            if (condStart == std::string::npos || condEnd == std::string::npos)
-            {
-                OS::printLine("SyntaxError: malformed if statement");
+    static void assign(const Statement &stmt, TS::Environment &scope, TS::Value val)
+    {
+        if (stmt.path)
+        {
+            // A property, or else a dotted global such as a class static
+            const TS::Value *local = stmt.slot >= 0 ? &scope.slots[stmt.slot] : nullptr;
+            if (assignPath(*stmt.path, local, scope, val))
                 return;
-            }
-            std::string condExpr = trim(line.substr(condStart + 1, condEnd - condStart - 1));
-            TS::Value condVal = evalSimpleExpression(condExpr, ctx.variables, callables);
+        }
+        else if (stmt.slot >= 0)
+        {
+            scope.slots[stmt.slot] = std::move(val);
+            return;
+        }
+        // Existing variables are updated where they live, new ones become globals
+        if (TS::Value *existing = scope.lookup(stmt.atom))
+        {
+            *existing = std::move(val);
+            return;
+        }
+        TS::Environment *global = &scope;
+        while (global->parent)
+            global = global->parent;
+        TS::setVar(*global, stmt.atom, val);
+    }
 
-            bool condTrue = condVal.toBool();
+    // The array `name[index] = expr` writes to: a variable, or a property such as `this.items`
+    static const TS::Value *elementTarget(const Statement &stmt, TS::Environment &scope)
+    {
+        const TS::Value *local = stmt.slot >= 0 ? &scope.slots[stmt.slot] : nullptr;
+        if (stmt.path)
+            return resolvePath(*stmt.path, local, stmt.atom, scope);
+        return local ? local : scope.lookup(stmt.atom);
+    }
 
-            // Find block start
-            auto braceStart = line.find('{', condEnd);
-            if (braceStart == std::string::npos)
-            {
-                OS::printLine("SyntaxError: if without block");
-                return;
-            }
+    // Writes `name[index] = expr`; the array is shared, so every copy sees the write.
+    static void assignElement(const Statement &stmt, Context &ctx, TS::Environment &scope)
+    {
+        const TS::Value *target = elementTarget(stmt, scope);
+        if (!target || !target->isArray())
+        {
+            ctx.console->printLine("TypeError: '" + stmt.name + "' is not an array");
+            return;
+        }
+        NUMBER index = evalExpression(*stmt.index, scope, ctx).toNumber();
+        TS::Value val = evalExpression(*stmt.expr, scope, ctx);
+        if (!(index >= 0) || index != std::floor(index))
+        {
+            ctx.console->printLine("RangeError: invalid index for '" + stmt.name + "'");
+            return;
+        }
+        // Re-resolve: evaluating the value may have rebound the variable
+        target = elementTarget(stmt, scope);
+        if (target && target->isArray())
+            target->setAt(static_cast<size_t>(index), val);
+    }
 
-            // Collect block lines until matching }
-            int depth = 1;
-            std::vector<std::string> blockLines;
-            std::string blockLine;
-            while (depth > 0 && std::getline(std::cin, blockLine))
-            {
-                if (blockLine.find('{') != std::string::npos)
-                    depth++;
-                if (blockLine.find('}') != std::string::npos)
-                {
-                    depth--;
-                    if (depth == 0)
-                        break;
-                }
-                if (depth > 0)
-                    blockLines.push_back(blockLine);
-            }
+    // Runs a loop body once; returns true if the loop should stop.
+    static bool runLoopBody(const Statement &stmt, Context &ctx, TS::Environment &scope, TS::Value &result, Completion &completion)
+    {
+        completion = executeBlock(stmt.body, ctx, scope, result);
+        if (completion == Completion::Break)
+        {
+            completion = Completion::Normal;
+            return true;
+        }
+        if (completion == Completion::Continue)
+            completion = Completion::Normal;
+        return completion == Completion::Return;
+    }
 
-            if (condTrue)
+    static Completion executeStatement(const Statement &stmt, Context &ctx, TS::Environment &scope, TS::Value &result)
+    {
+        switch (stmt.kind)
+        {
+        case StatementKind::Let:
+            try
             {
-                for (auto &bl : blockLines)
-                    executeLine(bl, ctx);
+                TS::Value val = evalExpression(*stmt.expr, scope, ctx);
+                profileValue(ctx, val);
+                if (stmt.slot >= 0)
+                    scope.slots[stmt.slot] = std::move(val);
+                else
+                    TS::setVar(scope, stmt.atom, val);
             }
-            else
+            catch (const std::exception &e)
             {
-                // Peek for else
-                std::string elseLine;
-                if (std::getline(std::cin, elseLine))
-                {
-                    elseLine = trim(elseLine);
-                    if (elseLine.rfind("else", 0) == 0)
-                    {
-                        // Expect another block
-                        std::vector<std::string> elseBlock;
-                        int edepth = 0;
-                        std::string el;
-                        while (std::getline(std::cin, el))
-                        {
-                            if (el.find('{') != std::string::npos)
-                                edepth++;
-                            if (el.find('}') != std::string::npos)
-                            {
-                                edepth--;
-                                if (edepth == 0)
-                                    break;
-                            }
-                            if (edepth > 0)
-                                elseBlock.push_back(el);
-                        }
-                        for (auto &bl : elseBlock)
-                            executeLine(bl, ctx);
-                    }
-                }
+                ctx.console->printLine(std::string("Error evaluating expression: ") + e.what());
             }
-            return;
-        }
+            return Completion::Normal;
 
-        if (line.rfind("class ", 0) == 0)
-        {
-            // Extract class name
-            auto nameStart = 6;
-            auto nameEnd = line.find('{', nameStart);
-            std::string className = trim(line.substr(nameStart, nameEnd - nameStart));
-
-            // Read class body until matching '}'
-            int depth = 0;
-            std::vector<std::string> bodyLines;
-            std::string bodyLine;
-
-            if (line.find('{') != std::string::npos)
-                depth++;
-            while (depth > 0 && std::getline(std::cin, bodyLine))
+        case StatementKind::Assign:
+            try
             {
-                if (bodyLine.find('{') != std::string::npos)
-                    depth++;
-                if (bodyLine.find('}') != std::string::npos)
+                if (stmt.index)
+                    assignElement(stmt, ctx, scope);
+                else
                 {
-                    depth--;
-                    if (depth == 0)
-                        break;
+                    TS::Value val = evalExpression(*stmt.expr, scope, ctx);
+                    profileValue(ctx, val);
+                    assign(stmt, scope, std::move(val));
                 }
-                if (depth > 0)
-                    bodyLines.push_back(trim(bodyLine));
             }
-
-            // Process each body line
-            for (auto &bl : bodyLines)
+            catch (const std::exception &e)
             {
-                if (bl.rfind("static ", 0) == 0)
-                {
-                    std::string rest = trim(bl.substr(7));
-
-                    // Method: static name(params) { ... }
-                    if (rest.find('(') != std::string::npos)
-                    {
-                        // Treat like a function definition with name "ClassName.method"
-                        std::string funcName = className + "." + trim(rest.substr(0, rest.find('(')));
-                        std::string header = line;
-
-                        // Extract function name and params
-                        auto nameStart = header.find(' ') + 1;
-                        auto parenOpen = header.find('(', nameStart);
-                        auto parenClose = header.find(')', parenOpen);
-
-                        std::string paramsStr = header.substr(parenOpen + 1, parenClose - parenOpen - 1);
-
-                        FunctionDef def;
-
-                        // Parse parameters with optional type annotations
-                        std::istringstream pss(paramsStr);
-                        std::string param;
-                        while (std::getline(pss, param, ','))
-                        {
-                            param = trim(param);
-                            if (param.empty())
-                                continue;
-
-                            std::string paramName = param;
-                            std::string paramType = "any"; // default
-
-                            auto colonPos = param.find(':');
-                            if (colonPos != std::string::npos)
-                            {
-                                paramName = trim(param.substr(0, colonPos));
-                                paramType = trim(param.substr(colonPos + 1));
-                            }
-
-                            def.params.push_back(paramName);
-                            def.paramTypes.push_back(paramType);
-                        }
-
-                        // --- Multi-line body capture ---
-                        std::string bodyLine;
-                        int braceDepth = 0;
-
-                        // If the opening brace is on the same line
-                        auto braceOpen = header.find('{', parenClose);
-                        if (braceOpen != std::string::npos)
-                        {
-                            braceDepth = 1;
-                            std::string afterBrace = trim(header.substr(braceOpen + 1));
-                            if (!afterBrace.empty())
-                                def.bodyLines.push_back(afterBrace);
-                        }
-
-                        // Read subsequent lines until matching closing brace
-                        while (braceDepth > 0 && std::getline(std::cin, bodyLine))
-                        {
-                            std::string trimmed = trim(bodyLine);
-                            if (trimmed.find('{') != std::string::npos)
-                                braceDepth++;
-                            if (trimmed.find('}') != std::string::npos)
-                            {
-                                braceDepth--;
-                                if (braceDepth <= 0)
-                                    break;
-                            }
-                            if (!trimmed.empty() && braceDepth > 0)
-                            {
-                                def.bodyLines.push_back(trimmed);
-                            }
-                        }
-
-                        ctx.userFunctions[funcName] = def;
-                    }
-                    // Property: static name = value;
-                    else if (rest.find('=') != std::string::npos)
-                    {
-                        auto eqPos = rest.find('=');
-                        std::string propName = className + "." + trim(rest.substr(0, eqPos));
-                        std::string expr = trim(rest.substr(eqPos + 1));
-                        if (!expr.empty() && expr.back() == ';')
-                            expr.pop_back();
-                        // Merge builtins + user functions into one callable map
-                        std::unordered_map<std::string, std::function<TS::Value(const std::vector<TS::Value> &)>> callables(ctx.builtins);
-
-                        // Wrap user functions so they look like builtins
-                        for (auto &uf : ctx.userFunctions)
-                        {
-                            callables[uf.first] = [&ctx, name = uf.first](const std::vector<TS::Value> &args) -> TS::Value
-                            {
-                                auto &def = ctx.userFunctions.at(name);
-
-                                // Simple arg count check
-                                if (args.size() != def.params.size())
-                                {
-                                    OS::printLine("Error: Function '" + name + "' expects " +
-                                                  std::to_string(def.params.size()) + " args, got " +
-                                                  std::to_string(args.size()));
-                                    return TS::Value();
-                                }
-                                // Local scope
-                                Interpreter::Context localCtx = ctx;
-                                for (size_t i = 0; i < def.params.size(); ++i)
-                                {
-                                    TS::setVar(localCtx.variables, def.params[i], args[i]);
-                                }
-
-                                // Execute body
-                                for (auto &bodyLine : def.bodyLines)
-                                {
-                                    std::string trimmed = trim(bodyLine);
-                                    if (trimmed.rfind("return", 0) == 0)
-                                    {
-                                        // Strip "return" and optional semicolon
-                                        std::string retExpr = trim(trimmed.substr(6));
-                                        if (!retExpr.empty() && retExpr.back() == ';')
-                                            retExpr.pop_back();
-
-                                        // Evaluate and return immediately
-                                        return evalSimpleExpression(retExpr, localCtx.variables, /* merged callables */ ctx.builtins);
-                                    }
-
-                                    Interpreter::executeLine(bodyLine, localCtx);
-                                }
-                                return TS::Value(); // no return yet
-                            };
-                        }
-                        TS::Value val = evalSimpleExpression(expr, ctx.variables, callables);
-                        TS::setVar(ctx.variables, propName, val);
-                    }
-                }
+                ctx.console->printLine(std::string("Error evaluating expression: ") + e.what());
             }
-            return;
-        }
+            return Completion::Normal;
 
-        // --- Handle function calls: name(arg1, arg2, ...) ---
-        auto parenOpen = line.find('(');
-        auto parenClose = line.rfind(')'); // use rfind to get the last closing parenthesis
+        case StatementKind::Function:
+            defineFunction(ctx, stmt.name, *stmt.function);
+            return Completion::Normal;
 
-        if (parenOpen != std::string::npos && parenClose != std::string::npos && parenClose > parenOpen)
+        case StatementKind::If:
         {
-            std::string funcName = trim(line.substr(0, parenOpen));
-            std::string argsStr = line.substr(parenOpen + 1, parenClose - parenOpen - 1);
-
-            std::vector<TS::Value> args;
-            std::string currentArg;
-            bool inString = false;
-            char stringChar = '\0';
-            int parenDepth = 0;
+            TS::Value condVal = evalExpression(*stmt.expr, scope, ctx);
+            return executeBlock(condVal.toBool() ? stmt.body : stmt.elseBody, ctx, scope, result);
+        }
 
-            // --- Robust argument splitting ---
-            for (size_t i = 0; i < argsStr.size(); ++i)
+        case StatementKind::While:
+        {
+            Completion completion = Completion::Normal;
+            while (evalExpression(*stmt.expr, scope, ctx).toBool())
             {
-                char c = argsStr[i];
-
-                if ((c == '"' || c == '\'') && !inString)
-                {
-                    inString = true;
-                    stringChar = c;
-                    currentArg.push_back(c);
-                }
-                else if (inString && c == stringChar)
-                {
-                    inString = false;
-                    currentArg.push_back(c);
-                }
-                else if (!inString && c == '(')
-                {
-                    parenDepth++;
-                    currentArg.push_back(c);
-                }
-                else if (!inString && c == ')')
-                {
-                    parenDepth--;
-                    currentArg.push_back(c);
-                }
-                else if (!inString && parenDepth == 0 && c == ',')
-                {
-                    // End of argument
-                    std::string argTrimmed = trim(currentArg);
-                    if (!argTrimmed.empty())
-                    {
-                        // Parse argument value
-                        if (argTrimmed == "true")
-                            args.push_back(TS::Value(true));
-                        else if (argTrimmed == "false")
-                            args.push_back(TS::Value(false));
-                        else if (argTrimmed == "null")
-                            args.push_back(TS::Value());
-                        else
-                        {
-                            try
-                            {
-                                NUMBER num = std::stod(argTrimmed);
-                                args.push_back(TS::Value(num));
-                            }
-                            catch (...)
-                            {
-                                if (argTrimmed.size() >= 2 &&
-                                    ((argTrimmed.front() == '"' && argTrimmed.back() == '"') ||
-                                     (argTrimmed.front() == '\'' && argTrimmed.back() == '\'')))
-                                {
-                                    args.push_back(TS::Value(argTrimmed.substr(1, argTrimmed.size() - 2)));
-                                }
-                                else
-                                {
-                                    auto val = TS::getVar(ctx.variables, argTrimmed);
-                                    if (val)
-                                        args.push_back(*val);
-                                    else
-                                        args.push_back(TS::Value());
-                                }
-                            }
-                        }
-                    }
-                    currentArg.clear();
-                }
-                else
-                {
-                    currentArg.push_back(c);
-                }
+                if (runLoopBody(stmt, ctx, scope, result, completion))
+                    break;
             }
+            return completion;
+        }
 
-            // Last argument (if any)
-            if (!currentArg.empty())
+        case StatementKind::For:
+        {
+            Completion completion = executeBlock(stmt.init, ctx, scope, result);
+            if (completion != Completion::Normal)
+                return completion;
+            while (!stmt.expr || evalExpression(*stmt.expr, scope, ctx).toBool())
             {
-                std::string argTrimmed = trim(currentArg);
-                if (!argTrimmed.empty())
-                {
-                    if (argTrimmed == "true")
-                        args.push_back(TS::Value(true));
-                    else if (argTrimmed == "false")
-                        args.push_back(TS::Value(false));
-                    else if (argTrimmed == "null")
-                        args.push_back(TS::Value());
-                    else
-                    {
-                        try
-                        {
-                            NUMBER num = std::stod(argTrimmed);
-                            args.push_back(TS::Value(num));
-                        }
-                        catch (...)
-                        {
-                            if (argTrimmed.size() >= 2 &&
-                                ((argTrimmed.front() == '"' && argTrimmed.back() == '"') ||
-                                 (argTrimmed.front() == '\'' && argTrimmed.back() == '\'')))
-                            {
-                                args.push_back(TS::Value(argTrimmed.substr(1, argTrimmed.size() - 2)));
-                            }
-                            else
-                            {
-                                auto val = TS::getVar(ctx.variables, argTrimmed);
-                                if (val)
-                                    args.push_back(*val);
-                                else
-                                    args.push_back(TS::Value());
-                            }
-                        }
-                    }
-                }
+                if (runLoopBody(stmt, ctx, scope, result, completion))
+                    break;
+                executeBlock(stmt.update, ctx, scope, result);
             }
+            return completion;
+        }
 
-            // --- Built-in function? ---
-            if (ctx.builtins.find(funcName) != ctx.builtins.end())
-            {
-                ctx.builtins[funcName](args);
-                return;
-            }
+        case StatementKind::Break:
+            return Completion::Break;
 
-            // --- User-defined function? ---
-            if (ctx.userFunctions.find(funcName) != ctx.userFunctions.end())
-            {
-                auto &def = ctx.userFunctions[funcName];
+        case StatementKind::Continue:
+            return Completion::Continue;
 
-                // Type checking
-                if (args.size() != def.params.size())
-                {
-                    OS::printLine("Error: Function '" + funcName + "' expects " +
-                                  std::to_string(def.params.size()) + " arguments, got " +
-                                  std::to_string(args.size()));
-                    return;
-                }
+        case StatementKind::Class:
+            // Members were compiled to "ClassName.member" functions and variables,
+            // fields to assignments at the start of "ClassName.constructor"
+            return executeBlock(stmt.body, ctx, scope, result);
 
-                for (size_t i = 0; i < def.params.size(); ++i)
-                {
-                    const std::string &expectedType = def.paramTypes[i];
-                    if (expectedType != "any")
-                    {
-                        bool typeOk = false;
-                        if (expectedType == "number" && args[i].type == TS::ValueType::Number)
-                            typeOk = true;
-                        if (expectedType == "string" && args[i].type == TS::ValueType::String)
-                            typeOk = true;
-                        if (expectedType == "boolean" && args[i].type == TS::ValueType::Boolean)
-                            typeOk = true;
-                        if (!typeOk)
-                        {
-                            OS::printLine("TypeError: Argument '" + def.params[i] + "' expected " +
-                                          expectedType + ", got " + args[i].toString());
-                            return;
-                        }
-                    }
-                }
+        case StatementKind::Call:
+            executeCall(stmt, ctx, scope);
+            return Completion::Normal;
 
-                // Local scope
-                Context localCtx = ctx;
-                for (size_t i = 0; i < def.params.size(); ++i)
-                {
-                    TS::setVar(localCtx.variables, def.params[i], args[i]);
-                }
+        case StatementKind::Return:
+            result = stmt.expr ? evalExpression(*stmt.expr, scope, ctx) : TS::Value();
+            profileValue(ctx, result);
+            return Completion::Return;
 
-                // Execute body
-                for (auto &bodyLine : def.bodyLines)
-                {
-                    executeLine(bodyLine, localCtx);
-                }
-                return;
-            }
+        case StatementKind::Error:
+            ctx.console->printLine(stmt.name);
+            return Completion::Normal;
+        }
+        return Completion::Normal;
+    }
 
-            OS::printLine("Error: Unknown function '" + funcName + "'");
-            return;
+#ifndef REMOVE_PROFILER
+    // Runs one statement and reports its line and duration to the profiler
+    static Completion executeProfiled(const Statement &stmt, Context &ctx, TS::Environment &scope, TS::Value &result)
+    {
+        uint64_t start = OS::getNanos();
+        Completion completion = executeStatement(stmt, ctx, scope, result);
+        ctx.profiler->statement(stmt.line, OS::getNanos() - start);
+        return completion;
+    }
+#endif
+
+    static Completion executeBlock(const Block &block, Context &ctx, TS::Environment &scope, TS::Value &result)
+    {
+        for (auto &stmt : block)
+        {
+            Completion completion;
+#ifndef REMOVE_PROFILER
+            if (ctx.profiler)
+                completion = executeProfiled(stmt, ctx, scope, result);
+            else
+#endif
+                completion = executeStatement(stmt, ctx, scope, result);
+            if (completion != Completion::Normal)
+                return completion;
         }
+        return Completion::Normal;
+    }
 
-        OS::printLine("Error: Unrecognized statement: " + line);
+    void executeBlock(const Block &block, Context &ctx)
+    {
+        // A top-level break/continue/return just ends the script
+        TS::Value result;
+        executeBlock(block, ctx, ctx.variables, result);
     }
 
-    void executeScript(const std::vector<std::string> &lines, Context &ctx)
+    void executeLine(const std::string &rawLine, Context &ctx)
     {
-        for (auto &line : lines)
+        std::vector<std::string> lines{rawLine};
+
+        // A block opened on this line continues with the next input lines (interactive use)
+        int depth = braceBalance(rawLine);
+        std::string more;
+        while (depth > 0 && ctx.console->readLine(more))
         {
-            executeLine(line, ctx);
+            depth += braceBalance(more);
+            lines.push_back(more);
         }
+
+        executeBlock(compileScript(lines), ctx);
+    }
+
+    void executeScript(const std::vector<std::string> &lines, Context &ctx)
+    {
+        // Parse once, then run the compiled statements
+        executeBlock(compileScript(lines), ctx);
+    }
+
+    void executeScript(const std::vector<std::string_view> &lines, Context &ctx)
+    {
+        SourceCursor cursor(lines);
+        executeBlock(compileScript(cursor), ctx);
+    }
+
+    void executeSource(std::string_view source, Context &ctx)
+    {
+        executeBlock(compileSource(source), ctx);
     }
 
-} // namespace Interpreter
\ No newline at end of file
+} // namespace Interpreter
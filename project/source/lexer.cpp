@@ -0,0 +1,116 @@
+// lexer.cpp
+#include "lexer.h"
+#include <cctype>
+
+namespace TS
+{
+    static inline bool isDigit(char c) { return std::isdigit(static_cast<unsigned char>(c)) != 0; }
+    static inline bool isIdentStart(char c) { return std::isalpha(static_cast<unsigned char>(c)) || c == '_' || c == '$'; }
+    static inline bool isIdentPart(char c) { return std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '$' || c == '.'; }
+
+    Token Lexer::next()
+    {
+        static constexpr std::string_view multiCharOps[] = {"===", "!==", "==", "!=", "<=", ">=", "&&", "||", "**"};
+
+        // Skip whitespace and line comments
+        while (pos < source.size())
+        {
+            char c = source[pos];
+            if (c == '\n')
+            {
+                ++line;
+                ++pos;
+            }
+            else if (std::isspace(static_cast<unsigned char>(c)))
+                ++pos;
+            else if (c == '/' && pos + 1 < source.size() && source[pos + 1] == '/')
+            {
+                while (pos < source.size() && source[pos] != '\n')
+                    ++pos;
+            }
+            else
+                break;
+        }
+
+        Token tok;
+        tok.line = line;
+        if (pos >= source.size())
+            return tok;
+
+        size_t start = pos;
+        char c = source[pos];
+
+        // Number
+        if (isDigit(c) || (c == '.' && pos + 1 < source.size() && isDigit(source[pos + 1])))
+        {
+            while (pos < source.size() && (isDigit(source[pos]) || source[pos] == '.'))
+                ++pos;
+            // Exponent: 1e5, 2.5E-3
+            if (pos < source.size() && (source[pos] == 'e' || source[pos] == 'E'))
+            {
+                size_t j = pos + 1;
+                if (j < source.size() && (source[j] == '+' || source[j] == '-'))
+                    ++j;
+                if (j < source.size() && isDigit(source[j]))
+                {
+                    pos = j;
+                    while (pos < source.size() && isDigit(source[pos]))
+                        ++pos;
+                }
+            }
+            tok.type = TokenType::Number;
+        }
+        // Identifier
+        else if (isIdentStart(c))
+        {
+            while (pos < source.size() && isIdentPart(source[pos]))
+                ++pos;
+            tok.type = TokenType::Identifier;
+        }
+        // String literal (an unterminated one ends with its line)
+        else if (c == '"' || c == '\'')
+        {
+            ++pos;
+            while (pos < source.size() && source[pos] != '\n')
+            {
+                if (source[pos] == '\\' && pos + 1 < source.size())
+                    ++pos;
+                else if (source[pos] == c)
+                {
+                    ++pos;
+                    break;
+                }
+                ++pos;
+            }
+            tok.type = TokenType::String;
+        }
+        else
+        {
+            // Multi char operators, longest first
+            size_t n = 1;
+            for (std::string_view op : multiCharOps)
+            {
+                if (source.compare(pos, op.size(), op) == 0)
+                {
+                    n = op.size();
+                    break;
+                }
+            }
+            pos += n;
+            tok.type = TokenType::Operator;
+        }
+
+        tok.text = source.substr(start, pos - start);
+        return tok;
+    }
+
+    std::vector<Token> lex(std::string_view source, uint32_t firstLine)
+    {
+        std::vector<Token> tokens;
+        Lexer lexer(source, firstLine);
+        for (Token tok = lexer.next(); tok.type != TokenType::End; tok = lexer.next())
+            tokens.push_back(tok);
+        return tokens;
+    }
+
+} // namespace TS
@@ -1,21 +1,91 @@
 #include "setup.h"
+#include "os.h"
 #include "iostream_virt.h"
+#include <cstdio>
 #include <cstdlib>
+#include <cstring>
+#include <vector>
 
 int main(int argc, char *argv[])
 {
-    Setup::initialize();
+    bool checkOnly = false;
+    bool typeCheck = true;
+    bool profile = false;
+    const char *script = nullptr;
+    const char *batch = nullptr;
+    const char *snapshot = nullptr;      // restored before the script runs
+    const char *writeSnapshot = nullptr; // saved after it ran
+    unsigned jobs = 0; // one per core
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--check-only") == 0)
+            checkOnly = true;
+        else if (std::strcmp(argv[i], "--no-check") == 0)
+            typeCheck = false;
+        else if (std::strcmp(argv[i], "--profile") == 0)
+            profile = true;
+        else if (std::strcmp(argv[i], "--batch") == 0 && i + 1 < argc)
+            batch = argv[++i];
+        else if (std::strcmp(argv[i], "--snapshot") == 0 && i + 1 < argc)
+            snapshot = argv[++i];
+        else if (std::strcmp(argv[i], "--write-snapshot") == 0 && i + 1 < argc)
+            writeSnapshot = argv[++i];
+        else if (std::strcmp(argv[i], "--jobs") == 0 && i + 1 < argc)
+            jobs = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        else if (!script)
+            script = argv[i];
+    }
 
-    if (argc < 2)
+    if (batch)
     {
-        std::printf("Usage: path/to/built/runtime <script.ts>");
+        // Every script in its own runtime, outputs printed in script order
+        std::vector<std::string> scripts;
+        if (!Setup::listBatch(batch, scripts))
+            return 1;
+        bool ok = Setup::runBatch(scripts, jobs, typeCheck, [](const Setup::BatchResult &result)
+                                  { OS::write(result.output); });
+        return ok ? 0 : 1;
+    }
+
+    if (!script)
+    {
+        std::printf("Usage: path/to/built/runtime [--check-only | --no-check] [--profile]\n"
+                    "           [--snapshot <file>] [--write-snapshot <file>] <script.ts>\n"
+                    "       path/to/built/runtime [--no-check] [--jobs N] --batch <directory | manifest>");
         return 1;
     }
 
-    if (!Setup::runFile(argv[1]))
+    if (checkOnly)
+    {
+        return Setup::checkFile(script) ? 0 : 1;
+    }
+
+    Setup::initialize();
+    Setup::setTypeCheck(typeCheck);
+    if (profile)
+        Setup::enableProfiling();
+    if (snapshot && !Setup::restoreSnapshot(snapshot))
     {
+        OS::printLine("Error: Could not restore the snapshot " + std::string(snapshot) +
+                      " (unreadable, from another build, or a module changed)");
         return 1;
     }
 
-    return 0;
-}
\ No newline at end of file
+    bool ok = Setup::runFile(script);
+
+    if (ok && writeSnapshot && !Setup::writeSnapshot(writeSnapshot))
+        OS::printLine("Error: Could not write the snapshot " + std::string(writeSnapshot));
+
+    if (profile)
+    {
+        // script.ts -> script.folded (flamegraph input) and script.profile (tables)
+        std::string base = script;
+        if (base.size() > 3 && base.compare(base.size() - 3, 3, ".ts") == 0)
+            base.resize(base.size() - 3);
+        if (!Setup::writeProfile(base + ".folded", base + ".profile"))
+            OS::printLine("Error: Could not write the profile of " + std::string(script));
+    }
+
+    return ok ? 0 : 1;
+}
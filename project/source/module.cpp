@@ -0,0 +1,848 @@
+// module.cpp
+#include "module.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+
+namespace Interpreter
+{
+    namespace
+    {
+        constexpr char kMagic[4] = {'A', 'T', 'S', 'C'};      // compiled statements
+        constexpr char kCheckMagic[4] = {'A', 'T', 'C', 'K'}; // type check results
+        constexpr char kSnapshotMagic[4] = {'A', 'T', 'S', 'S'}; // runtime snapshots
+        constexpr uint32_t kFormatVersion = 5;
+        constexpr uint32_t kByteOrder = 0x01020304;
+
+        // Build options that change the in-memory layout of values, or what
+        // constant folding bakes into the compiled statements
+        constexpr uint32_t buildFlags()
+        {
+            uint32_t flags = sizeof(NUMBER);
+#ifdef ADD_STD_HALF
+            flags |= 0x100;
+#endif
+#ifdef REMOVE_MATH_LIB
+            flags |= 0x200;
+#endif
+            return flags;
+        }
+
+        class Writer
+        {
+        public:
+            std::string data;
+
+            void u8(uint8_t v) { data.push_back(static_cast<char>(v)); }
+            void u32(uint32_t v) { raw(&v, sizeof(v)); }
+            void u64(uint64_t v) { raw(&v, sizeof(v)); }
+            void i32(int32_t v) { raw(&v, sizeof(v)); }
+
+            void str(const std::string &s)
+            {
+                u32(static_cast<uint32_t>(s.size()));
+                data.append(s);
+            }
+
+            void value(const TS::Value &v)
+            {
+                u8(static_cast<uint8_t>(v.type));
+                if (v.type == TS::ValueType::String)
+                    str(v.asString());
+                else
+                    u64(v.payload.bits);
+            }
+
+            // Expressions are written once and referenced by index,
+            // so statements sharing a cached expression stay shared on load
+            int32_t expression(const ExpressionPtr &expr)
+            {
+                if (!expr)
+                    return -1;
+                auto it = expressionIds.find(expr.get());
+                if (it != expressionIds.end())
+                    return it->second;
+                int32_t id = static_cast<int32_t>(expressionIds.size());
+                expressionIds.emplace(expr.get(), id);
+                expressions.push_back(expr.get());
+                return id;
+            }
+
+            void block(const Block &body)
+            {
+                u32(static_cast<uint32_t>(body.size()));
+                for (auto &stmt : body)
+                {
+                    u8(static_cast<uint8_t>(stmt.kind));
+                    u64(stmt.line);
+                    str(stmt.name);
+                    str(stmt.type);
+                    i32(stmt.slot);
+                    i32(expression(stmt.expr));
+                    i32(expression(stmt.index));
+                    u32(static_cast<uint32_t>(stmt.args.size()));
+                    for (auto &arg : stmt.args)
+                        i32(expression(arg));
+                    block(stmt.body);
+                    block(stmt.elseBody);
+                    block(stmt.init);
+                    block(stmt.update);
+                    u8(stmt.function ? 1 : 0);
+                    if (stmt.function)
+                        function(*stmt.function);
+                }
+            }
+
+            void function(const FunctionDef &def)
+            {
+                u32(static_cast<uint32_t>(def.params.size()));
+                for (size_t i = 0; i < def.params.size(); ++i)
+                {
+                    str(def.params[i]);
+                    str(def.paramTypes[i]);
+                }
+                u32(def.slotCount);
+                block(def.body);
+            }
+
+            // Values of variables may be arrays or objects: each is written where
+            // it is first reached and referenced by index after that, so
+            // ones shared between variables (or holding themselves) stay shared
+            void global(const TS::Value &v)
+            {
+                if (!v.isArray() && v.type != TS::ValueType::Object)
+                {
+                    value(v);
+                    return;
+                }
+                u8(static_cast<uint8_t>(v.type));
+                const void *shared = v.type == TS::ValueType::Object ? static_cast<const void *>(v.payload.object) : v.payload.array;
+                auto it = arrayIds.find(shared);
+                if (it != arrayIds.end())
+                {
+                    u32(it->second);
+                    return;
+                }
+                uint32_t id = static_cast<uint32_t>(arrayIds.size());
+                arrayIds.emplace(shared, id);
+                u32(id);
+                switch (v.type)
+                {
+                case TS::ValueType::Object:
+                {
+                    // Shapes are per process: the class and the keys in slot order
+                    const TS::ObjectData &object = v.asObject();
+                    str(object.shape->classAtom == TS::kNoClass ? std::string() : TS::atomName(object.shape->classAtom));
+                    u32(static_cast<uint32_t>(object.slots.size()));
+                    for (size_t i = 0; i < object.slots.size(); ++i)
+                    {
+                        str(TS::atomName(object.shape->keys[i]));
+                        global(object.slots[i]);
+                    }
+                    break;
+                }
+                case TS::ValueType::Array:
+                    u32(static_cast<uint32_t>(v.asArray().size()));
+                    for (const TS::Value &element : v.asArray())
+                        global(element);
+                    break;
+                case TS::ValueType::Float64Array:
+                    u32(static_cast<uint32_t>(v.asFloat64Array().size()));
+                    raw(v.asFloat64Array().data(), v.asFloat64Array().size() * sizeof(double));
+                    break;
+                case TS::ValueType::Float32Array:
+                    u32(static_cast<uint32_t>(v.asFloat32Array().size()));
+                    raw(v.asFloat32Array().data(), v.asFloat32Array().size() * sizeof(float));
+                    break;
+                default:
+                    u32(static_cast<uint32_t>(v.asFloat16Array().size()));
+                    raw(v.asFloat16Array().data(), v.asFloat16Array().size() * sizeof(_half));
+                    break;
+                }
+            }
+
+            void expressionTable(Writer &out) const
+            {
+                out.u32(static_cast<uint32_t>(expressions.size()));
+                for (const Expression *expr : expressions)
+                {
+                    out.str(expr->source);
+                    out.u32(static_cast<uint32_t>(expr->code.size()));
+                    for (auto &tok : expr->code)
+                    {
+                        out.u8(static_cast<uint8_t>(tok.kind));
+                        out.u8(static_cast<uint8_t>(tok.op));
+                        out.u32(tok.argc);
+                        out.i32(tok.slot);
+                        out.value(tok.value);
+                        out.str(tok.name);
+                    }
+                }
+            }
+
+        private:
+            std::unordered_map<const Expression *, int32_t> expressionIds;
+            std::vector<const Expression *> expressions;
+            std::unordered_map<const void *, uint32_t> arrayIds;
+
+            void raw(const void *p, size_t n) { data.append(static_cast<const char *>(p), n); }
+        };
+
+        // Bounds-checked reader; any malformed input sets `ok` to false
+        class Reader
+        {
+        public:
+            bool ok = true;
+
+            explicit Reader(std::string_view data) : data(data) {}
+
+            uint8_t u8()
+            {
+                uint8_t v = 0;
+                raw(&v, sizeof(v));
+                return v;
+            }
+            uint32_t u32()
+            {
+                uint32_t v = 0;
+                raw(&v, sizeof(v));
+                return v;
+            }
+            uint64_t u64()
+            {
+                uint64_t v = 0;
+                raw(&v, sizeof(v));
+                return v;
+            }
+            int32_t i32()
+            {
+                int32_t v = 0;
+                raw(&v, sizeof(v));
+                return v;
+            }
+
+            std::string str()
+            {
+                uint32_t n = u32();
+                if (!ok || n > data.size() - pos)
+                {
+                    ok = false;
+                    return {};
+                }
+                std::string s(data.substr(pos, n));
+                pos += n;
+                return s;
+            }
+
+            TS::Value value() { return scalar(static_cast<TS::ValueType>(u8())); }
+
+            // Reads what Writer::global wrote
+            TS::Value global()
+            {
+                auto type = static_cast<TS::ValueType>(u8());
+                if (type < TS::ValueType::Array && type != TS::ValueType::Object)
+                    return scalar(type);
+                uint32_t id = u32();
+                if (!ok || type > TS::ValueType::Float16Array || id > arrays.size())
+                {
+                    ok = false;
+                    return TS::Value();
+                }
+                if (id < arrays.size())
+                {
+                    if (arrays[id].type != type)
+                        ok = false;
+                    return arrays[id];
+                }
+
+                if (type == TS::ValueType::Object)
+                    return object();
+
+                uint32_t count = u32();
+                if (type == TS::ValueType::Array)
+                {
+                    // Registered before its elements, which may refer to it
+                    TS::Value array = TS::Value::makeArray();
+                    arrays.push_back(array);
+                    for (uint32_t i = 0; ok && i < count; ++i)
+                        array.asArray().push_back(global());
+                    return array;
+                }
+
+                size_t width = type == TS::ValueType::Float64Array   ? sizeof(double)
+                               : type == TS::ValueType::Float32Array ? sizeof(float)
+                                                                     : sizeof(_half);
+                if (!ok || count > (data.size() - pos) / width)
+                {
+                    ok = false;
+                    return TS::Value();
+                }
+                TS::Value array = TS::Value::makeTypedArray(type, count);
+                arrays.push_back(array);
+                if (type == TS::ValueType::Float64Array)
+                    raw(array.asFloat64Array().data(), count * width);
+                else if (type == TS::ValueType::Float32Array)
+                    raw(array.asFloat32Array().data(), count * width);
+                else
+                    raw(array.asFloat16Array().data(), count * width);
+                return array;
+            }
+
+            TS::Value object()
+            {
+                std::string className = str();
+                TS::Value object = TS::Value::makeObject(TS::Shape::root(className.empty() ? TS::kNoClass : TS::atom(className)));
+                arrays.push_back(object); // before its properties, which may refer to it
+                TS::ObjectData &data = object.asObject();
+                uint32_t count = u32();
+                for (uint32_t i = 0; ok && i < count; ++i)
+                {
+                    data.shape = data.shape->with(TS::atom(str()));
+                    TS::Value value = global();
+                    data.slots.push_back(std::move(value));
+                }
+                if (data.shape->keys.size() != data.slots.size())
+                    ok = false; // a key repeated
+                return object;
+            }
+
+            TS::Value scalar(TS::ValueType type)
+            {
+                if (type == TS::ValueType::String)
+                    return TS::Value(str());
+                if (type > TS::ValueType::Half)
+                {
+                    ok = false;
+                    return TS::Value();
+                }
+                TS::Value v;
+                v.payload.bits = u64();
+                v.type = type;
+                return v;
+            }
+
+            void expressionTable()
+            {
+                uint32_t count = u32();
+                for (uint32_t i = 0; ok && i < count; ++i)
+                {
+                    auto expr = std::make_shared<Expression>();
+                    expr->source = str();
+                    uint32_t tokens = u32();
+                    for (uint32_t t = 0; ok && t < tokens; ++t)
+                    {
+                        RpnToken tok;
+                        tok.kind = static_cast<TokenKind>(u8());
+                        tok.op = static_cast<OpCode>(u8());
+                        tok.argc = u32();
+                        tok.slot = i32();
+                        tok.value = value();
+                        tok.name = str();
+                        if (tok.kind > TokenKind::Method || tok.op > OpCode::Length ||
+                            (tok.kind == TokenKind::Object && tok.argc > std::count(tok.name.begin(), tok.name.end(), ',') + 1))
+                        {
+                            ok = false;
+                            break;
+                        }
+                        // Atoms and shapes are per process; link the names again
+                        linkToken(tok);
+                        expr->code.push_back(std::move(tok));
+                    }
+                    expressions.push_back(std::move(expr));
+                }
+            }
+
+            ExpressionPtr expression()
+            {
+                int32_t id = i32();
+                if (id < 0)
+                    return nullptr;
+                if (static_cast<size_t>(id) >= expressions.size())
+                {
+                    ok = false;
+                    return nullptr;
+                }
+                return expressions[id];
+            }
+
+            void block(Block &body)
+            {
+                uint32_t count = u32();
+                for (uint32_t i = 0; ok && i < count; ++i)
+                {
+                    Statement stmt;
+                    stmt.kind = static_cast<StatementKind>(u8());
+                    if (stmt.kind > StatementKind::Error)
+                        ok = false;
+                    stmt.line = u64();
+                    stmt.name = str();
+                    if (stmt.kind == StatementKind::Call || stmt.kind == StatementKind::Let || stmt.kind == StatementKind::Assign)
+                        stmt.atom = TS::atom(stmt.name);
+                    if (stmt.kind == StatementKind::Call || stmt.kind == StatementKind::Assign)
+                        stmt.path = propertyPath(stmt.name);
+                    stmt.type = str();
+                    stmt.slot = i32();
+                    stmt.expr = expression();
+                    stmt.index = expression();
+                    uint32_t args = u32();
+                    for (uint32_t a = 0; ok && a < args; ++a)
+                    {
+                        stmt.args.push_back(expression());
+                        // Derived from the expressions; computed again
+                        stmt.argTypes.push_back(stmt.args.back() ? staticType(*stmt.args.back()) : DeclaredType::Any);
+                    }
+                    block(stmt.body);
+                    block(stmt.elseBody);
+                    block(stmt.init);
+                    block(stmt.update);
+                    if (ok && u8())
+                    {
+                        stmt.function = std::make_shared<FunctionDef>();
+                        function(*stmt.function);
+                    }
+                    body.push_back(std::move(stmt));
+                }
+            }
+
+            void function(FunctionDef &def)
+            {
+                uint32_t params = u32();
+                for (uint32_t p = 0; ok && p < params; ++p)
+                {
+                    def.params.push_back(str());
+                    def.paramTypes.push_back(str());
+                    def.declaredTypes.push_back(declaredType(def.paramTypes.back()));
+                }
+                def.slotCount = u32();
+                block(def.body);
+            }
+
+            bool atEnd() const { return pos == data.size(); }
+
+        private:
+            std::string_view data;
+            size_t pos = 0;
+            std::vector<ExpressionPtr> expressions;
+            std::vector<TS::Value> arrays; // by Writer::global index
+
+            void raw(void *p, size_t n)
+            {
+                if (!ok || n > data.size() - pos)
+                {
+                    ok = false;
+                    return;
+                }
+                std::memcpy(p, data.data() + pos, n);
+                pos += n;
+            }
+        };
+
+        void writeHeader(Writer &out, const char (&magic)[4], const SourceStamp &stamp)
+        {
+            out.data.append(magic, sizeof(magic));
+            out.u32(kFormatVersion);
+            out.u32(kByteOrder);
+            out.u32(buildFlags());
+            out.u64(stamp.size);
+            out.u64(stamp.mtime);
+            out.u64(stamp.hash);
+        }
+
+        // Validates an artifact header against the current source.
+        // On success `in` is positioned right after the header.
+        bool readHeader(Reader &in, std::string_view data, const char (&magic)[4], const OS::SourceFile &source, SourceStamp &stamp)
+        {
+            if (data.size() < sizeof(magic) || data.compare(0, sizeof(magic), std::string_view(magic, sizeof(magic))) != 0)
+                return false;
+
+            in = Reader(data.substr(sizeof(magic)));
+            if (in.u32() != kFormatVersion || in.u32() != kByteOrder || in.u32() != buildFlags())
+                return false;
+
+            uint64_t size = in.u64();
+            uint64_t mtime = in.u64();
+            uint64_t hash = in.u64();
+            if (!in.ok || size != stamp.size)
+                return false;
+
+            // A touched but unchanged file is still current
+            if (mtime != stamp.mtime)
+            {
+                if (stamp.hash == 0)
+                    stamp.hash = hashSource(source.text());
+                if (hash != stamp.hash)
+                    return false;
+            }
+            return true;
+        }
+
+        std::string artifactPath(const std::string &sourcePath, const char *extension)
+        {
+            if (sourcePath.size() > 3 && sourcePath.compare(sourcePath.size() - 3, 3, ".ts") == 0)
+                return sourcePath.substr(0, sourcePath.size() - 3) + extension;
+            return sourcePath + extension;
+        }
+
+        SourceStamp stampOf(const std::string &path, const OS::SourceFile &source)
+        {
+            SourceStamp stamp;
+            stamp.size = source.text().size();
+            OS::fileModifiedTime(path, stamp.mtime);
+            return stamp;
+        }
+
+        // True if `path` still holds the source `stamp` (with its hash) was taken of
+        bool isCurrent(const std::string &path, const SourceStamp &stamp)
+        {
+            OS::SourceFile source;
+            if (!source.open(path))
+                return false;
+            SourceStamp current = stampOf(path, source);
+            if (current.size != stamp.size)
+                return false;
+            return (current.mtime != 0 && current.mtime == stamp.mtime) || hashSource(source.text()) == stamp.hash;
+        }
+
+        template <typename Map>
+        std::vector<const typename Map::value_type *> sortedByName(const Map &map)
+        {
+            std::vector<const typename Map::value_type *> entries;
+            entries.reserve(map.size());
+            for (auto &entry : map)
+                entries.push_back(&entry);
+            std::sort(entries.begin(), entries.end(), [](auto *a, auto *b) { return a->first < b->first; });
+            return entries;
+        }
+
+        // Serializes reading and refreshing artifacts between threads of this process
+        std::mutex &artifactLock()
+        {
+            static std::mutex lock;
+            return lock;
+        }
+
+        // Compiled modules shared by every runtime of the process
+        struct ModuleCache
+        {
+            struct Entry
+            {
+                SourceStamp stamp; // with the hash always filled in
+                ModulePtr block;
+            };
+            std::unordered_map<std::string, Entry> entries;
+            std::mutex lock;
+        };
+
+        ModuleCache &moduleCache()
+        {
+            static ModuleCache cache;
+            return cache;
+        }
+    } // namespace
+
+    uint64_t hashSource(std::string_view text)
+    {
+        uint64_t hash = 14695981039346656037ull;
+        for (char c : text)
+        {
+            hash ^= static_cast<unsigned char>(c);
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    std::string compiledPath(const std::string &sourcePath)
+    {
+        return artifactPath(sourcePath, ".tsc");
+    }
+
+    std::string checkedPath(const std::string &sourcePath)
+    {
+        return artifactPath(sourcePath, ".tscheck");
+    }
+
+    bool writeCompiled(const std::string &path, const SourceStamp &stamp, const Block &block)
+    {
+        Writer body;
+        body.block(block);
+
+        Writer out;
+        writeHeader(out, kMagic, stamp);
+        body.expressionTable(out);
+        out.data += body.data;
+        return OS::writeFile(path, out.data);
+    }
+
+    bool readCompiled(const std::string &path, const OS::SourceFile &source, SourceStamp &stamp, Block &out)
+    {
+        std::string artifact;
+        if (!OS::readFile(path, artifact))
+            return false;
+
+        Reader in(artifact);
+        if (!readHeader(in, artifact, kMagic, source, stamp))
+            return false;
+
+        in.expressionTable();
+        Block block;
+        in.block(block);
+        if (!in.ok || !in.atEnd())
+            return false;
+        out = std::move(block);
+        return true;
+    }
+
+    Block compileFile(const std::string &path, const OS::SourceFile &source)
+    {
+        std::lock_guard<std::mutex> guard(artifactLock());
+        std::string artifact = compiledPath(path);
+        SourceStamp stamp = stampOf(path, source);
+
+        Block block;
+        if (readCompiled(artifact, source, stamp, block))
+            return block;
+
+        SourceCursor cursor(source.lines());
+        block = compileScript(cursor);
+
+        // Best effort: a read-only directory just means compiling next time too
+        if (stamp.hash == 0)
+            stamp.hash = hashSource(source.text());
+        writeCompiled(artifact, stamp, block);
+        return block;
+    }
+
+    ModulePtr loadModule(const std::string &path, const OS::SourceFile &source)
+    {
+        SourceStamp stamp = stampOf(path, source);
+        ModuleCache &cache = moduleCache();
+        std::lock_guard<std::mutex> guard(cache.lock);
+
+        auto it = cache.entries.find(path);
+        if (it != cache.entries.end() && it->second.stamp.size == stamp.size)
+        {
+            const SourceStamp &cached = it->second.stamp;
+            if ((stamp.mtime != 0 && stamp.mtime == cached.mtime) || hashSource(source.text()) == cached.hash)
+                return it->second.block;
+        }
+
+        ModulePtr block = std::make_shared<const Block>(compileFile(path, source));
+        stamp.hash = hashSource(source.text());
+        cache.entries[path] = ModuleCache::Entry{stamp, block};
+        return block;
+    }
+
+#ifndef SKIP_TYPECHECK
+    TS::TypeCheckResult checkFile(const std::string &path, const OS::SourceFile &source)
+    {
+        std::lock_guard<std::mutex> guard(artifactLock());
+        std::string cachePath = checkedPath(path);
+        SourceStamp stamp = stampOf(path, source);
+        TS::TypeCheckResult result;
+
+        std::string cached;
+        if (OS::readFile(cachePath, cached))
+        {
+            Reader in(cached);
+            if (readHeader(in, cached, kCheckMagic, source, stamp))
+            {
+                uint32_t functions = in.u32();
+                for (uint32_t i = 0; in.ok && i < functions; ++i)
+                {
+                    std::string name = in.str();
+                    std::vector<std::string> types(in.u32());
+                    for (size_t t = 0; in.ok && t < types.size(); ++t)
+                        types[t] = in.str();
+                    result.signatures.emplace(std::move(name), std::move(types));
+                }
+                uint32_t errors = in.u32();
+                for (uint32_t i = 0; in.ok && i < errors; ++i)
+                {
+                    size_t line = in.u64();
+                    result.errors.push_back({line, in.str()});
+                }
+                if (in.ok && in.atEnd())
+                    return result;
+                result = TS::TypeCheckResult();
+            }
+        }
+
+        result = TS::checkTypes(source.text());
+
+        Writer out;
+        if (stamp.hash == 0)
+            stamp.hash = hashSource(source.text());
+        writeHeader(out, kCheckMagic, stamp);
+        out.u32(static_cast<uint32_t>(result.signatures.size()));
+        for (auto &entry : result.signatures)
+        {
+            out.str(entry.first);
+            out.u32(static_cast<uint32_t>(entry.second.size()));
+            for (auto &type : entry.second)
+                out.str(type);
+        }
+        out.u32(static_cast<uint32_t>(result.errors.size()));
+        for (auto &err : result.errors)
+        {
+            out.u64(err.line);
+            out.str(err.message);
+        }
+        OS::writeFile(cachePath, out.data);
+        return result;
+    }
+#endif
+
+    bool passesTypeCheck(const Context &ctx, const std::string &path, const OS::SourceFile &source)
+    {
+#ifndef SKIP_TYPECHECK
+        if (!ctx.typeCheck)
+            return true;
+
+        auto errors = checkFile(path, source).errors;
+        for (auto &err : errors)
+        {
+            ctx.console->printLine("Line " + std::to_string(err.line) + ": " + err.message);
+        }
+        return errors.empty();
+#else
+        return true;
+#endif
+    }
+
+    bool writeSnapshot(const std::string &path, const Context &ctx)
+    {
+        Writer out;
+        out.data.append(kSnapshotMagic, sizeof(kSnapshotMagic));
+        out.u32(kFormatVersion);
+        out.u32(kByteOrder);
+        out.u32(buildFlags());
+
+        std::vector<std::string> modules(ctx.modules.begin(), ctx.modules.end());
+        std::sort(modules.begin(), modules.end());
+        out.u32(static_cast<uint32_t>(modules.size()));
+        for (const std::string &module : modules)
+        {
+            OS::SourceFile source;
+            if (!source.open(module))
+                return false;
+            SourceStamp stamp = stampOf(module, source);
+            stamp.hash = hashSource(source.text());
+            out.str(module);
+            out.u64(stamp.size);
+            out.u64(stamp.mtime);
+            out.u64(stamp.hash);
+        }
+
+        Writer body;
+        body.u32(static_cast<uint32_t>(ctx.userFunctions.size()));
+        for (auto *function : sortedByName(ctx.userFunctions))
+        {
+            body.str(function->first);
+            body.function(function->second);
+        }
+        std::vector<std::pair<std::string, const TS::Value *>> variables;
+        for (auto &entry : ctx.variables.vars.all())
+            variables.emplace_back(TS::atomName(entry->atom), &entry->value);
+        body.u32(static_cast<uint32_t>(variables.size()));
+        for (auto *variable : sortedByName(variables))
+        {
+            body.str(variable->first);
+            body.global(*variable->second);
+        }
+
+        body.expressionTable(out);
+        out.data += body.data;
+        return OS::writeFile(path, out.data);
+    }
+
+    bool readSnapshot(const std::string &path, Context &ctx)
+    {
+        // Mapped files are read in place; anything else is read whole
+        OS::FileReader file;
+        std::string buffered;
+        std::string_view data;
+        if (!file.open(path))
+            return false;
+        if (!file.isMapped())
+        {
+            file.close();
+            if (!OS::readFile(path, buffered))
+                return false;
+            data = buffered;
+        }
+        else if (!file.read(SIZE_MAX, data))
+            return false;
+
+        if (data.size() < sizeof(kSnapshotMagic) ||
+            data.compare(0, sizeof(kSnapshotMagic), std::string_view(kSnapshotMagic, sizeof(kSnapshotMagic))) != 0)
+            return false;
+        Reader in(data.substr(sizeof(kSnapshotMagic)));
+        if (in.u32() != kFormatVersion || in.u32() != kByteOrder || in.u32() != buildFlags())
+            return false;
+
+        // Functions and variables a module defined are only valid with that module
+        std::vector<std::string> modules;
+        uint32_t count = in.u32();
+        for (uint32_t i = 0; in.ok && i < count; ++i)
+        {
+            modules.push_back(in.str());
+            SourceStamp stamp;
+            stamp.size = in.u64();
+            stamp.mtime = in.u64();
+            stamp.hash = in.u64();
+            if (!in.ok || !isCurrent(modules.back(), stamp))
+                return false;
+        }
+
+        in.expressionTable();
+        std::vector<std::pair<std::string, FunctionDef>> functions;
+        count = in.u32();
+        for (uint32_t i = 0; in.ok && i < count; ++i)
+        {
+            functions.emplace_back(in.str(), FunctionDef());
+            in.function(functions.back().second);
+        }
+        std::vector<std::pair<std::string, TS::Value>> variables;
+        count = in.u32();
+        for (uint32_t i = 0; in.ok && i < count; ++i)
+        {
+            std::string name = in.str();
+            variables.emplace_back(std::move(name), in.global());
+        }
+        if (!in.ok || !in.atEnd())
+            return false;
+
+        // Nothing is applied unless the whole snapshot is valid
+        for (auto &function : functions)
+            defineFunction(ctx, function.first, function.second);
+        for (auto &variable : variables)
+            TS::setVar(ctx.variables, variable.first, variable.second);
+        for (auto &module : modules)
+            ctx.modules.insert(std::move(module));
+        return true;
+    }
+
+    bool requireModule(Context &ctx, const std::string &path)
+    {
+        // Registered before executing so cyclic requires stop here
+        if (!ctx.modules.insert(path).second)
+            return true;
+
+        OS::SourceFile source;
+        if (!source.open(path))
+        {
+            ctx.modules.erase(path);
+            return false;
+        }
+        if (!passesTypeCheck(ctx, path, source))
+            return false;
+#ifndef REMOVE_PROFILER
+        Profiler::Frame frame(ctx.profiler, path);
+#endif
+        executeBlock(*loadModule(path, source), ctx);
+        return true;
+    }
+
+} // namespace Interpreter
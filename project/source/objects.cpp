@@ -0,0 +1,144 @@
+// objects.cpp
+#include "objects.h"
+#include <deque>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+
+namespace TS
+{
+    namespace
+    {
+        // Every shape of the process; shapes are never freed
+        struct ShapeTable
+        {
+            std::deque<Shape> shapes; // elements never move
+            std::unordered_map<uint64_t, const Shape *> transitions; // shape id << 32 | key
+            std::unordered_map<uint32_t, const Shape *> roots;       // by class atom
+            std::shared_mutex lock;
+
+            // Called with `lock` held exclusively
+            Shape &create(uint32_t classAtom)
+            {
+                Shape &shape = shapes.emplace_back();
+                shape.id = static_cast<uint32_t>(shapes.size());
+                shape.classAtom = classAtom;
+                return shape;
+            }
+        };
+
+        ShapeTable &shapeTable()
+        {
+            static ShapeTable table;
+            return table;
+        }
+
+        inline uint64_t transitionKey(const Shape &shape, uint32_t key)
+        {
+            return static_cast<uint64_t>(shape.id) << 32 | key;
+        }
+    }
+
+    int32_t Shape::slotOf(uint32_t key) const
+    {
+        // Objects have few properties, and cache hits skip this entirely
+        for (size_t i = 0; i < keys.size(); ++i)
+        {
+            if (keys[i] == key)
+                return static_cast<int32_t>(i);
+        }
+        return -1;
+    }
+
+    const Shape *Shape::with(uint32_t key) const
+    {
+        // Objects built by the same code take the same transitions in turn
+        const Shape *last = recent.load(std::memory_order_acquire);
+        if (last && last->keys.back() == key)
+            return last;
+        if (slotOf(key) >= 0)
+            return this;
+
+        ShapeTable &table = shapeTable();
+        const Shape *next = nullptr;
+        {
+            std::shared_lock<std::shared_mutex> reading(table.lock);
+            auto it = table.transitions.find(transitionKey(*this, key));
+            if (it != table.transitions.end())
+                next = it->second;
+        }
+        if (!next)
+        {
+            std::unique_lock<std::shared_mutex> writing(table.lock);
+            const Shape *&slot = table.transitions[transitionKey(*this, key)];
+            if (!slot) // not created by another thread meanwhile
+            {
+                Shape &created = table.create(classAtom);
+                created.keys = keys;
+                created.keys.push_back(key);
+                slot = &created;
+            }
+            next = slot;
+        }
+        recent.store(next, std::memory_order_release);
+        return next;
+    }
+
+    const Shape *Shape::root(uint32_t classAtom)
+    {
+        ShapeTable &table = shapeTable();
+        {
+            std::shared_lock<std::shared_mutex> reading(table.lock);
+            auto it = table.roots.find(classAtom);
+            if (it != table.roots.end())
+                return it->second;
+        }
+        std::unique_lock<std::shared_mutex> writing(table.lock);
+        const Shape *&slot = table.roots[classAtom];
+        if (!slot)
+            slot = &table.create(classAtom);
+        return slot;
+    }
+
+    bool setProperty(const Value &object, uint32_t key, const Value &value, const InlineCache &cache)
+    {
+        if (object.type != ValueType::Object)
+            return false;
+        ObjectData &data = object.asObject();
+        Value stored = value; // `value` may live in the slots the object grows
+
+        // The cache holds the slot of `key`, or the slot count when it adds `key`
+        uint32_t slot;
+        if (!cache.lookup(data.shape, slot))
+        {
+            int32_t found = data.shape->slotOf(key);
+            slot = found < 0 ? static_cast<uint32_t>(data.shape->keys.size()) : static_cast<uint32_t>(found);
+            cache.update(data.shape, slot);
+        }
+        if (slot < data.slots.size())
+        {
+            data.slots[slot] = std::move(stored);
+            return true;
+        }
+        data.shape = data.shape->with(key);
+        data.slots.push_back(std::move(stored));
+        return true;
+    }
+
+    bool findMethod(const Value &object, uint32_t key, const InlineCache &cache, uint32_t &outAtom)
+    {
+        if (object.type != ValueType::Object)
+            return false;
+        const Shape *shape = object.asObject().shape;
+        if (shape->classAtom == kNoClass)
+            return false;
+        if (!cache.lookup(shape, outAtom))
+        {
+            outAtom = atom(atomName(shape->classAtom) + "." + atomName(key));
+            cache.update(shape, outAtom);
+        }
+        return true;
+    }
+
+} // namespace TS
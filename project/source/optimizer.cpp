@@ -0,0 +1,414 @@
+// optimizer.cpp
+#include "optimizer.h"
+#include "interpreter.h"
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace Interpreter
+{
+    namespace
+    {
+        bool isUnary(OpCode op)
+        {
+            return op == OpCode::Neg || op == OpCode::Plus || op == OpCode::Not || op == OpCode::Length;
+        }
+
+        // Values a literal token can hold (and an artifact can store)
+        bool isScalar(const TS::Value &value)
+        {
+            switch (value.type)
+            {
+            case TS::ValueType::Null:
+            case TS::ValueType::Number:
+            case TS::ValueType::String:
+            case TS::ValueType::Boolean:
+                return true;
+            default:
+                return false;
+            }
+        }
+
+        RpnToken literal(const TS::Value &value)
+        {
+            RpnToken tok;
+            tok.kind = TokenKind::Literal;
+            tok.value = value;
+            return tok;
+        }
+
+        // The value of an expression that folded to a single literal, or nullptr
+        const TS::Value *constantOf(const ExpressionPtr &expr)
+        {
+            if (!expr || expr->code.size() != 1 || expr->code[0].kind != TokenKind::Literal)
+                return nullptr;
+            return &expr->code[0].value;
+        }
+
+        bool endsBlock(StatementKind kind)
+        {
+            return kind == StatementKind::Return || kind == StatementKind::Break || kind == StatementKind::Continue;
+        }
+
+        // What the whole unit does, gathered before anything is folded
+        struct UnitFacts
+        {
+            std::unordered_map<std::string, int> writes; // named `let`s and assignments per variable
+            std::unordered_set<std::string> functions;   // functions (and class members) it defines
+            std::unordered_set<std::string> callees;     // everything it calls
+        };
+
+        class Scanner
+        {
+        public:
+            explicit Scanner(UnitFacts &facts) : facts(facts) {}
+
+            void block(const Block &body)
+            {
+                for (const Statement &stmt : body)
+                    statement(stmt);
+            }
+
+        private:
+            UnitFacts &facts;
+
+            void expression(const ExpressionPtr &expr)
+            {
+                if (!expr)
+                    return;
+                for (const RpnToken &tok : expr->code)
+                {
+                    if (tok.kind == TokenKind::Call)
+                        facts.callees.insert(tok.name);
+                    else if (tok.kind == TokenKind::Method)
+                        facts.callees.insert("." + tok.name); // any method of any class: never known
+                    else if (tok.kind == TokenKind::New)
+                        facts.callees.insert(tok.name + ".constructor");
+                }
+            }
+
+            void statement(const Statement &stmt)
+            {
+                switch (stmt.kind)
+                {
+                case StatementKind::Let:
+                    if (stmt.slot < 0)
+                        ++facts.writes[stmt.name];
+                    break;
+                case StatementKind::Assign:
+                    // An element assignment leaves the variable itself alone
+                    if (stmt.slot < 0 && !stmt.index)
+                        ++facts.writes[stmt.name];
+                    break;
+                case StatementKind::Function:
+                    facts.functions.insert(stmt.name);
+                    if (stmt.function)
+                        block(stmt.function->body);
+                    break;
+                case StatementKind::Call:
+                    facts.callees.insert(stmt.name);
+                    break;
+                default:
+                    break;
+                }
+
+                expression(stmt.expr);
+                expression(stmt.index);
+                for (const ExpressionPtr &arg : stmt.args)
+                    expression(arg);
+                block(stmt.body);
+                block(stmt.elseBody);
+                block(stmt.init);
+                block(stmt.update);
+            }
+        };
+
+        class Optimizer
+        {
+        public:
+            explicit Optimizer(const UnitFacts &facts) : facts(facts)
+            {
+                // Between a top-level `let` and its readers only code of this
+                // unit and the standard library runs, or nothing is propagated
+                for (const std::string &callee : facts.callees)
+                {
+                    if (callee == "require" || (!facts.functions.count(callee) && !standardBuiltin(callee)))
+                    {
+                        propagate = false;
+                        break;
+                    }
+                }
+            }
+
+            // `top`: the block runs once, in order, as part of the unit itself
+            void block(Block &body, bool top)
+            {
+                Block optimized;
+                optimized.reserve(body.size());
+                for (Statement &stmt : body)
+                {
+                    if (!statement(stmt, top, optimized))
+                        break; // the rest is unreachable
+                }
+                body = std::move(optimized);
+            }
+
+        private:
+            const UnitFacts &facts;
+            bool propagate = true;
+            std::unordered_map<std::string, TS::Value> constants; // top-level lets in effect
+            int functionDepth = 0;
+
+            int writes(const std::string &name) const
+            {
+                auto it = facts.writes.find(name);
+                return it == facts.writes.end() ? 0 : it->second;
+            }
+
+            const TS::Value *constant(const std::string &name) const
+            {
+                if (functionDepth == 0)
+                {
+                    auto it = constants.find(name);
+                    if (it != constants.end())
+                        return &it->second;
+                }
+                return writes(name) ? nullptr : standardConstant(name);
+            }
+
+            bool foldsCall(const RpnToken &tok) const
+            {
+                return tok.argc > 0 && isPureBuiltin(tok.name) && !facts.functions.count(tok.name);
+            }
+
+            static TS::Value call(const Callable &callee, const TS::Value *args, size_t argc)
+            {
+                // As evaluate calls it
+                if (argc == 1 && callee.fn1)
+                    return callee.fn1(args[0]);
+                if (argc == 2 && callee.fn2)
+                    return callee.fn2(args[0], args[1]);
+                return callee.fn(Args(args, argc, nullptr));
+            }
+
+            // Folds the constant parts of an RPN expression. `known` tracks,
+            // per value on the evaluation stack, whether it is a literal
+            // (then it is the single token at its place in `code`).
+            ExpressionPtr expression(const ExpressionPtr &expr) const
+            {
+                if (!expr)
+                    return expr;
+
+                std::vector<RpnToken> code;
+                code.reserve(expr->code.size());
+                std::vector<bool> known;
+                bool changed = false;
+
+                // True if the top `n` values are all literals
+                auto literals = [&](size_t n)
+                {
+                    if (known.size() < n)
+                        return false;
+                    for (size_t i = known.size() - n; i < known.size(); ++i)
+                    {
+                        if (!known[i])
+                            return false;
+                    }
+                    return true;
+                };
+                auto replace = [&](size_t n, const TS::Value &result)
+                {
+                    code.resize(code.size() - n);
+                    known.resize(known.size() - n);
+                    code.push_back(literal(result));
+                    known.push_back(true);
+                    changed = true;
+                };
+                auto consume = [&](const RpnToken &tok, size_t n)
+                {
+                    known.resize(known.size() - std::min(n, known.size()));
+                    code.push_back(tok);
+                    known.push_back(false);
+                };
+
+                for (const RpnToken &tok : expr->code)
+                {
+                    switch (tok.kind)
+                    {
+                    case TokenKind::Literal:
+                        code.push_back(tok);
+                        known.push_back(true);
+                        break;
+
+                    case TokenKind::Variable:
+                    {
+                        const TS::Value *value = tok.slot < 0 ? constant(tok.name) : nullptr;
+                        if (value)
+                        {
+                            code.push_back(literal(*value));
+                            known.push_back(true);
+                            changed = true;
+                        }
+                        else
+                        {
+                            code.push_back(tok);
+                            known.push_back(false);
+                        }
+                        break;
+                    }
+
+                    case TokenKind::Operator:
+                    {
+                        size_t n = isUnary(tok.op) ? 1 : 2;
+                        if (literals(n))
+                        {
+                            const RpnToken *operands = code.data() + code.size() - n;
+                            TS::Value result = n == 1 ? applyUnaryOpVal(tok.op, operands[0].value)
+                                                      : applyOpVal(tok.op, operands[0].value, operands[1].value);
+                            if (isScalar(result))
+                            {
+                                replace(n, result);
+                                break;
+                            }
+                        }
+                        consume(tok, n);
+                        break;
+                    }
+
+                    case TokenKind::Call:
+                    {
+                        const Callable *callee = foldsCall(tok) ? standardBuiltin(tok.name) : nullptr;
+                        if (callee && literals(tok.argc))
+                        {
+                            std::vector<TS::Value> args;
+                            args.reserve(tok.argc);
+                            for (size_t i = code.size() - tok.argc; i < code.size(); ++i)
+                                args.push_back(code[i].value);
+                            TS::Value result = call(*callee, args.data(), args.size());
+                            if (isScalar(result))
+                            {
+                                replace(tok.argc, result);
+                                break;
+                            }
+                        }
+                        consume(tok, tok.argc);
+                        break;
+                    }
+
+                    case TokenKind::Array:
+                    case TokenKind::Object:
+                    case TokenKind::New:
+                        consume(tok, tok.argc);
+                        break;
+
+                    case TokenKind::Member:
+                        consume(tok, 1);
+                        break;
+
+                    case TokenKind::Method:
+                        consume(tok, tok.argc + 1);
+                        break;
+                    }
+                }
+
+                if (!changed)
+                    return expr; // keep sharing the cached expression
+                auto folded = std::make_shared<Expression>();
+                folded->code = std::move(code);
+                folded->source = expr->source;
+                return folded;
+            }
+
+            // Appends the optimized form of `stmt` (possibly several
+            // statements, or none) to `out`. Returns false if everything
+            // after it in the block is unreachable.
+            bool statement(Statement &stmt, bool top, Block &out)
+            {
+                stmt.expr = expression(stmt.expr);
+                stmt.index = expression(stmt.index);
+
+                switch (stmt.kind)
+                {
+                case StatementKind::Let:
+                {
+                    const TS::Value *value = constantOf(stmt.expr);
+                    if (top && propagate && value && stmt.slot < 0 && writes(stmt.name) == 1)
+                        constants[stmt.name] = *value;
+                    break;
+                }
+
+                case StatementKind::Function:
+                    if (stmt.function)
+                    {
+                        ++functionDepth;
+                        block(stmt.function->body, false);
+                        --functionDepth;
+                    }
+                    break;
+
+                case StatementKind::If:
+                    if (const TS::Value *cond = constantOf(stmt.expr))
+                    {
+                        // Only the branch taken is left, in place of the `if`
+                        Block &taken = cond->toBool() ? stmt.body : stmt.elseBody;
+                        block(taken, top);
+                        for (Statement &inner : taken)
+                            out.push_back(std::move(inner));
+                        return out.empty() || !endsBlock(out.back().kind);
+                    }
+                    block(stmt.body, false);
+                    block(stmt.elseBody, false);
+                    break;
+
+                case StatementKind::While:
+                    if (const TS::Value *cond = constantOf(stmt.expr); cond && !cond->toBool())
+                        return true; // never entered
+                    block(stmt.body, false);
+                    break;
+
+                case StatementKind::For:
+                    block(stmt.init, false);
+                    if (const TS::Value *cond = constantOf(stmt.expr); cond && !cond->toBool())
+                    {
+                        // Never entered: only the initializer runs
+                        for (Statement &inner : stmt.init)
+                            out.push_back(std::move(inner));
+                        return true;
+                    }
+                    block(stmt.body, false);
+                    block(stmt.update, false);
+                    break;
+
+                case StatementKind::Class:
+                    block(stmt.body, top);
+                    break;
+
+                case StatementKind::Call:
+                    stmt.argTypes.clear();
+                    for (ExpressionPtr &arg : stmt.args)
+                    {
+                        arg = expression(arg);
+                        stmt.argTypes.push_back(arg ? staticType(*arg) : DeclaredType::Any);
+                    }
+                    break;
+
+                default:
+                    break;
+                }
+
+                out.push_back(std::move(stmt));
+                return !endsBlock(out.back().kind);
+            }
+        };
+    }
+
+    void optimizeProgram(Block &program)
+    {
+        UnitFacts facts;
+        Scanner(facts).block(program);
+        Optimizer(facts).block(program, true);
+    }
+
+} // namespace Interpreter
@@ -1,6 +1,10 @@
 #include "../include/os.h"
 
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
 #include <iostream>
+#include <mutex>
 #include <thread>
 #include <chrono>
 #include <string>
@@ -30,26 +34,129 @@
 #if defined(_WIN32)
     #include <windows.h>
     #include <direct.h>
+    #include <fcntl.h>
+    #include <io.h>
 #else
     #include <dirent.h>
+    #include <fcntl.h>
+    #include <poll.h>
+    #include <sys/mman.h>
     #include <unistd.h>
 #endif
 
+// Readiness notification used by Poller (poll is the fallback)
+#if defined(__linux__)
+    #include <sys/epoll.h>
+    #define ANYTS_HAS_EPOLL 1
+#elif defined(__APPLE__) || defined(__FreeBSD__) || defined(__OpenBSD__) || defined(__NetBSD__)
+    #include <sys/event.h>
+    #define ANYTS_HAS_KQUEUE 1
+#endif
+
 namespace OS {
 
     // --- Basic I/O ---
+
+    // Collects output and hands it to stdout in large chunks
+    namespace {
+        struct OutputBuffer {
+            std::string data;
+            size_t capacity = OS_OUTPUT_BUFFER_SIZE;
+            std::mutex lock; // runtimes on several threads may share stdout
+
+            OutputBuffer() { data.reserve(capacity); }
+            ~OutputBuffer() { drain(); } // flush at exit
+
+            void drain() {
+                if (data.empty()) return;
+                std::fwrite(data.data(), 1, data.size(), stdout);
+                std::fflush(stdout);
+                data.clear();
+            }
+        };
+
+        OutputBuffer& outputBuffer() {
+            static OutputBuffer buffer;
+            return buffer;
+        }
+
+        // Writes text and a newline in one append under the lock, so lines
+        // printed from different threads never mix
+        void writeLine(const char* data, size_t size) {
+            OutputBuffer& out = outputBuffer();
+            std::lock_guard<std::mutex> guard(out.lock);
+            if (out.data.size() + size + 1 > out.capacity)
+                out.drain();
+            out.data.append(data, size);
+            out.data.push_back('\n');
+            if (out.data.size() >= out.capacity)
+                out.drain();
+        }
+
+        struct StandardConsole : Console {
+            void write(const char* data, size_t size) override { OS::write(data, size); }
+            void printLine(std::string_view msg) override { writeLine(msg.data(), msg.size()); }
+            bool readLine(std::string& out) override { return OS::readLine(out); }
+            void flush() override { OS::flush(); }
+        };
+    }
+
+    void write(const char* data, size_t size) {
+        OutputBuffer& out = outputBuffer();
+        std::lock_guard<std::mutex> guard(out.lock);
+        if (out.data.size() + size > out.capacity) {
+            out.drain();
+            // Too large to be worth buffering
+            if (size >= out.capacity) {
+                std::fwrite(data, 1, size, stdout);
+                std::fflush(stdout);
+                return;
+            }
+        }
+        out.data.append(data, size);
+    }
+
+    void flush() {
+        OutputBuffer& out = outputBuffer();
+        std::lock_guard<std::mutex> guard(out.lock);
+        out.drain();
+    }
+
+    void setOutputBufferSize(size_t bytes) {
+        OutputBuffer& out = outputBuffer();
+        std::lock_guard<std::mutex> guard(out.lock);
+        out.drain();
+        out.capacity = bytes;
+        out.data.reserve(bytes);
+    }
+
     void print(const std::string& msg) {
-        std::cout << msg;
+        write(msg.data(), msg.size());
     }
 
     void printLine(const std::string& msg) {
-        std::cout << msg << std::endl;
+        writeLine(msg.data(), msg.size());
     }
 
     bool readLine(std::string &out) {
+        flush();
         return static_cast<bool>(std::getline(std::cin, out));
     }
 
+    Console& standardConsole() {
+        static StandardConsole console;
+        return console;
+    }
+
+    bool StringConsole::readLine(std::string& out) {
+        if (inputPos >= input.size()) return false;
+        size_t end = input.find('\n', inputPos);
+        if (end == std::string::npos) end = input.size();
+        out.assign(input, inputPos, end - inputPos);
+        inputPos = end + 1;
+        return true;
+    }
+
     // --- File I/O ---
     bool fileExists(const std::string& path) {
     #if ANYTS_HAS_FS
@@ -95,6 +202,21 @@ namespace OS {
     #endif
     }
 
+    bool fileModifiedTime(const std::string& path, uint64_t& outTime) {
+    #if ANYTS_HAS_FS
+        std::error_code ec;
+        auto time = fs::last_write_time(path, ec);
+        if (ec) return false;
+        outTime = static_cast<uint64_t>(time.time_since_epoch().count());
+        return true;
+    #else
+        struct stat buffer;
+        if (stat(path.c_str(), &buffer) != 0) return false;
+        outTime = static_cast<uint64_t>(buffer.st_mtime);
+        return true;
+    #endif
+    }
+
     bool listFiles(const std::string& directory, std::vector<std::string>& outFiles) {
     #if ANYTS_HAS_FS
         try {
@@ -128,6 +250,366 @@ namespace OS {
     #endif
     }
 
+    // --- Mapped Files ---
+    namespace {
+        // Maps a whole regular, non-empty file read-only
+        // (the handles are only used on Windows)
+        bool mapFile(const std::string& path, const char*& data, size_t& size,
+                     void*& fileHandle, void*& mappingHandle) {
+        #if defined(_WIN32)
+            HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                                      OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+            if (file != INVALID_HANDLE_VALUE) {
+                LARGE_INTEGER fileSize;
+                if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0) {
+                    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+                    void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+                    if (view) {
+                        data = static_cast<const char*>(view);
+                        size = static_cast<size_t>(fileSize.QuadPart);
+                        fileHandle = file;
+                        mappingHandle = mapping;
+                        return true;
+                    }
+                    if (mapping) CloseHandle(mapping);
+                }
+                CloseHandle(file);
+            }
+        #else
+            (void)fileHandle;
+            (void)mappingHandle;
+            int fd = ::open(path.c_str(), O_RDONLY);
+            if (fd >= 0) {
+                struct stat info;
+                if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+                    void* view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+                    if (view != MAP_FAILED) {
+                        ::close(fd); // the mapping keeps the file alive
+                        data = static_cast<const char*>(view);
+                        size = static_cast<size_t>(info.st_size);
+                        return true;
+                    }
+                }
+                ::close(fd);
+            }
+        #endif
+            return false;
+        }
+
+        void unmapFile(const char* data, size_t size, void*& fileHandle, void*& mappingHandle) {
+        #if defined(_WIN32)
+            (void)size;
+            UnmapViewOfFile(data);
+            CloseHandle(mappingHandle);
+            CloseHandle(fileHandle);
+            mappingHandle = fileHandle = nullptr;
+        #else
+            (void)fileHandle;
+            (void)mappingHandle;
+            munmap(const_cast<char*>(data), size);
+        #endif
+        }
+    }
+
+    // --- Source Files ---
+    SourceFile::~SourceFile() {
+        close();
+    }
+
+    bool SourceFile::open(const std::string& path) {
+        close();
+        if (mapFile(path, data, size, fileHandle, mappingHandle)) {
+            mapped = true;
+            indexLines();
+            return true;
+        }
+        // Empty files and files that cannot be mapped are read normally
+        if (!readFile(path, buffer)) return false;
+        data = buffer.data();
+        size = buffer.size();
+        indexLines();
+        return true;
+    }
+
+    void SourceFile::close() {
+        if (mapped) unmapFile(data, size, fileHandle, mappingHandle);
+        data = nullptr;
+        size = 0;
+        mapped = false;
+        buffer.clear();
+        lineIndex.clear();
+    }
+
+    void SourceFile::indexLines() {
+        std::string_view rest = text();
+        while (!rest.empty()) {
+            size_t newline = rest.find('\n');
+            lineIndex.push_back(rest.substr(0, newline));
+            if (newline == std::string_view::npos) break;
+            rest.remove_prefix(newline + 1);
+        }
+    }
+
+    // --- Chunked Files ---
+    namespace {
+        constexpr size_t kFileBufferSize = 65536;
+    }
+
+    FileReader::~FileReader() {
+        close();
+    }
+
+    bool FileReader::open(const std::string& path) {
+        close();
+        if (mapFile(path, data, size, fileHandle, mappingHandle)) {
+            mapped = true;
+        #if !defined(_WIN32)
+            madvise(const_cast<char*>(data), size, MADV_SEQUENTIAL); // read ahead, drop behind
+        #endif
+            return true;
+        }
+        // Empty files, pipes and devices
+    #if defined(_WIN32)
+        file = path == "-" ? _fdopen(_dup(0), "rb") : std::fopen(path.c_str(), "rb");
+    #else
+        file = path == "-" ? fdopen(dup(STDIN_FILENO), "rb") : std::fopen(path.c_str(), "rb");
+    #endif
+        if (!file) return false;
+        std::setvbuf(file, nullptr, _IONBF, 0); // `buffer` is the only copy
+        buffer.resize(kFileBufferSize);
+        data = buffer.data();
+        return true;
+    }
+
+    void FileReader::close() {
+        if (mapped) unmapFile(data, size, fileHandle, mappingHandle);
+        if (file) std::fclose(file);
+        file = nullptr;
+        mapped = false;
+        data = nullptr;
+        size = pos = 0;
+        buffer = std::string();
+    }
+
+    // Buffered: moves the unread bytes to the front and reads more, growing
+    // the buffer to hold at least `want` bytes. Returns true if it read any.
+    bool FileReader::fill(size_t want) {
+        if (!file) return false;
+        size_t unread = size - pos;
+        if (pos > 0) {
+            std::memmove(&buffer[0], buffer.data() + pos, unread);
+            pos = 0;
+            size = unread;
+        }
+        if (buffer.size() < want) buffer.resize(std::max(want, buffer.size() * 2));
+        data = buffer.data();
+        // One read: pipes hand over what they have instead of filling the buffer
+    #if defined(_WIN32)
+        int n = _read(_fileno(file), &buffer[size], static_cast<unsigned>(buffer.size() - size));
+    #else
+        ssize_t n;
+        do {
+            n = ::read(fileno(file), &buffer[size], buffer.size() - size);
+        } while (n < 0 && errno == EINTR);
+    #endif
+        if (n <= 0) return false;
+        size += static_cast<size_t>(n);
+        return true;
+    }
+
+    bool FileReader::read(size_t want, std::string_view& out) {
+        if (pos == size && !fill(1)) return false;
+        size_t n = std::min(std::max<size_t>(want, 1), size - pos);
+        out = std::string_view(data + pos, n);
+        pos += n;
+        return true;
+    }
+
+    bool FileReader::readLine(std::string_view& out) {
+        size_t scanned = 0; // unread bytes known to hold no newline
+        for (;;) {
+            const char* start = data + pos;
+            size_t unread = size - pos;
+            const void* newline = unread > scanned ? std::memchr(start + scanned, '\n', unread - scanned) : nullptr;
+            if (newline) {
+                size_t length = static_cast<const char*>(newline) - start;
+                pos += length + 1;
+                if (length > 0 && start[length - 1] == '\r') --length;
+                out = std::string_view(start, length);
+                return true;
+            }
+            scanned = unread;
+            if (fill(unread + 1)) continue;
+
+            // The end of the file: what is left is the last line
+            start = data + pos;
+            unread = size - pos;
+            if (unread == 0) return false;
+            pos = size;
+            if (start[unread - 1] == '\r') --unread;
+            out = std::string_view(start, unread);
+            return true;
+        }
+    }
+
+    FileWriter::~FileWriter() {
+        close();
+    }
+
+    bool FileWriter::open(const std::string& path, bool append) {
+        close();
+        file = std::fopen(path.c_str(), append ? "ab" : "wb");
+        if (!file) return false;
+        std::setvbuf(file, nullptr, _IOFBF, kFileBufferSize);
+        failed = false;
+        return true;
+    }
+
+    bool FileWriter::write(std::string_view text) {
+        if (!file) return false;
+        if (std::fwrite(text.data(), 1, text.size(), file) != text.size()) failed = true;
+        return !failed;
+    }
+
+    bool FileWriter::flush() {
+        if (!file) return false;
+        if (std::fflush(file) != 0) failed = true;
+        return !failed;
+    }
+
+    bool FileWriter::close() {
+        if (!file) return false;
+        bool ok = flush();
+        ok = std::fclose(file) == 0 && ok;
+        file = nullptr;
+        return ok;
+    }
+
+    // --- Streams ---
+    int openStream(const std::string& path) {
+    #if defined(_WIN32)
+        return path == "-" ? _dup(0) : _open(path.c_str(), _O_RDONLY | _O_BINARY);
+    #else
+        // A copy of stdin keeps its flags untouched; readStream checks readiness itself.
+        // O_NONBLOCK also keeps opening a FIFO without a writer from waiting.
+        if (path == "-") return dup(STDIN_FILENO);
+        return ::open(path.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    #endif
+    }
+
+    long readStream(int stream, char* buffer, size_t size) {
+    #if defined(_WIN32)
+        int n = _read(stream, buffer, static_cast<unsigned>(size));
+        return n > 0 ? n : 0;
+    #else
+        pollfd ready = {stream, POLLIN, 0};
+        if (poll(&ready, 1, 0) == 0) return -1;
+        ssize_t n = ::read(stream, buffer, size);
+        if (n < 0) return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) ? -1 : 0;
+        return static_cast<long>(n);
+    #endif
+    }
+
+    void closeStream(int stream) {
+    #if defined(_WIN32)
+        _close(stream);
+    #else
+        ::close(stream);
+    #endif
+    }
+
+    Poller::Poller() {
+    #if defined(ANYTS_HAS_EPOLL)
+        queue = epoll_create1(EPOLL_CLOEXEC);
+    #elif defined(ANYTS_HAS_KQUEUE)
+        queue = kqueue();
+    #endif
+    }
+
+    Poller::~Poller() {
+    #if defined(ANYTS_HAS_EPOLL) || defined(ANYTS_HAS_KQUEUE)
+        if (queue >= 0) ::close(queue);
+    #endif
+    }
+
+    void Poller::add(int stream) {
+        streams.push_back(stream);
+    #if defined(_WIN32)
+        alwaysReady.push_back(stream);
+    #else
+        struct stat info;
+        bool waitable = fstat(stream, &info) == 0 && !S_ISREG(info.st_mode);
+    #if defined(ANYTS_HAS_EPOLL)
+        epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.fd = stream;
+        waitable = waitable && queue >= 0 && epoll_ctl(queue, EPOLL_CTL_ADD, stream, &event) == 0;
+    #elif defined(ANYTS_HAS_KQUEUE)
+        struct kevent change;
+        EV_SET(&change, stream, EVFILT_READ, EV_ADD, 0, 0, nullptr);
+        waitable = waitable && queue >= 0 && kevent(queue, &change, 1, nullptr, 0, nullptr) == 0;
+    #endif
+        if (!waitable) alwaysReady.push_back(stream);
+    #endif
+    }
+
+    void Poller::remove(int stream) {
+        auto erase = [stream](std::vector<int>& list) {
+            for (size_t i = 0; i < list.size(); ++i) {
+                if (list[i] == stream) {
+                    list.erase(list.begin() + i);
+                    return true;
+                }
+            }
+            return false;
+        };
+        erase(streams);
+        if (erase(alwaysReady)) return;
+    #if defined(ANYTS_HAS_EPOLL)
+        epoll_ctl(queue, EPOLL_CTL_DEL, stream, nullptr);
+    #elif defined(ANYTS_HAS_KQUEUE)
+        struct kevent change;
+        EV_SET(&change, stream, EVFILT_READ, EV_DELETE, 0, 0, nullptr);
+        kevent(queue, &change, 1, nullptr, 0, nullptr);
+    #endif
+    }
+
+    void Poller::wait(int64_t timeoutMs, std::vector<int>& outReady) {
+        flush();
+        outReady = alwaysReady;
+        if (!outReady.empty()) timeoutMs = 0; // still collect the others
+        if (streams.size() == alwaysReady.size()) {
+            // Nothing to wait on but time
+            if (timeoutMs > 0) std::this_thread::sleep_for(std::chrono::milliseconds(timeoutMs));
+            return;
+        }
+    #if !defined(_WIN32)
+        int timeout = timeoutMs < 0 ? -1 : static_cast<int>(std::min<int64_t>(timeoutMs, 0x7fffffff));
+    #if defined(ANYTS_HAS_EPOLL)
+        epoll_event events[64];
+        int n = epoll_wait(queue, events, 64, timeout);
+        for (int i = 0; i < n; ++i) outReady.push_back(events[i].data.fd);
+    #elif defined(ANYTS_HAS_KQUEUE)
+        struct kevent events[64];
+        timespec limit = {static_cast<time_t>(timeout / 1000), static_cast<long>(timeout % 1000) * 1000000};
+        int n = kevent(queue, nullptr, 0, events, 64, timeout < 0 ? nullptr : &limit);
+        for (int i = 0; i < n; ++i) outReady.push_back(static_cast<int>(events[i].ident));
+    #else
+        std::vector<pollfd> waiting;
+        for (int stream : streams) {
+            bool ready = false;
+            for (int other : alwaysReady) ready = ready || other == stream;
+            if (!ready) waiting.push_back({stream, POLLIN, 0});
+        }
+        if (poll(waiting.data(), waiting.size(), timeout) > 0) {
+            for (const pollfd& entry : waiting) {
+                if (entry.revents) outReady.push_back(entry.fd);
+            }
+        }
+    #endif
+    #endif
+    }
+
     // --- Timing ---
     uint64_t getMillis() {
         using namespace std::chrono;
@@ -136,7 +618,13 @@ namespace OS {
         return duration_cast<milliseconds>(now - start).count();
     }
 
+    uint64_t getNanos() {
+        using namespace std::chrono;
+        return static_cast<uint64_t>(duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count());
+    }
+
     void sleepMillis(uint64_t ms) {
+        flush();
         std::this_thread::sleep_for(std::chrono::milliseconds(ms));
     }
 
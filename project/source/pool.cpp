@@ -0,0 +1,99 @@
+#include "pool.h"
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Setup
+{
+
+    namespace
+    {
+        // One worker's tasks: the owner takes from the front, thieves from the back
+        struct TaskQueue
+        {
+            std::mutex lock;
+            std::deque<size_t> tasks;
+
+            bool popFront(size_t &out)
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                if (tasks.empty())
+                    return false;
+                out = tasks.front();
+                tasks.pop_front();
+                return true;
+            }
+
+            bool popBack(size_t &out)
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                if (tasks.empty())
+                    return false;
+                out = tasks.back();
+                tasks.pop_back();
+                return true;
+            }
+        };
+    }
+
+    WorkPool::WorkPool(unsigned threads)
+        : threadCount(threads ? threads : std::thread::hardware_concurrency())
+    {
+        if (threadCount == 0)
+            threadCount = 1;
+    }
+
+    void WorkPool::forEach(size_t count, const std::function<void(size_t)> &task)
+    {
+        if (count == 0)
+            return;
+        unsigned workers = threadCount < count ? threadCount : static_cast<unsigned>(count);
+
+        // Dealt out round-robin, so low indices are taken first everywhere
+        std::vector<TaskQueue> queues(workers);
+        for (size_t i = 0; i < count; ++i)
+            queues[i % workers].tasks.push_back(i);
+
+        std::mutex errorLock;
+        std::exception_ptr error;
+
+        auto work = [&](unsigned self)
+        {
+            size_t index;
+            for (;;)
+            {
+                bool found = queues[self].popFront(index);
+                // Own queue empty: steal; no task adds tasks, so empty everywhere means done
+                for (unsigned k = 1; !found && k < workers; ++k)
+                    found = queues[(self + k) % workers].popBack(index);
+                if (!found)
+                    return;
+
+                try
+                {
+                    task(index);
+                }
+                catch (...)
+                {
+                    std::lock_guard<std::mutex> guard(errorLock);
+                    if (!error)
+                        error = std::current_exception();
+                }
+            }
+        };
+
+        std::vector<std::thread> threads;
+        threads.reserve(workers - 1);
+        for (unsigned w = 1; w < workers; ++w)
+            threads.emplace_back(work, w);
+        work(0);
+        for (auto &thread : threads)
+            thread.join();
+
+        if (error)
+            std::rethrow_exception(error);
+    }
+
+} // namespace Setup
@@ -0,0 +1,138 @@
+// profiler.cpp
+#include "profiler.h"
+#include "os.h"
+#include <algorithm>
+#include <cstdio>
+
+namespace Interpreter
+{
+    Profiler::Profiler()
+    {
+        tree.emplace_back(); // root
+    }
+
+    void Profiler::enter(std::string_view name, bool builtin)
+    {
+        auto found = functionIds.find(std::string(name));
+        uint32_t function;
+        if (found != functionIds.end())
+            function = found->second;
+        else
+        {
+            function = static_cast<uint32_t>(functions.size());
+            functionIds.emplace(std::string(name), function);
+            functions.push_back(FunctionStats{std::string(name), builtin});
+        }
+
+        uint32_t parent = stack.empty() ? 0 : stack.back().node;
+        uint32_t node;
+        auto child = tree[parent].children.find(function);
+        if (child != tree[parent].children.end())
+            node = child->second;
+        else
+        {
+            node = static_cast<uint32_t>(tree.size());
+            tree[parent].children.emplace(function, node);
+            tree.emplace_back();
+            tree.back().parent = parent;
+            tree.back().function = function;
+        }
+
+        FunctionStats &stats = functions[function];
+        stats.calls++;
+        stats.active++;
+        stack.push_back(ActiveFrame{function, node, OS::getNanos()});
+    }
+
+    void Profiler::leave()
+    {
+        if (stack.empty())
+            return;
+        ActiveFrame frame = stack.back();
+        stack.pop_back();
+
+        uint64_t total = OS::getNanos() - frame.start;
+        uint64_t self = total > frame.childNs ? total - frame.childNs : 0;
+        FunctionStats &stats = functions[frame.function];
+        stats.exclusiveNs += self;
+        if (--stats.active == 0)
+            stats.inclusiveNs += total;
+        tree[frame.node].selfNs += self;
+        if (!stack.empty())
+            stack.back().childNs += total;
+    }
+
+    void Profiler::statement(size_t line, uint64_t nanos)
+    {
+        if (stack.empty())
+            return;
+        uint64_t key = (static_cast<uint64_t>(stack.back().function) << 32) | static_cast<uint32_t>(line);
+        LineStats &stats = lines[key];
+        stats.count++;
+        stats.inclusiveNs += nanos;
+    }
+
+    std::string Profiler::folded() const
+    {
+        std::string out;
+        std::vector<uint32_t> path;
+        for (uint32_t node = 1; node < tree.size(); ++node)
+        {
+            if (tree[node].selfNs == 0)
+                continue;
+            path.clear();
+            for (uint32_t n = node; n != 0; n = tree[n].parent)
+                path.push_back(tree[n].function);
+            for (size_t i = path.size(); i-- > 0;)
+            {
+                out += functions[path[i]].name;
+                out += i ? ';' : ' ';
+            }
+            out += std::to_string(tree[node].selfNs);
+            out += '\n';
+        }
+        return out;
+    }
+
+    std::string Profiler::report() const
+    {
+        auto ms = [](uint64_t ns) { return static_cast<double>(ns) / 1e6; };
+        char row[256];
+        std::string out;
+
+        std::vector<uint32_t> order(functions.size());
+        for (uint32_t i = 0; i < order.size(); ++i)
+            order[i] = i;
+        std::sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b)
+                  { return functions[a].exclusiveNs > functions[b].exclusiveNs; });
+
+        std::snprintf(row, sizeof(row), "%-32s %12s %14s %14s %12s\n",
+                      "function", "calls", "inclusive ms", "exclusive ms", "bytes");
+        out += row;
+        for (uint32_t i : order)
+        {
+            const FunctionStats &f = functions[i];
+            std::string name = f.builtin ? f.name + " (builtin)" : f.name;
+            std::snprintf(row, sizeof(row), "%-32s %12llu %14.3f %14.3f %12llu\n", name.c_str(),
+                          static_cast<unsigned long long>(f.calls), ms(f.inclusiveNs), ms(f.exclusiveNs),
+                          static_cast<unsigned long long>(f.bytes));
+            out += row;
+        }
+
+        std::vector<std::pair<uint64_t, LineStats>> byLine(lines.begin(), lines.end());
+        std::sort(byLine.begin(), byLine.end(), [](const auto &a, const auto &b)
+                  { return a.second.inclusiveNs > b.second.inclusiveNs; });
+
+        std::snprintf(row, sizeof(row), "\n%-32s %12s %14s\n", "line", "executions", "inclusive ms");
+        out += row;
+        for (auto &entry : byLine)
+        {
+            std::string where = functions[entry.first >> 32].name + ":" + std::to_string(entry.first & 0xFFFFFFFFu);
+            std::snprintf(row, sizeof(row), "%-32s %12llu %14.3f\n", where.c_str(),
+                          static_cast<unsigned long long>(entry.second.count), ms(entry.second.inclusiveNs));
+            out += row;
+        }
+        return out;
+    }
+
+} // namespace Interpreter
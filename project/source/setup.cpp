@@ -1,84 +1,284 @@
 #include "setup.h"
 #include "interpreter.h"
+#include "module.h"
 #include "os.h"
+#include "pool.h"
+#include "profiler.h"
 #include "ts.h"
-#include "iostream_virt.h"
-#include <fstream>
-#include <sstream>
+#include <algorithm>
+#include <mutex>
 
-namespace
+namespace Setup
 {
-    Interpreter::Context ctx;
-}
 
-namespace std
-{
-    std::string joinStrings(const std::vector<std::string> &parts, const std::string &sep = "")
+    Runtime::Runtime(OS::Console *console)
+        : ctx(std::make_unique<Interpreter::Context>())
     {
-        std::string result;
-        for (size_t i = 0; i < parts.size(); ++i)
+        if (console)
+            ctx->console = console;
+        Interpreter::init(*ctx);
+    }
+
+    Runtime::~Runtime() = default;
+
+    Program Runtime::load(const std::string &filename)
+    {
+        OS::SourceFile source;
+        if (!source.open(filename))
         {
-            result += parts[i];
-            if (i + 1 < parts.size())
-                result += sep;
+            ctx->console->printLine("Error: Could not open file: " + filename);
+            return nullptr;
         }
-        return result;
-    }
-}
 
-namespace Setup
-{
+        if (!Interpreter::passesTypeCheck(*ctx, filename, source))
+        {
+            return nullptr;
+        }
 
-    void initialize()
+        // The checker and the compiler both read the mapped file in place;
+        // a program already compiled in this process (or an up-to-date
+        // precompiled artifact) skips compiling entirely
+        return Interpreter::loadModule(filename, source);
+    }
+
+    void Runtime::run(const Program &program)
     {
-        Interpreter::init(ctx);
+        if (program)
+        {
+            Interpreter::executeBlock(*program, *ctx);
+            ctx->events.run(*ctx);
+        }
     }
 
-    bool runFile(const std::string &filename)
+    bool Runtime::runFile(const std::string &filename)
     {
-        std::ifstream file(filename);
-        if (!file)
+        Program program = load(filename);
+        if (!program)
         {
-            OS::printLine("Error: Could not open file: " + filename);
             return false;
         }
+#ifndef REMOVE_PROFILER
+        Interpreter::Profiler::Frame frame(ctx->profiler, filename);
+#endif
+        run(program);
+        return true;
+    }
+
+    bool Runtime::runString(const std::string &code)
+    {
+        Interpreter::executeSource(code, *ctx);
+        ctx->events.run(*ctx);
+        return true;
+    }
+
+    void Runtime::setTypeCheck(bool enabled)
+    {
+        ctx->typeCheck = enabled;
+    }
 
-        std::vector<std::string> lines;
-        std::string line;
-        while (std::getline(file, line))
+    void Runtime::seedRandom(uint64_t seed)
+    {
+        Interpreter::seedRandom(*ctx, seed);
+    }
+
+    void Runtime::setConsole(OS::Console &console)
+    {
+        ctx->console = &console;
+    }
+
+    Interpreter::Profiler &Runtime::startProfiling()
+    {
+        if (!profile)
+            profile = std::make_unique<Interpreter::Profiler>();
+        ctx->profiler = profile.get();
+        return *profile;
+    }
+
+    bool Runtime::writeProfile(const std::string &foldedPath, const std::string &reportPath) const
+    {
+        if (!profile)
+            return false;
+        bool folded = OS::writeFile(foldedPath, profile->folded());
+        bool report = OS::writeFile(reportPath, profile->report());
+        return folded && report;
+    }
+
+    bool Runtime::writeSnapshot(const std::string &path) const
+    {
+        return Interpreter::writeSnapshot(path, *ctx);
+    }
+
+    bool Runtime::restoreSnapshot(const std::string &path)
+    {
+        return Interpreter::readSnapshot(path, *ctx);
+    }
+
+    namespace
+    {
+        bool endsWith(const std::string &text, const char *suffix)
         {
-            lines.push_back(line);
+            size_t n = std::char_traits<char>::length(suffix);
+            return text.size() >= n && text.compare(text.size() - n, n, suffix) == 0;
         }
 
-#ifndef SKIPTYPE_CHECK
-        // Run the pre-execution type check
-        auto errors = TS::checkTypesInSource(std::joinStrings(lines));
+        // Directory part of a path, with its trailing separator ("" if none)
+        std::string directoryOf(const std::string &path)
+        {
+            size_t slash = path.find_last_of("/\\");
+            return slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+        }
+
+        bool isAbsolute(const std::string &path)
+        {
+            return !path.empty() && (path[0] == '/' || path[0] == '\\' || (path.size() > 1 && path[1] == ':'));
+        }
+    }
 
-        if (!errors.empty())
+    bool listBatch(const std::string &path, std::vector<std::string> &outScripts)
+    {
+        std::vector<std::string> entries;
+        if (OS::listFiles(path, entries))
         {
-            for (auto &err : errors)
+            // Some platforms list bare names
+            std::string prefix = path;
+            if (!prefix.empty() && prefix.back() != '/' && prefix.back() != '\\')
+                prefix += '/';
+            size_t first = outScripts.size();
+            for (auto &entry : entries)
             {
-                std::cout << "Line " << err.line << ": " << err.message << "\n";
+                if (!endsWith(entry, ".ts"))
+                    continue;
+                outScripts.push_back(entry.find_first_of("/\\") == std::string::npos ? prefix + entry : entry);
             }
+            std::sort(outScripts.begin() + first, outScripts.end());
+            return true;
+        }
+
+        std::string manifest;
+        if (!OS::readFile(path, manifest))
+        {
+            OS::printLine("Error: Could not open batch: " + path);
             return false;
         }
-#endif
-        Interpreter::executeScript(lines, ctx);
+        std::string base = directoryOf(path);
+        for (std::string_view line : Interpreter::splitLines(manifest))
+        {
+            size_t start = line.find_first_not_of(" \t\r");
+            if (start == std::string_view::npos || line[start] == '#')
+                continue;
+            size_t end = line.find_last_not_of(" \t\r");
+            std::string script(line.substr(start, end - start + 1));
+            outScripts.push_back(isAbsolute(script) ? script : base + script);
+        }
         return true;
     }
 
-    bool runString(const std::string &code)
+    bool runBatch(const std::vector<std::string> &scripts, unsigned jobs, bool typeCheck,
+                  const std::function<void(const BatchResult &)> &emit)
+    {
+        std::vector<BatchResult> results(scripts.size());
+        std::vector<char> done(scripts.size(), 0);
+        size_t nextToEmit = 0;
+        std::mutex emitLock;
+
+        auto runScript = [&](size_t i)
+        {
+            BatchResult &result = results[i];
+            result.script = scripts[i];
+            {
+                OS::StringConsole console;
+                Runtime runtime(&console);
+                runtime.setTypeCheck(typeCheck);
+                result.ok = runtime.runFile(scripts[i]);
+                result.output = console.takeOutput();
+            }
+
+            // Hand over every finished result that is next in line
+            std::lock_guard<std::mutex> guard(emitLock);
+            done[i] = 1;
+            while (nextToEmit < results.size() && done[nextToEmit])
+            {
+                emit(results[nextToEmit]);
+                results[nextToEmit].output = std::string(); // emitted: free it early
+                ++nextToEmit;
+            }
+        };
+
+        WorkPool pool(jobs);
+        pool.forEach(scripts.size(), runScript);
+
+        return std::all_of(results.begin(), results.end(), [](const BatchResult &r) { return r.ok; });
+    }
+
+    namespace
     {
-        std::istringstream iss(code);
-        std::vector<std::string> lines;
-        std::string line;
-        while (std::getline(iss, line))
+        // Created by initialize, for the process-wide functions
+        std::unique_ptr<Runtime> defaultRuntime;
+
+        Runtime &runtime()
         {
-            lines.push_back(line);
+            if (!defaultRuntime)
+                defaultRuntime = std::make_unique<Runtime>();
+            return *defaultRuntime;
         }
+    }
 
-        Interpreter::executeScript(lines, ctx);
+    void initialize()
+    {
+        runtime();
+    }
+
+    bool runFile(const std::string &filename)
+    {
+        return runtime().runFile(filename);
+    }
+
+    void setTypeCheck(bool enabled)
+    {
+        runtime().setTypeCheck(enabled);
+    }
+
+    bool checkFile(const std::string &filename)
+    {
+        OS::SourceFile source;
+        if (!source.open(filename))
+        {
+            OS::printLine("Error: Could not open file: " + filename);
+            return false;
+        }
+
+#ifndef SKIP_TYPECHECK
+        Interpreter::Context checkCtx;
+        return Interpreter::passesTypeCheck(checkCtx, filename, source);
+#else
+        OS::printLine("Type checking is disabled in this build (SKIP_TYPECHECK)");
         return true;
+#endif
+    }
+
+    bool runString(const std::string &code)
+    {
+        return runtime().runString(code);
+    }
+
+    void enableProfiling()
+    {
+        runtime().startProfiling();
+    }
+
+    bool writeProfile(const std::string &foldedPath, const std::string &reportPath)
+    {
+        return runtime().writeProfile(foldedPath, reportPath);
+    }
+
+    bool writeSnapshot(const std::string &path)
+    {
+        return runtime().writeSnapshot(path);
+    }
+
+    bool restoreSnapshot(const std::string &path)
+    {
+        return runtime().restoreSnapshot(path);
     }
 
-} // namespace Setup
\ No newline at end of file
+} // namespace Setup
@@ -0,0 +1,454 @@
+// simd.cpp
+#include "simd.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define TS_SIMD_AVX
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#ifdef __SSE4_1__
+#include <smmintrin.h>
+#endif
+#define TS_SIMD_SSE2
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define TS_SIMD_NEON
+#endif
+
+namespace TS
+{
+    namespace Simd
+    {
+        namespace
+        {
+            // --- Vector traits ---
+            // Vec<T> wraps one register of T lanes: V is the register, M a lane mask.
+            // The kernels below are written once against this interface.
+            template <typename T>
+            struct Vec;
+
+#if defined(TS_SIMD_AVX)
+            template <>
+            struct Vec<double>
+            {
+                using V = __m256d;
+                using M = __m256d;
+                static constexpr size_t width = 4;
+
+                static V load(const double *p) { return _mm256_loadu_pd(p); }
+                static V load(const float *p) { return _mm256_cvtps_pd(_mm_loadu_ps(p)); } // widening
+                static void store(double *p, V v) { _mm256_storeu_pd(p, v); }
+                static V set1(double x) { return _mm256_set1_pd(x); }
+                static V add(V a, V b) { return _mm256_add_pd(a, b); }
+                static V sub(V a, V b) { return _mm256_sub_pd(a, b); }
+                static V mul(V a, V b) { return _mm256_mul_pd(a, b); }
+                static V div(V a, V b) { return _mm256_div_pd(a, b); }
+#ifdef __FMA__
+                static V mulAdd(V a, V b, V c) { return _mm256_fmadd_pd(a, b, c); }
+#else
+                static V mulAdd(V a, V b, V c) { return _mm256_add_pd(_mm256_mul_pd(a, b), c); }
+#endif
+                static V min(V a, V b) { return _mm256_min_pd(a, b); }
+                static V max(V a, V b) { return _mm256_max_pd(a, b); }
+                static V sqrt(V a) { return _mm256_sqrt_pd(a); }
+                static V abs(V a) { return _mm256_andnot_pd(_mm256_set1_pd(-0.0), a); }
+                static V floor(V a) { return _mm256_floor_pd(a); }
+                static M isNaN(V a) { return _mm256_cmp_pd(a, a, _CMP_UNORD_Q); }
+                static M orMask(M a, M b) { return _mm256_or_pd(a, b); }
+                static bool any(M m) { return _mm256_movemask_pd(m) != 0; }
+            };
+
+            template <>
+            struct Vec<float>
+            {
+                using V = __m256;
+                static constexpr size_t width = 8;
+
+                static V load(const float *p) { return _mm256_loadu_ps(p); }
+                static void store(float *p, V v) { _mm256_storeu_ps(p, v); }
+                static V set1(float x) { return _mm256_set1_ps(x); }
+                static V add(V a, V b) { return _mm256_add_ps(a, b); }
+                static V sub(V a, V b) { return _mm256_sub_ps(a, b); }
+                static V mul(V a, V b) { return _mm256_mul_ps(a, b); }
+                static V div(V a, V b) { return _mm256_div_ps(a, b); }
+                static V sqrt(V a) { return _mm256_sqrt_ps(a); }
+                static V abs(V a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+                static V floor(V a) { return _mm256_floor_ps(a); }
+            };
+
+            constexpr const char *kIsa = "avx";
+
+#elif defined(TS_SIMD_SSE2)
+            template <>
+            struct Vec<double>
+            {
+                using V = __m128d;
+                using M = __m128d;
+                static constexpr size_t width = 2;
+
+                static V load(const double *p) { return _mm_loadu_pd(p); }
+                static V load(const float *p) // widening
+                {
+                    return _mm_cvtps_pd(_mm_castsi128_ps(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(p))));
+                }
+                static void store(double *p, V v) { _mm_storeu_pd(p, v); }
+                static V set1(double x) { return _mm_set1_pd(x); }
+                static V add(V a, V b) { return _mm_add_pd(a, b); }
+                static V sub(V a, V b) { return _mm_sub_pd(a, b); }
+                static V mul(V a, V b) { return _mm_mul_pd(a, b); }
+                static V div(V a, V b) { return _mm_div_pd(a, b); }
+                static V mulAdd(V a, V b, V c) { return _mm_add_pd(_mm_mul_pd(a, b), c); }
+                static V min(V a, V b) { return _mm_min_pd(a, b); }
+                static V max(V a, V b) { return _mm_max_pd(a, b); }
+                static V sqrt(V a) { return _mm_sqrt_pd(a); }
+                static V abs(V a) { return _mm_andnot_pd(_mm_set1_pd(-0.0), a); }
+#ifdef __SSE4_1__
+                static V floor(V a) { return _mm_floor_pd(a); }
+#else
+                static V floor(V a) { return _mm_set_pd(std::floor(_mm_cvtsd_f64(_mm_unpackhi_pd(a, a))), std::floor(_mm_cvtsd_f64(a))); }
+#endif
+                static M isNaN(V a) { return _mm_cmpunord_pd(a, a); }
+                static M orMask(M a, M b) { return _mm_or_pd(a, b); }
+                static bool any(M m) { return _mm_movemask_pd(m) != 0; }
+            };
+
+            template <>
+            struct Vec<float>
+            {
+                using V = __m128;
+                static constexpr size_t width = 4;
+
+                static V load(const float *p) { return _mm_loadu_ps(p); }
+                static void store(float *p, V v) { _mm_storeu_ps(p, v); }
+                static V set1(float x) { return _mm_set1_ps(x); }
+                static V add(V a, V b) { return _mm_add_ps(a, b); }
+                static V sub(V a, V b) { return _mm_sub_ps(a, b); }
+                static V mul(V a, V b) { return _mm_mul_ps(a, b); }
+                static V div(V a, V b) { return _mm_div_ps(a, b); }
+                static V sqrt(V a) { return _mm_sqrt_ps(a); }
+                static V abs(V a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+#ifdef __SSE4_1__
+                static V floor(V a) { return _mm_floor_ps(a); }
+#else
+                static V floor(V a)
+                {
+                    alignas(16) float lanes[4];
+                    _mm_store_ps(lanes, a);
+                    for (float &x : lanes)
+                        x = std::floor(x);
+                    return _mm_load_ps(lanes);
+                }
+#endif
+            };
+
+            constexpr const char *kIsa = "sse2";
+
+#elif defined(TS_SIMD_NEON)
+            template <>
+            struct Vec<double>
+            {
+                using V = float64x2_t;
+                using M = uint64x2_t;
+                static constexpr size_t width = 2;
+
+                static V load(const double *p) { return vld1q_f64(p); }
+                static V load(const float *p) { return vcvt_f64_f32(vld1_f32(p)); } // widening
+                static void store(double *p, V v) { vst1q_f64(p, v); }
+                static V set1(double x) { return vdupq_n_f64(x); }
+                static V add(V a, V b) { return vaddq_f64(a, b); }
+                static V sub(V a, V b) { return vsubq_f64(a, b); }
+                static V mul(V a, V b) { return vmulq_f64(a, b); }
+                static V div(V a, V b) { return vdivq_f64(a, b); }
+                static V mulAdd(V a, V b, V c) { return vfmaq_f64(c, a, b); }
+                static V min(V a, V b) { return vminq_f64(a, b); }
+                static V max(V a, V b) { return vmaxq_f64(a, b); }
+                static V sqrt(V a) { return vsqrtq_f64(a); }
+                static V abs(V a) { return vabsq_f64(a); }
+                static V floor(V a) { return vrndmq_f64(a); }
+                static M isNaN(V a) { return veorq_u64(vceqq_f64(a, a), vdupq_n_u64(~0ULL)); }
+                static M orMask(M a, M b) { return vorrq_u64(a, b); }
+                static bool any(M m) { return vmaxvq_u32(vreinterpretq_u32_u64(m)) != 0; }
+            };
+
+            template <>
+            struct Vec<float>
+            {
+                using V = float32x4_t;
+                static constexpr size_t width = 4;
+
+                static V load(const float *p) { return vld1q_f32(p); }
+                static void store(float *p, V v) { vst1q_f32(p, v); }
+                static V set1(float x) { return vdupq_n_f32(x); }
+                static V add(V a, V b) { return vaddq_f32(a, b); }
+                static V sub(V a, V b) { return vsubq_f32(a, b); }
+                static V mul(V a, V b) { return vmulq_f32(a, b); }
+                static V div(V a, V b) { return vdivq_f32(a, b); }
+                static V sqrt(V a) { return vsqrtq_f32(a); }
+                static V abs(V a) { return vabsq_f32(a); }
+                static V floor(V a) { return vrndmq_f32(a); }
+            };
+
+            constexpr const char *kIsa = "neon";
+
+#else
+            // Scalar fallback: one lane per "register"
+            template <typename T>
+            struct Vec
+            {
+                using V = T;
+                using M = bool;
+                static constexpr size_t width = 1;
+
+                template <typename U>
+                static V load(const U *p) { return static_cast<T>(*p); } // widening for U = float
+                static void store(T *p, V v) { *p = v; }
+                static V set1(T x) { return x; }
+                static V add(V a, V b) { return a + b; }
+                static V sub(V a, V b) { return a - b; }
+                static V mul(V a, V b) { return a * b; }
+                static V div(V a, V b) { return a / b; }
+                static V mulAdd(V a, V b, V c) { return a * b + c; }
+                static V min(V a, V b) { return std::min(a, b); }
+                static V max(V a, V b) { return std::max(a, b); }
+                static V sqrt(V a) { return std::sqrt(a); }
+                static V abs(V a) { return std::fabs(a); }
+                static V floor(V a) { return std::floor(a); }
+                static M isNaN(V a) { return a != a; }
+                static M orMask(M a, M b) { return a || b; }
+                static bool any(M m) { return m; }
+            };
+
+            constexpr const char *kIsa = "scalar";
+#endif
+
+            using Wide = Vec<double>; // accumulator of reductions
+
+            // Combines the lanes of an accumulator
+            template <typename Op>
+            double reduceLanes(Wide::V v, Op op)
+            {
+                double lanes[Wide::width];
+                Wide::store(lanes, v);
+                double r = lanes[0];
+                for (size_t k = 1; k < Wide::width; ++k)
+                    r = op(r, lanes[k]);
+                return r;
+            }
+
+            // --- Kernels ---
+            template <typename T, typename VecFn, typename ScalarFn>
+            void mapWith(const T *in, T *out, size_t n, VecFn vec, ScalarFn scalar)
+            {
+                using W = Vec<T>;
+                size_t i = 0;
+                for (; i + W::width <= n; i += W::width)
+                    W::store(out + i, vec(W::load(in + i)));
+                for (; i < n; ++i)
+                    out[i] = scalar(in[i]);
+            }
+
+            template <typename T, typename VecFn, typename ScalarFn>
+            void combineWith(const T *a, const T *b, T *out, size_t n, VecFn vec, ScalarFn scalar)
+            {
+                using W = Vec<T>;
+                size_t i = 0;
+                for (; i + W::width <= n; i += W::width)
+                    W::store(out + i, vec(W::load(a + i), W::load(b + i)));
+                for (; i < n; ++i)
+                    out[i] = scalar(a[i], b[i]);
+            }
+
+            template <typename T>
+            void mapImpl(Unary op, const T *in, T *out, size_t n)
+            {
+                using W = Vec<T>;
+                using V = typename W::V;
+                switch (op)
+                {
+                case Unary::Sqrt:
+                    mapWith(in, out, n, [](V v)
+                            { return W::sqrt(v); }, [](T x)
+                            { return std::sqrt(x); });
+                    break;
+                case Unary::Abs:
+                    mapWith(in, out, n, [](V v)
+                            { return W::abs(v); }, [](T x)
+                            { return std::fabs(x); });
+                    break;
+                case Unary::Floor:
+                    mapWith(in, out, n, [](V v)
+                            { return W::floor(v); }, [](T x)
+                            { return std::floor(x); });
+                    break;
+                case Unary::Sin:
+                    for (size_t i = 0; i < n; ++i)
+                        out[i] = std::sin(in[i]);
+                    break;
+                case Unary::Cos:
+                    for (size_t i = 0; i < n; ++i)
+                        out[i] = std::cos(in[i]);
+                    break;
+                }
+            }
+
+            template <typename T>
+            void powImpl(const T *in, T exponent, T *out, size_t n)
+            {
+                using W = Vec<T>;
+                using V = typename W::V;
+                // Common exponents have exact vector forms
+                if (exponent == T(2))
+                    mapWith(in, out, n, [](V v)
+                            { return W::mul(v, v); }, [](T x)
+                            { return x * x; });
+                else if (exponent == T(1))
+                    std::copy(in, in + n, out);
+                else
+                {
+                    for (size_t i = 0; i < n; ++i)
+                        out[i] = std::pow(in[i], exponent);
+                }
+            }
+
+            template <typename T>
+            void combineImpl(Binary op, const T *a, const T *b, T *out, size_t n)
+            {
+                using W = Vec<T>;
+                using V = typename W::V;
+                switch (op)
+                {
+                case Binary::Add:
+                    combineWith(a, b, out, n, [](V x, V y)
+                                { return W::add(x, y); }, [](T x, T y)
+                                { return x + y; });
+                    break;
+                case Binary::Sub:
+                    combineWith(a, b, out, n, [](V x, V y)
+                                { return W::sub(x, y); }, [](T x, T y)
+                                { return x - y; });
+                    break;
+                case Binary::Mul:
+                    combineWith(a, b, out, n, [](V x, V y)
+                                { return W::mul(x, y); }, [](T x, T y)
+                                { return x * y; });
+                    break;
+                case Binary::Div:
+                    combineWith(a, b, out, n, [](V x, V y)
+                                { return W::div(x, y); }, [](T x, T y)
+                                { return x / y; });
+                    break;
+                }
+            }
+
+            template <typename T>
+            void scaleImpl(T *data, T factor, size_t n)
+            {
+                using W = Vec<T>;
+                typename W::V k = W::set1(factor);
+                mapWith(data, data, n, [k](typename W::V v)
+                        { return W::mul(v, k); }, [factor](T x)
+                        { return x * factor; });
+            }
+
+            template <typename T>
+            double sumImpl(const T *data, size_t n)
+            {
+                // Two accumulators hide the latency of the adds
+                Wide::V acc0 = Wide::set1(0.0);
+                Wide::V acc1 = Wide::set1(0.0);
+                size_t i = 0;
+                for (; i + 2 * Wide::width <= n; i += 2 * Wide::width)
+                {
+                    acc0 = Wide::add(acc0, Wide::load(data + i));
+                    acc1 = Wide::add(acc1, Wide::load(data + i + Wide::width));
+                }
+                double total = reduceLanes(Wide::add(acc0, acc1), [](double x, double y)
+                                           { return x + y; });
+                for (; i < n; ++i)
+                    total += static_cast<double>(data[i]);
+                return total;
+            }
+
+            template <typename T>
+            double dotImpl(const T *a, const T *b, size_t n)
+            {
+                Wide::V acc0 = Wide::set1(0.0);
+                Wide::V acc1 = Wide::set1(0.0);
+                size_t i = 0;
+                for (; i + 2 * Wide::width <= n; i += 2 * Wide::width)
+                {
+                    acc0 = Wide::mulAdd(Wide::load(a + i), Wide::load(b + i), acc0);
+                    acc1 = Wide::mulAdd(Wide::load(a + i + Wide::width), Wide::load(b + i + Wide::width), acc1);
+                }
+                double total = reduceLanes(Wide::add(acc0, acc1), [](double x, double y)
+                                           { return x + y; });
+                for (; i < n; ++i)
+                    total += static_cast<double>(a[i]) * static_cast<double>(b[i]);
+                return total;
+            }
+
+            template <bool Max, typename T>
+            double extremeImpl(const T *data, size_t n)
+            {
+                constexpr double nan = std::numeric_limits<double>::quiet_NaN();
+                double best = Max ? -std::numeric_limits<double>::infinity() : std::numeric_limits<double>::infinity();
+                size_t i = 0;
+                if (n >= Wide::width)
+                {
+                    // Vector min/max do not propagate NaN, so NaN lanes are tracked separately
+                    Wide::V acc = Wide::load(data);
+                    Wide::M nans = Wide::isNaN(acc);
+                    for (i = Wide::width; i + Wide::width <= n; i += Wide::width)
+                    {
+                        Wide::V v = Wide::load(data + i);
+                        nans = Wide::orMask(nans, Wide::isNaN(v));
+                        acc = Max ? Wide::max(acc, v) : Wide::min(acc, v);
+                    }
+                    if (Wide::any(nans))
+                        return nan;
+                    best = reduceLanes(acc, [](double x, double y)
+                                       { return Max ? std::max(x, y) : std::min(x, y); });
+                }
+                for (; i < n; ++i)
+                {
+                    double x = static_cast<double>(data[i]);
+                    if (std::isnan(x))
+                        return nan;
+                    best = Max ? std::max(best, x) : std::min(best, x);
+                }
+                return best;
+            }
+        } // namespace
+
+        const char *isa() { return kIsa; }
+
+        void map(Unary op, const double *in, double *out, size_t n) { mapImpl(op, in, out, n); }
+        void map(Unary op, const float *in, float *out, size_t n) { mapImpl(op, in, out, n); }
+
+        void pow(const double *in, double exponent, double *out, size_t n) { powImpl(in, exponent, out, n); }
+        void pow(const float *in, float exponent, float *out, size_t n) { powImpl(in, exponent, out, n); }
+
+        void combine(Binary op, const double *a, const double *b, double *out, size_t n) { combineImpl(op, a, b, out, n); }
+        void combine(Binary op, const float *a, const float *b, float *out, size_t n) { combineImpl(op, a, b, out, n); }
+
+        void scale(double *data, double factor, size_t n) { scaleImpl(data, factor, n); }
+        void scale(float *data, float factor, size_t n) { scaleImpl(data, factor, n); }
+
+        double sum(const double *data, size_t n) { return sumImpl(data, n); }
+        double sum(const float *data, size_t n) { return sumImpl(data, n); }
+
+        double dot(const double *a, const double *b, size_t n) { return dotImpl(a, b, n); }
+        double dot(const float *a, const float *b, size_t n) { return dotImpl(a, b, n); }
+
+        double min(const double *data, size_t n) { return extremeImpl<false>(data, n); }
+        double min(const float *data, size_t n) { return extremeImpl<false>(data, n); }
+        double max(const double *data, size_t n) { return extremeImpl<true>(data, n); }
+        double max(const float *data, size_t n) { return extremeImpl<true>(data, n); }
+
+    } // namespace Simd
+
+} // namespace TS
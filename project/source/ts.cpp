@@ -1,117 +1,412 @@
 // ts.cpp
 #include "ts.h"
 #include "os.h"
-#include <sstream>
-#include <map>
+#include "lexer.h"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <deque>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace TS
 {
 
     // --- Value Constructors ---
-    Value::Value() : type(ValueType::Null), data(false) {}
-    Value::Value(NUMBER num) : type(ValueType::Number), data(num) {}
-    Value::Value(const std::string &str) : type(ValueType::String), data(str) {}
-    Value::Value(bool b) : type(ValueType::Boolean), data(b) {}
-    Value::Value(_half b) : type(ValueType::Half), data(b) {}
+    Value::Value(const std::string &str) : type(ValueType::String) { payload.string = new StringData(str); }
+    Value::Value(std::string &&str) : type(ValueType::String) { payload.string = new StringData(std::move(str)); }
+    Value::Value(const char *str) : type(ValueType::String) { payload.string = new StringData(str); }
 
-    // --- Conversions ---
-    std::string Value::toString() const
+    Value Value::makeArray(std::vector<Value> elements)
+    {
+        Value v;
+        v.type = ValueType::Array;
+        v.payload.array = new ArrayData<Value>(std::move(elements));
+        return v;
+    }
+
+    Value Value::makeTypedArray(ValueType type, size_t length)
     {
+        Value v;
         switch (type)
         {
-        case ValueType::Number:
+        case ValueType::Float64Array:
+            v.payload.f64 = new ArrayData<double>(std::vector<double>(length));
+            break;
+        case ValueType::Float32Array:
+            v.payload.f32 = new ArrayData<float>(std::vector<float>(length));
+            break;
+        case ValueType::Float16Array:
+            v.payload.f16 = new ArrayData<_half>(std::vector<_half>(length, _half(0.0f)));
+            break;
+        default:
+            return makeArray(std::vector<Value>(length));
+        }
+        v.type = type;
+        return v;
+    }
+
+    Value Value::makeObject(const Shape *shape, std::vector<Value> slots)
+    {
+        Value v;
+        v.type = ValueType::Object;
+        v.payload.object = new ObjectData();
+        v.payload.object->shape = shape;
+        v.payload.object->slots = std::move(slots);
+        return v;
+    }
+
+    void Value::destroyShared()
+    {
+        switch (type)
         {
-            std::ostringstream oss;
-            oss << std::get<NUMBER>(data);
-            return oss.str();
+        case ValueType::String:
+            delete payload.string;
+            break;
+        case ValueType::Array:
+            delete payload.array;
+            break;
+        case ValueType::Float64Array:
+            delete payload.f64;
+            break;
+        case ValueType::Float32Array:
+            delete payload.f32;
+            break;
+        case ValueType::Float16Array:
+            delete payload.f16;
+            break;
+        case ValueType::Object:
+            delete payload.object;
+            break;
+        default:
+            break;
         }
+    }
+
+    // --- Equality ---
+    bool Value::strictEquals(const Value &other) const
+    {
+        if (type != other.type)
+            return false;
+        switch (type)
+        {
+        case ValueType::Number:
+            return payload.number == other.payload.number;
         case ValueType::String:
-            return std::get<std::string>(data);
+            return payload.string == other.payload.string || asString() == other.asString();
         case ValueType::Boolean:
-            return std::get<bool>(data) ? "true" : "false";
-        case ValueType::NaN:
-            return "NaN";
-
-        case ValueType::Undefined:
-            return "undefined";
-
+            return payload.boolean == other.payload.boolean;
 #ifdef ADD_STD_HALF
         case ValueType::Half:
-        {
-            std::ostringstream oss;
-            _half h = std::get<_half>(data); // extract the half value
-            oss << static_cast<float>(h);    // convert to float and stream it
-            return oss.str();
-        }
+            return payload.fp16 == other.payload.fp16;
 #endif
-
+        case ValueType::NaN:
+            return false;
+        case ValueType::Array:
+        case ValueType::Float64Array:
+        case ValueType::Float32Array:
+        case ValueType::Float16Array:
+        case ValueType::Object:
+            return payload.bits == other.payload.bits; // the same array or object
         case ValueType::Null:
+        case ValueType::Undefined:
         default:
-            return "null";
+            return true;
         }
     }
 
-    NUMBER Value::toNumber() const
+    bool Value::looseEquals(const Value &other) const
     {
-        auto fastParseNUMBER = [](const std::string &s, bool &ok) -> NUMBER
+        if (type == other.type)
+            return strictEquals(other);
+
+        auto isNullish = [](ValueType t)
+        { return t == ValueType::Null || t == ValueType::Undefined; };
+        if (isNullish(type) || isNullish(other.type))
+            return isNullish(type) && isNullish(other.type);
+
+        // Remaining mixes (number, string, boolean, half) compare numerically
+        return toNumber() == other.toNumber();
+    }
+
+    // --- Number Conversions ---
+    template <typename Float>
+    static size_t formatNumberImpl(Float value, char *buffer)
+    {
+        char *out = buffer;
+        auto put = [&out](const char *text)
         {
-            const char *str = s.c_str();
-            char *endptr = nullptr;
-            ok = false;
+            while (*text)
+                *out++ = *text++;
+        };
 
-            // Skip leading whitespace
-            while (*str == ' ' || *str == '\t' || *str == '\n' || *str == '\r')
+        if (std::isnan(value))
+        {
+            put("NaN");
+            return out - buffer;
+        }
+        if (value == 0) // also -0
+        {
+            put("0");
+            return out - buffer;
+        }
+        if (std::isinf(value))
+        {
+            put(value < 0 ? "-Infinity" : "Infinity");
+            return out - buffer;
+        }
+        if (value < 0)
+        {
+            *out++ = '-';
+            value = -value;
+        }
+
+        // Shortest round-trip digits as d.ddde[+-]x
+        char sci[kNumberTextMax];
+        auto result = std::to_chars(sci, sci + sizeof(sci), value, std::chars_format::scientific);
+        char digits[kNumberTextMax];
+        int k = 0;
+        const char *p = sci;
+        for (; p < result.ptr && *p != 'e'; ++p)
+        {
+            if (*p != '.')
+                digits[k++] = *p;
+        }
+        int exponent = 0;
+        std::from_chars(p + 1 + (p[1] == '+'), result.ptr, exponent);
+        int n = exponent + 1; // position of the decimal point
+
+        if (k <= n && n <= 21)
+        {
+            // Integer: digits followed by zeros
+            for (int i = 0; i < k; ++i)
+                *out++ = digits[i];
+            for (int i = k; i < n; ++i)
+                *out++ = '0';
+        }
+        else if (0 < n && n <= 21)
+        {
+            for (int i = 0; i < n; ++i)
+                *out++ = digits[i];
+            *out++ = '.';
+            for (int i = n; i < k; ++i)
+                *out++ = digits[i];
+        }
+        else if (-6 < n && n <= 0)
+        {
+            *out++ = '0';
+            *out++ = '.';
+            for (int i = n; i < 0; ++i)
+                *out++ = '0';
+            for (int i = 0; i < k; ++i)
+                *out++ = digits[i];
+        }
+        else
+        {
+            *out++ = digits[0];
+            if (k > 1)
             {
-                ++str;
+                *out++ = '.';
+                for (int i = 1; i < k; ++i)
+                    *out++ = digits[i];
             }
+            *out++ = 'e';
+            *out++ = n - 1 >= 0 ? '+' : '-';
+            out = std::to_chars(out, buffer + kNumberTextMax, n - 1 >= 0 ? n - 1 : 1 - n).ptr;
+        }
+        return out - buffer;
+    }
 
-            if (*str == '\0')
-                return 0.0;
+    size_t formatNumber(double value, char *buffer)
+    {
+        return formatNumberImpl(value, buffer);
+    }
 
-            errno = 0;
-            NUMBER val = std::strtod(str, &endptr);
+    size_t formatNumber(float value, char *buffer)
+    {
+        return formatNumberImpl(value, buffer);
+    }
 
-            if (endptr != str && errno == 0)
-            {
-                ok = true;
-                return val;
-            }
-            return 0.0;
-        };
+    NUMBER parseNumber(std::string_view text)
+    {
+        constexpr NUMBER nan = std::numeric_limits<NUMBER>::quiet_NaN();
+
+        while (!text.empty() && std::isspace(static_cast<unsigned char>(text.front())))
+            text.remove_prefix(1);
+        while (!text.empty() && std::isspace(static_cast<unsigned char>(text.back())))
+            text.remove_suffix(1);
+        if (text.empty())
+            return 0;
+
+        bool negative = false;
+        bool hasSign = text.front() == '+' || text.front() == '-';
+        if (hasSign)
+        {
+            negative = text.front() == '-';
+            text.remove_prefix(1);
+        }
+        if (text == "Infinity")
+            return negative ? -std::numeric_limits<NUMBER>::infinity() : std::numeric_limits<NUMBER>::infinity();
 
-        switch (type)
+        NUMBER value = 0;
+        if (text.size() > 2 && text[0] == '0' && (text[1] == 'x' || text[1] == 'X'))
         {
-        case ValueType::Number:
-            return std::get<NUMBER>(data);
+            // Hex integers (no sign allowed, like JavaScript)
+            if (hasSign)
+                return nan;
+            uint64_t bits = 0;
+            auto result = std::from_chars(text.data() + 2, text.data() + text.size(), bits, 16);
+            if (result.ec != std::errc() || result.ptr != text.data() + text.size())
+                return nan;
+            return static_cast<NUMBER>(bits);
+        }
 
-        case ValueType::String:
+        // from_chars also accepts "inf" and "nan", which JavaScript does not
+        if (!std::isdigit(static_cast<unsigned char>(text.front())) && text.front() != '.')
+            return nan;
+        auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+        if (result.ptr != text.data() + text.size())
+            return nan;
+        if (result.ec == std::errc::result_out_of_range)
+            return negative ? -std::numeric_limits<NUMBER>::infinity() : std::numeric_limits<NUMBER>::infinity();
+        if (result.ec != std::errc())
+            return nan;
+        return negative ? -value : value;
+    }
+
+    // --- Conversions ---
+    // Arrays being converted by appendTo on this thread; a cyclic reference
+    // converts to an empty string, like Array.prototype.join
+    static thread_local std::vector<const void *> joining;
+
+    static void appendElements(const Value &array, std::string &out)
+    {
+        const void *id = reinterpret_cast<const void *>(array.payload.bits);
+        for (const void *active : joining)
         {
-            const std::string &strVal = std::get<std::string>(data);
-            bool ok = false;
-            NUMBER parsed = fastParseNUMBER(strVal, ok);
-            if (ok)
-                return parsed;
-
-            // Fallback to std::stod if needed
-            try
+            if (active == id)
+                return;
+        }
+        joining.push_back(id);
+        char buffer[kNumberTextMax];
+        size_t n = array.length();
+        for (size_t i = 0; i < n; ++i)
+        {
+            if (i > 0)
+                out += ',';
+            switch (array.type)
             {
-                return std::stod(strVal);
-            }
-            catch (...)
+            case ValueType::Float64Array:
+                out.append(buffer, formatNumber(array.asFloat64Array()[i], buffer));
+                break;
+            case ValueType::Float32Array:
+                out.append(buffer, formatNumber(static_cast<double>(array.asFloat32Array()[i]), buffer));
+                break;
+            case ValueType::Float16Array:
+                out.append(buffer, formatNumber(static_cast<double>(static_cast<float>(array.asFloat16Array()[i])), buffer));
+                break;
+            default:
             {
-                return 0.0;
+                const Value &element = array.asArray()[i];
+                if (element.type != ValueType::Null && element.type != ValueType::Undefined)
+                    element.appendTo(out);
+                break;
             }
+            }
+        }
+        joining.pop_back();
+    }
+
+    void Value::appendTo(std::string &out) const
+    {
+        char buffer[kNumberTextMax];
+        switch (type)
+        {
+        case ValueType::Array:
+        case ValueType::Float64Array:
+        case ValueType::Float32Array:
+        case ValueType::Float16Array:
+            appendElements(*this, out);
+            return;
+
+        case ValueType::Number:
+            out.append(buffer, formatNumber(payload.number, buffer));
+            return;
+        case ValueType::String:
+            out += asString();
+            return;
+        case ValueType::Boolean:
+            out += payload.boolean ? "true" : "false";
+            return;
+        case ValueType::NaN:
+            out += "NaN";
+            return;
+
+        case ValueType::Undefined:
+            out += "undefined";
+            return;
+
+        case ValueType::Object:
+            out += "[object Object]";
+            return;
+
+#ifdef ADD_STD_HALF
+        case ValueType::Half:
+            out.append(buffer, formatNumber(static_cast<float>(payload.fp16), buffer));
+            return;
+#endif
+
+        case ValueType::Null:
+        default:
+            out += "null";
+            return;
         }
+    }
+
+    std::string Value::toString() const
+    {
+        if (type == ValueType::String)
+            return asString();
+        std::string out;
+        appendTo(out);
+        return out;
+    }
+
+    NUMBER Value::toNumber() const
+    {
+        switch (type)
+        {
+        case ValueType::Number:
+            return payload.number;
+
+        case ValueType::String:
+            return parseNumber(asString());
 
         case ValueType::Boolean:
-            return std::get<bool>(data) ? 1.0 : 0.0;
+            return payload.boolean ? 1.0 : 0.0;
+
+        case ValueType::NaN:
+            return std::numeric_limits<NUMBER>::quiet_NaN();
 
 #ifdef ADD_STD_HALF
         case ValueType::Half:
-            return static_cast<NUMBER>(static_cast<float>(std::get<_half>(data)));
+            return static_cast<NUMBER>(static_cast<float>(payload.fp16));
 #endif
+        // Like JavaScript: [] is 0, [x] is Number(x), anything longer is NaN
+        case ValueType::Array:
+        case ValueType::Float64Array:
+        case ValueType::Float32Array:
+        case ValueType::Float16Array:
+            return parseNumber(toString());
+
+        case ValueType::Object:
+            return std::numeric_limits<NUMBER>::quiet_NaN();
+
         case ValueType::Null:
         default:
             return 0.0;
@@ -123,14 +418,20 @@ namespace TS
         switch (type)
         {
         case ValueType::Boolean:
-            return std::get<bool>(data);
+            return payload.boolean;
         case ValueType::Number:
-            return std::get<NUMBER>(data) != 0.0;
+            return payload.number != 0.0 && !std::isnan(payload.number);
         case ValueType::String:
-            return !std::get<std::string>(data).empty();
+            return !asString().empty();
+        case ValueType::Array:
+        case ValueType::Float64Array:
+        case ValueType::Float32Array:
+        case ValueType::Float16Array:
+        case ValueType::Object:
+            return true; // objects are always truthy
 #ifdef ADD_STD_HALF
         case ValueType::Half:
-            return std::get<_half>(data) != 0.0;
+            return payload.fp16 != 0;
 #endif
         case ValueType::Null:
         default:
@@ -148,170 +449,233 @@ namespace TS
         return this->toBool() == true;
     }
 
-    // --- Environment Helpers ---
-    bool setVar(Environment &env, const std::string &name, const Value &value)
+    // --- Atoms ---
+    namespace
     {
-        env[name] = value;
+        struct AtomTable
+        {
+            std::deque<std::string> names; // by atom; elements never move
+            std::unordered_map<std::string_view, uint32_t> atoms;
+            std::shared_mutex lock;
+        };
+
+        AtomTable &atomTable()
+        {
+            static AtomTable table;
+            return table;
+        }
+    }
+
+    uint32_t atom(std::string_view name)
+    {
+        AtomTable &table = atomTable();
+        {
+            std::shared_lock<std::shared_mutex> reading(table.lock);
+            auto it = table.atoms.find(name);
+            if (it != table.atoms.end())
+                return it->second;
+        }
+        std::unique_lock<std::shared_mutex> writing(table.lock);
+        auto it = table.atoms.find(name); // interned by another thread meanwhile?
+        if (it != table.atoms.end())
+            return it->second;
+        uint32_t id = static_cast<uint32_t>(table.names.size());
+        table.names.emplace_back(name);
+        table.atoms.emplace(table.names.back(), id);
+        return id;
+    }
+
+    bool findAtom(std::string_view name, uint32_t &outAtom)
+    {
+        AtomTable &table = atomTable();
+        std::shared_lock<std::shared_mutex> reading(table.lock);
+        auto it = table.atoms.find(name);
+        if (it == table.atoms.end())
+            return false;
+        outAtom = it->second;
         return true;
     }
 
-    std::optional<Value> getVar(const Environment &env, const std::string &name)
+    const std::string &atomName(uint32_t atom)
     {
-        auto it = env.find(name);
-        return (it != env.end()) ? std::optional<Value>(it->second) : std::nullopt;
+        AtomTable &table = atomTable();
+        std::shared_lock<std::shared_mutex> reading(table.lock);
+        return table.names.at(atom);
     }
 
-    bool varExists(const Environment &env, const std::string &name)
+    Value &AtomMap::operator[](uint32_t atom)
     {
-        return env.find(name) != env.end();
+        if (Value *value = find(atom))
+            return *value;
+        if ((entries.size() + 1) * 2 > buckets.size())
+            grow();
+        entries.push_back(std::make_unique<Entry>(Entry{atom, Value()}));
+        Value *value = &entries.back()->value;
+        size_t mask = buckets.size() - 1;
+        size_t i = hash(atom) & mask;
+        while (buckets[i].value)
+            i = (i + 1) & mask;
+        buckets[i] = Bucket{atom, value};
+        return *value;
     }
 
-    static inline void trim(std::string &s)
+    void AtomMap::grow()
     {
-        size_t start = 0;
-        size_t end = s.size();
+        std::vector<Bucket> old = std::move(buckets);
+        buckets.assign(std::max<size_t>(8, old.size() * 2), Bucket());
+        size_t mask = buckets.size() - 1;
+        for (const Bucket &bucket : old)
+        {
+            if (!bucket.value)
+                continue;
+            size_t i = hash(bucket.atom) & mask;
+            while (buckets[i].value)
+                i = (i + 1) & mask;
+            buckets[i] = bucket;
+        }
+    }
 
-        // Skip leading whitespace
-        while (start < end && std::isspace(static_cast<unsigned char>(s[start])))
-            ++start;
+    // --- Environment Helpers ---
+    bool setVar(Environment &env, const std::string &name, const Value &value)
+    {
+        return setVar(env, atom(name), value);
+    }
 
-        // Skip trailing whitespace
-        while (end > start && std::isspace(static_cast<unsigned char>(s[end - 1])))
-            --end;
+    bool setVar(Environment &env, uint32_t atom, const Value &value)
+    {
+        env.vars[atom] = value;
+        return true;
+    }
 
-        if (start > 0 || end < s.size())
-            s.erase(end, s.size() - end), s.erase(0, start);
+    std::optional<Value> getVar(const Environment &env, const std::string &name)
+    {
+        const Value *v = env.lookup(name);
+        return v ? std::optional<Value>(*v) : std::nullopt;
+    }
+
+    bool varExists(const Environment &env, const std::string &name)
+    {
+        return env.lookup(name) != nullptr;
     }
 
 #ifndef SKIP_TYPECHECK
-    std::vector<TypeError> checkTypesInSource(const std::string &source)
+    // Type of an argument that is known before execution: a single literal token.
+    // Returns nullptr for variables and expressions, which are checked at call time.
+    static const char *literalType(const Token *begin, const Token *end)
     {
-        std::vector<TypeError> errors;
-        std::map<std::string, std::vector<std::string>> funcParamTypes;
+        if (end - begin != 1)
+            return nullptr;
+        switch (begin->type)
+        {
+        case TokenType::Number:
+            return "number";
+        case TokenType::String:
+            return "string";
+        case TokenType::Identifier:
+            if (begin->text == "true" || begin->text == "false")
+                return "boolean";
+            return nullptr;
+        default:
+            return nullptr;
+        }
+    }
 
-        // Split into lines
-        std::vector<std::string> lines;
+    static inline bool isCheckedType(std::string_view type)
+    {
+        return type == "number" || type == "string" || type == "boolean";
+    }
+
+    TypeCheckResult checkTypes(std::string_view source)
+    {
+        TypeCheckResult result;
+        std::vector<TypeError> &errors = result.errors;
+        std::unordered_map<std::string_view, std::vector<std::string_view>> funcParamTypes;
+        std::vector<size_t> calls; // token index of every callee name
+
+        // One lexing pass, then one walk over the tokens
+        std::vector<Token> tokens = lex(source);
+        for (size_t i = 0; i + 1 < tokens.size(); ++i)
         {
-            size_t start = 0, end;
-            while ((end = source.find('\n', start)) != std::string::npos)
+            if (tokens[i].type != TokenType::Identifier || !tokens[i + 1].is("("))
+                continue;
+
+            if (i == 0 || tokens[i - 1].type != TokenType::Identifier || tokens[i - 1].text != "function")
             {
-                lines.push_back(source.substr(start, end - start));
-                start = end + 1;
+                calls.push_back(i);
+                continue;
             }
-            lines.push_back(source.substr(start));
-        }
 
-        // Pass 1: collect function definitions
-        for (size_t i = 0; i < lines.size(); ++i)
-        {
-            std::string line = lines[i];
-            trim(line);
-            if (line.rfind("function ", 0) == 0)
+            // Declaration: function name(a: number, b, c: string)
+            std::vector<std::string_view> types;
+            std::string_view type = "any"; // default
+            bool hasParam = false;
+            size_t j = i + 2;
+            for (; j < tokens.size() && !tokens[j].is(")"); ++j)
             {
-                size_t nameStart = 9;
-                size_t nameEnd = nameStart;
-                while (nameEnd < line.size() && (isalnum((unsigned char)line[nameEnd]) || line[nameEnd] == '_'))
-                    nameEnd++;
-                std::string funcName = line.substr(nameStart, nameEnd - nameStart);
-
-                size_t paramStart = line.find('(', nameEnd);
-                size_t paramEnd = line.find(')', paramStart);
-                if (paramStart != std::string::npos && paramEnd != std::string::npos)
+                if (tokens[j].is(","))
                 {
-                    std::string params = line.substr(paramStart + 1, paramEnd - paramStart - 1);
-                    std::vector<std::string> types;
-                    size_t pos = 0;
-                    while (pos < params.size())
-                    {
-                        // skip spaces
-                        while (pos < params.size() && isspace((unsigned char)params[pos]))
-                            pos++;
-                        // skip param name
-                        while (pos < params.size() && (isalnum((unsigned char)params[pos]) || params[pos] == '_'))
-                            pos++;
-                        // skip spaces
-                        while (pos < params.size() && isspace((unsigned char)params[pos]))
-                            pos++;
-                        if (pos < params.size() && params[pos] == ':')
-                        {
-                            pos++;
-                            while (pos < params.size() && isspace((unsigned char)params[pos]))
-                                pos++;
-                            size_t typeStart = pos;
-                            while (pos < params.size() && (isalnum((unsigned char)params[pos]) || params[pos] == '_'))
-                                pos++;
-                            types.push_back(params.substr(typeStart, pos - typeStart));
-                        }
-                        // skip to next param
-                        while (pos < params.size() && params[pos] != ',')
-                            pos++;
-                        if (pos < params.size() && params[pos] == ',')
-                            pos++;
-                    }
-                    funcParamTypes[funcName] = types;
+                    types.push_back(type);
+                    type = "any";
+                    hasParam = false;
+                    continue;
                 }
+                if (tokens[j].is(":") && j + 1 < tokens.size() && tokens[j + 1].type == TokenType::Identifier)
+                    type = tokens[++j].text;
+                hasParam = true;
             }
+            if (hasParam)
+                types.push_back(type);
+            funcParamTypes[tokens[i].text] = std::move(types);
+            i = j;
         }
 
-        // Pass 2: check calls
-        for (size_t i = 0; i < lines.size(); ++i)
+        // Calls are checked after the walk, so functions may be used before their declaration
+        for (size_t call : calls)
         {
-            std::string line = lines[i];
-            trim(line);
-            // find function name
-            for (auto &entry : funcParamTypes)
+            auto it = funcParamTypes.find(tokens[call].text);
+            if (it == funcParamTypes.end())
+                continue;
+            const auto &expectedTypes = it->second;
+
+            size_t argStart = call + 2;
+            size_t argIndex = 0;
+            int depth = 0;
+            for (size_t j = argStart; j < tokens.size(); ++j)
             {
-                const std::string &funcName = entry.first;
-                size_t callPos = line.find(funcName + "(");
-                if (callPos != std::string::npos)
+                bool closing = depth == 0 && tokens[j].is(")");
+                if (tokens[j].is("("))
+                    depth++;
+                else if (tokens[j].is(")") && depth > 0)
+                    depth--;
+                if (!closing && !(depth == 0 && tokens[j].is(",")))
+                    continue;
+
+                // Compare types
+                if (argIndex < expectedTypes.size() && isCheckedType(expectedTypes[argIndex]))
                 {
-                    size_t argStart = callPos + funcName.size() + 1;
-                    size_t argEnd = line.find(')', argStart);
-                    if (argEnd != std::string::npos)
+                    const char *actual = literalType(tokens.data() + argStart, tokens.data() + j);
+                    if (actual && expectedTypes[argIndex] != actual)
                     {
-                        std::string args = line.substr(argStart, argEnd - argStart);
-                        std::vector<std::string> argList;
-                        size_t pos = 0;
-                        while (pos < args.size())
-                        {
-                            size_t start = pos;
-                            while (pos < args.size() && args[pos] != ',')
-                                pos++;
-                            std::string arg = args.substr(start, pos - start);
-                            trim(arg);
-                            argList.push_back(arg);
-                            if (pos < args.size() && args[pos] == ',')
-                                pos++;
-                        }
-                        // Compare types
-                        auto &expectedTypes = entry.second;
-                        for (size_t ai = 0; ai < argList.size() && ai < expectedTypes.size(); ++ai)
-                        {
-                            const std::string &expected = expectedTypes[ai];
-                            const std::string &arg = argList[ai];
-                            bool isString = arg.size() >= 2 && ((arg.front() == '"' && arg.back() == '"') || (arg.front() == '\'' && arg.back() == '\''));
-                            bool isNumber = !arg.empty() && (isdigit((unsigned char)arg[0]) || arg[0] == '.');
-                            bool isBool = (arg == "true" || arg == "false");
-
-                            if (expected == "number" && !isNumber)
-                            {
-                                errors.push_back({i + 1, "Argument " + std::to_string(ai + 1) + " to " + funcName + " should be a number"});
-                            }
-                            if (expected == "string" && !isString)
-                            {
-                                errors.push_back({i + 1, "Argument " + std::to_string(ai + 1) + " to " + funcName + " should be a string"});
-                            }
-                            if (expected == "boolean" && !isBool)
-                            {
-                                errors.push_back({i + 1, "Argument " + std::to_string(ai + 1) + " to " + funcName + " should be a boolean"});
-                            }
-                        }
+                        errors.push_back({tokens[call].line, "Argument " + std::to_string(argIndex + 1) + " to " +
+                                                                 std::string(tokens[call].text) + " should be a " +
+                                                                 std::string(expectedTypes[argIndex])});
                     }
                 }
+                argIndex++;
+                argStart = j + 1;
+                if (closing)
+                    break;
             }
         }
 
-        return errors;
+        for (auto &entry : funcParamTypes)
+            result.signatures.emplace(entry.first, std::vector<std::string>(entry.second.begin(), entry.second.end()));
+        return result;
+    }
+
+    std::vector<TypeError> checkTypesInSource(std::string_view source)
+    {
+        return checkTypes(source).errors;
     }
 #endif
 
@@ -0,0 +1,1431 @@
+// vm.cpp
+// The second execution tier: hot user functions compiled from their
+// statement tree to register bytecode (see vm.h).
+#include "vm.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <unordered_map>
+
+#if defined(__GNUC__) || defined(__clang__)
+#define INTERPRETER_COMPUTED_GOTO 1
+#endif
+
+namespace Interpreter
+{
+    namespace
+    {
+        // --- Analysis ---
+
+        // Which slots are provably numbers: `number` parameters (guarded on
+        // entry) and locals that are always set before they are read and only
+        // ever store number-typed expressions.
+        class NumberSlots
+        {
+        public:
+            explicit NumberSlots(const FunctionDef &def) : isNumber(def.slotCount, 0), unsetReads(def.slotCount, 0)
+            {
+                std::vector<char> assigned(def.slotCount, 0);
+                for (size_t i = 0; i < def.params.size() && i < def.slotCount; ++i)
+                {
+                    assigned[i] = 1;
+                    isNumber[i] = i < def.declaredTypes.size() && def.declaredTypes[i] == DeclaredType::Number;
+                }
+                for (size_t i = def.params.size(); i < def.slotCount; ++i)
+                    isNumber[i] = 1; // locals start optimistic
+                scanBlock(def.body, assigned);
+                for (size_t i = def.params.size(); i < def.slotCount; ++i)
+                    if (unsetReads[i])
+                        isNumber[i] = 0;
+
+                // Drop slots storing anything else until nothing changes
+                bool changed = true;
+                while (changed)
+                {
+                    changed = false;
+                    for (const Store &store : stores)
+                    {
+                        if (isNumber[store.slot] && !yieldsNumber(store.expr))
+                        {
+                            isNumber[store.slot] = 0;
+                            changed = true;
+                        }
+                    }
+                }
+            }
+
+            bool number(int32_t slot) const { return slot >= 0 && isNumber[slot]; }
+
+            // Register class of an expression's result, as the code generator produces it
+            bool yieldsNumber(const Expression *expr) const
+            {
+                if (!expr)
+                    return false;
+                std::vector<char> stack;
+                auto pop = [&stack]()
+                {
+                    if (stack.empty())
+                        return false;
+                    bool top = stack.back();
+                    stack.pop_back();
+                    return top != 0;
+                };
+                for (const RpnToken &tok : expr->code)
+                {
+                    switch (tok.kind)
+                    {
+                    case TokenKind::Literal:
+                        stack.push_back(tok.value.type == TS::ValueType::Number);
+                        break;
+                    case TokenKind::Variable:
+                        stack.push_back(!tok.path && number(tok.slot));
+                        break;
+                    case TokenKind::Array:
+                    case TokenKind::Call:
+                    case TokenKind::Object:
+                    case TokenKind::New:
+                        for (uint32_t i = 0; i < tok.argc; ++i)
+                            pop();
+                        stack.push_back(0);
+                        break;
+                    case TokenKind::Member:
+                        pop();
+                        stack.push_back(0);
+                        break;
+                    case TokenKind::Method:
+                        for (uint32_t i = 0; i <= tok.argc; ++i)
+                            pop();
+                        stack.push_back(0);
+                        break;
+                    case TokenKind::Operator:
+                        switch (tok.op)
+                        {
+                        case OpCode::Neg:
+                        case OpCode::Plus:
+                            pop();
+                            stack.push_back(1);
+                            break;
+                        case OpCode::Not:
+                        case OpCode::Length:
+                            pop();
+                            stack.push_back(0);
+                            break;
+                        case OpCode::Add:
+                        {
+                            bool b = pop();
+                            bool a = pop();
+                            stack.push_back(a && b);
+                            break;
+                        }
+                        case OpCode::Sub:
+                        case OpCode::Mul:
+                        case OpCode::Div:
+                        case OpCode::Mod:
+                        case OpCode::Pow:
+                            pop();
+                            pop();
+                            stack.push_back(1);
+                            break;
+                        default:
+                            pop();
+                            pop();
+                            stack.push_back(0);
+                            break;
+                        }
+                        break;
+                    }
+                }
+                return !stack.empty() && stack.back();
+            }
+
+        private:
+            struct Store
+            {
+                int32_t slot;
+                const Expression *expr;
+            };
+
+            void reads(const ExpressionPtr &expr, const std::vector<char> &assigned)
+            {
+                if (!expr)
+                    return;
+                for (const RpnToken &tok : expr->code)
+                    if ((tok.kind == TokenKind::Variable || tok.kind == TokenKind::Call) && tok.slot >= 0 && !assigned[tok.slot])
+                        unsetReads[tok.slot] = 1;
+            }
+
+            void read(int32_t slot, const std::vector<char> &assigned)
+            {
+                if (slot >= 0 && !assigned[slot])
+                    unsetReads[slot] = 1;
+            }
+
+            // `assigned` holds the slots set on every path to the current statement
+            void scanBlock(const Block &block, std::vector<char> &assigned)
+            {
+                for (const Statement &stmt : block)
+                {
+                    switch (stmt.kind)
+                    {
+                    case StatementKind::Let:
+                    case StatementKind::Assign:
+                        if (stmt.index || stmt.path) // writes into what the slot holds
+                        {
+                            read(stmt.slot, assigned);
+                            reads(stmt.index, assigned);
+                            reads(stmt.expr, assigned);
+                            break;
+                        }
+                        reads(stmt.expr, assigned);
+                        if (stmt.slot >= 0)
+                        {
+                            stores.push_back(Store{stmt.slot, stmt.expr.get()});
+                            assigned[stmt.slot] = 1;
+                        }
+                        break;
+                    case StatementKind::If:
+                    {
+                        reads(stmt.expr, assigned);
+                        std::vector<char> thenAssigned = assigned;
+                        scanBlock(stmt.body, thenAssigned);
+                        std::vector<char> elseAssigned = assigned;
+                        scanBlock(stmt.elseBody, elseAssigned);
+                        break;
+                    }
+                    case StatementKind::While:
+                    {
+                        reads(stmt.expr, assigned);
+                        std::vector<char> bodyAssigned = assigned;
+                        scanBlock(stmt.body, bodyAssigned);
+                        break;
+                    }
+                    case StatementKind::For:
+                    {
+                        std::vector<char> loopAssigned = assigned;
+                        scanBlock(stmt.init, loopAssigned);
+                        reads(stmt.expr, loopAssigned);
+                        std::vector<char> bodyAssigned = loopAssigned;
+                        scanBlock(stmt.body, bodyAssigned);
+                        std::vector<char> updateAssigned = loopAssigned; // `continue` skips the rest of the body
+                        scanBlock(stmt.update, updateAssigned);
+                        break;
+                    }
+                    case StatementKind::Call:
+                        if (stmt.path)
+                            read(stmt.slot, assigned);
+                        for (const ExpressionPtr &arg : stmt.args)
+                            reads(arg, assigned);
+                        break;
+                    case StatementKind::Return:
+                        reads(stmt.expr, assigned);
+                        break;
+                    default:
+                        break;
+                    }
+                }
+            }
+
+            std::vector<char> isNumber;
+            std::vector<char> unsetReads;
+            std::vector<Store> stores;
+        };
+
+        // Statements the bytecode has no form for
+        bool compilable(const Block &block)
+        {
+            for (const Statement &stmt : block)
+            {
+                switch (stmt.kind)
+                {
+                case StatementKind::Function:
+                case StatementKind::Class:
+                case StatementKind::Error:
+                    return false;
+                case StatementKind::Let:
+                    if (stmt.slot < 0)
+                        return false; // would create a variable of the frame itself
+                    break;
+                default:
+                    break;
+                }
+                if (!compilable(stmt.init) || !compilable(stmt.body) || !compilable(stmt.elseBody) || !compilable(stmt.update))
+                    return false;
+            }
+            return true;
+        }
+
+        // --- Code generation ---
+
+        using Op = BytecodeOp;
+
+        class BytecodeCompiler
+        {
+        public:
+            BytecodeCompiler(const FunctionDef &def) : def(def), slots(def)
+            {
+                // Slots first, in each register file
+                slotRegisters.resize(def.slotCount);
+                for (uint32_t i = 0; i < def.slotCount; ++i)
+                {
+                    bool number = slots.number(static_cast<int32_t>(i));
+                    slotRegisters[i] = Operand{number, number ? numberSlots++ : valueSlots++};
+                }
+            }
+
+            std::shared_ptr<const Bytecode> compile()
+            {
+                // Numeric literals get registers after the slots; gather them first
+                out.firstConstant = numberSlots;
+                collectNumbers(def.body);
+
+                for (size_t i = 0; i < def.params.size() && i < def.slotCount; ++i)
+                    out.params.push_back(Bytecode::Parameter{slotRegisters[i].number, slotRegisters[i].reg});
+
+                resetTemporaries();
+                if (!block(def.body))
+                    return nullptr;
+                emit(Op::ReturnUndefined);
+
+                out.numberRegisters = std::max(maxNumberTemps, out.firstConstant + static_cast<uint32_t>(out.numbers.size()));
+                out.valueRegisters = std::max(maxValueTemps, valueSlots);
+                return std::make_shared<const Bytecode>(std::move(out));
+            }
+
+        private:
+            struct Operand
+            {
+                bool number = false;
+                uint32_t reg = 0;
+                int32_t producer = -1; // temporaries: the instruction writing them
+            };
+
+            struct Loop
+            {
+                std::vector<size_t> breaks;
+                std::vector<size_t> continues;
+            };
+
+            const FunctionDef &def;
+            NumberSlots slots;
+            std::vector<Operand> slotRegisters;
+            uint32_t numberSlots = 0;
+            uint32_t valueSlots = 0;
+            uint32_t nextNumber = 0;
+            uint32_t nextValue = 0;
+            uint32_t maxNumberTemps = 0;
+            uint32_t maxValueTemps = 0;
+            std::unordered_map<uint64_t, uint32_t> numberRegisters; // literal bits -> register
+            std::unordered_map<std::string, uint32_t> nameIndices;
+            std::unordered_map<const PropertyPath *, uint32_t> pathIndices;
+            std::vector<Loop> loops;
+            Bytecode out;
+
+            // --- Emitting ---
+
+            size_t emit(Op op, uint32_t a = 0, uint32_t b = 0, uint32_t c = 0, uint32_t d = 0)
+            {
+                Instruction ins;
+                ins.op = op;
+                ins.a = a;
+                ins.b = b;
+                ins.c = c;
+                ins.d = d;
+                out.code.push_back(ins);
+                return out.code.size() - 1;
+            }
+
+            uint32_t here() const { return static_cast<uint32_t>(out.code.size()); }
+
+            void patch(size_t jump, uint32_t target) { out.code[jump].a = target; }
+
+            uint32_t name(const std::string &text)
+            {
+                auto found = nameIndices.find(text);
+                if (found != nameIndices.end())
+                    return found->second;
+                uint32_t index = static_cast<uint32_t>(out.names.size());
+                out.names.push_back(text);
+                out.atoms.push_back(TS::atom(text));
+                out.paths.emplace_back();
+                nameIndices.emplace(text, index);
+                return index;
+            }
+
+            // A name with its property path; every path is its own entry, so its caches stay its own
+            uint32_t path(const std::string &text, uint32_t atom, const PropertyPathPtr &path)
+            {
+                auto found = pathIndices.find(path.get());
+                if (found != pathIndices.end())
+                    return found->second;
+                uint32_t index = static_cast<uint32_t>(out.names.size());
+                out.names.push_back(text);
+                out.atoms.push_back(atom);
+                out.paths.push_back(path);
+                pathIndices.emplace(path.get(), index);
+                return index;
+            }
+
+            // The value register a dotted name's first part is read from, if it is a local
+            bool pathBase(int32_t slot, uint32_t &reg)
+            {
+                if (slot < 0)
+                    return false;
+                reg = asValue(slotRegisters[slot]);
+                return true;
+            }
+
+            // Temporaries are unique within a statement and reused by the next one
+            void resetTemporaries()
+            {
+                nextNumber = out.firstConstant + static_cast<uint32_t>(out.numbers.size());
+                nextValue = valueSlots;
+            }
+
+            Operand temporary(bool number)
+            {
+                Operand temp;
+                temp.number = number;
+                if (number)
+                {
+                    temp.reg = nextNumber++;
+                    maxNumberTemps = std::max(maxNumberTemps, nextNumber);
+                }
+                else
+                {
+                    temp.reg = nextValue++;
+                    maxValueTemps = std::max(maxValueTemps, nextValue);
+                }
+                return temp;
+            }
+
+            // A temporary written by the instruction about to be emitted
+            Operand produce(bool number)
+            {
+                Operand temp = temporary(number);
+                temp.producer = static_cast<int32_t>(out.code.size());
+                return temp;
+            }
+
+            // --- Constants ---
+
+            uint32_t numberConstant(NUMBER value)
+            {
+                uint64_t bits = 0;
+                std::memcpy(&bits, &value, sizeof(value));
+                auto found = numberRegisters.find(bits);
+                if (found != numberRegisters.end())
+                    return found->second;
+                uint32_t reg = out.firstConstant + static_cast<uint32_t>(out.numbers.size());
+                out.numbers.push_back(value);
+                numberRegisters.emplace(bits, reg);
+                return reg;
+            }
+
+            void collectNumbers(const ExpressionPtr &expr)
+            {
+                if (!expr)
+                    return;
+                for (const RpnToken &tok : expr->code)
+                    if (tok.kind == TokenKind::Literal && tok.value.type == TS::ValueType::Number)
+                        numberConstant(tok.value.asNumber());
+            }
+
+            void collectNumbers(const Block &body)
+            {
+                for (const Statement &stmt : body)
+                {
+                    collectNumbers(stmt.expr);
+                    collectNumbers(stmt.index);
+                    for (const ExpressionPtr &arg : stmt.args)
+                        collectNumbers(arg);
+                    collectNumbers(stmt.init);
+                    collectNumbers(stmt.body);
+                    collectNumbers(stmt.elseBody);
+                    collectNumbers(stmt.update);
+                }
+            }
+
+            // --- Conversions between the register files ---
+
+            uint32_t asNumber(const Operand &operand)
+            {
+                if (operand.number)
+                    return operand.reg;
+                Operand temp = produce(true);
+                emit(Op::Unbox, temp.reg, operand.reg);
+                return temp.reg;
+            }
+
+            uint32_t asValue(const Operand &operand)
+            {
+                if (!operand.number)
+                    return operand.reg;
+                Operand temp = produce(false);
+                emit(Op::Box, temp.reg, operand.reg);
+                return temp.reg;
+            }
+
+            Operand undefinedValue()
+            {
+                Operand temp = produce(false);
+                uint32_t index = static_cast<uint32_t>(out.values.size());
+                out.values.emplace_back();
+                emit(Op::LoadConstant, temp.reg, index);
+                return temp;
+            }
+
+            // Copies operands into consecutive value registers (call arguments, array elements)
+            uint32_t valueBlock(const Operand *operands, uint32_t count)
+            {
+                uint32_t base = nextValue;
+                for (uint32_t i = 0; i < count; ++i)
+                    temporary(false);
+                for (uint32_t i = 0; i < count; ++i)
+                {
+                    const Operand &arg = operands[i];
+                    // A temporary is only read here: have its producer write the block directly
+                    if (arg.producer >= 0 && !arg.number)
+                        out.code[arg.producer].a = base + i;
+                    else if (arg.number)
+                        emit(Op::Box, base + i, arg.reg);
+                    else
+                        emit(Op::MoveV, base + i, arg.reg);
+                }
+                return base;
+            }
+
+            // --- Expressions ---
+
+            void tokens(const RpnToken *first, const RpnToken *last, std::vector<Operand> &stack)
+            {
+                auto pop = [this, &stack]() -> Operand
+                {
+                    if (stack.empty())
+                        return undefinedValue();
+                    Operand top = stack.back();
+                    stack.pop_back();
+                    return top;
+                };
+
+                for (; first != last; ++first)
+                {
+                    const RpnToken &tok = *first;
+                    switch (tok.kind)
+                    {
+                    case TokenKind::Literal:
+                        if (tok.value.type == TS::ValueType::Number)
+                            stack.push_back(Operand{true, numberConstant(tok.value.asNumber())});
+                        else
+                        {
+                            Operand temp = produce(false);
+                            uint32_t index = static_cast<uint32_t>(out.values.size());
+                            out.values.push_back(tok.value);
+                            emit(Op::LoadConstant, temp.reg, index);
+                            stack.push_back(temp);
+                        }
+                        break;
+
+                    case TokenKind::Variable:
+                        if (tok.path)
+                        {
+                            uint32_t local = 0;
+                            bool global = !pathBase(tok.slot, local);
+                            Operand temp = produce(false);
+                            size_t load = emit(Op::LoadPath, temp.reg, path(tok.name, tok.atom, tok.path), local);
+                            out.code[load].global = global;
+                            stack.push_back(temp);
+                        }
+                        else if (tok.slot >= 0)
+                            stack.push_back(slotRegisters[tok.slot]);
+                        else
+                        {
+                            Operand temp = produce(false);
+                            emit(Op::LoadGlobal, temp.reg, name(tok.name));
+                            stack.push_back(temp);
+                        }
+                        break;
+
+                    case TokenKind::Call:
+                        if (tok.path)
+                        {
+                            stack.push_back(pathCall(tok, stack));
+                            break;
+                        }
+                        [[fallthrough]];
+                    case TokenKind::Array:
+                    case TokenKind::Object:
+                    {
+                        uint32_t argc = std::min<uint32_t>(tok.argc, static_cast<uint32_t>(stack.size()));
+                        uint32_t base = valueBlock(stack.data() + stack.size() - argc, argc);
+                        stack.resize(stack.size() - argc);
+                        Operand result = produce(false);
+                        if (tok.kind == TokenKind::Array)
+                            emit(Op::MakeArray, result.reg, base, argc);
+                        else if (tok.kind == TokenKind::Object)
+                            emit(Op::MakeObject, result.reg, path(tok.name, tok.atom, tok.path), base, argc);
+                        else
+                            emit(Op::Call, result.reg, tok.atom, base, argc);
+                        stack.push_back(result);
+                        break;
+                    }
+
+                    case TokenKind::Member:
+                    {
+                        uint32_t object = asValue(pop());
+                        Operand result = produce(false);
+                        emit(Op::GetMember, result.reg, path(tok.name, tok.atom, tok.path), object);
+                        stack.push_back(result);
+                        break;
+                    }
+
+                    case TokenKind::New:
+                    case TokenKind::Method:
+                    {
+                        // A block of `this` (the receiver of a method, a placeholder for
+                        // the instance) and the arguments
+                        uint32_t argc = std::min<uint32_t>(tok.argc, static_cast<uint32_t>(stack.size()));
+                        std::vector<Operand> operands;
+                        if (tok.kind == TokenKind::New)
+                            operands.push_back(undefinedValue());
+                        else
+                            operands.push_back(stack.size() > argc ? stack[stack.size() - argc - 1] : undefinedValue());
+                        operands.insert(operands.end(), stack.end() - argc, stack.end());
+                        stack.resize(stack.size() - std::min<size_t>(argc + (tok.kind == TokenKind::Method), stack.size()));
+                        uint32_t base = valueBlock(operands.data(), argc + 1);
+                        Operand result = produce(false);
+                        emit(tok.kind == TokenKind::New ? Op::New : Op::CallMethod, result.reg,
+                             path(tok.name, tok.atom, tok.path), base, argc);
+                        stack.push_back(result);
+                        break;
+                    }
+
+                    case TokenKind::Operator:
+                        if (tok.op == OpCode::Neg || tok.op == OpCode::Plus || tok.op == OpCode::Not || tok.op == OpCode::Length)
+                            stack.push_back(unary(tok.op, pop()));
+                        else
+                        {
+                            Operand b = pop();
+                            Operand a = pop();
+                            stack.push_back(binary(tok.op, a, b));
+                        }
+                        break;
+                    }
+                }
+            }
+
+            // A block of the first part of a dotted name (a placeholder if it is
+            // no local) and the arguments, for CallPath and CallPathStatement
+            uint32_t pathBlock(int32_t slot, const Operand *args, uint32_t argc)
+            {
+                std::vector<Operand> operands;
+                operands.push_back(slot >= 0 ? slotRegisters[slot] : undefinedValue());
+                operands.insert(operands.end(), args, args + argc);
+                return valueBlock(operands.data(), argc + 1);
+            }
+
+            Operand pathCall(const RpnToken &tok, std::vector<Operand> &stack)
+            {
+                uint32_t argc = std::min<uint32_t>(tok.argc, static_cast<uint32_t>(stack.size()));
+                uint32_t base = pathBlock(tok.slot, stack.data() + stack.size() - argc, argc);
+                stack.resize(stack.size() - argc);
+                Operand result = produce(false);
+                size_t call = emit(Op::CallPath, result.reg, path(tok.name, tok.atom, tok.path), base, argc);
+                out.code[call].global = tok.slot < 0;
+                return result;
+            }
+
+            Operand unary(OpCode op, const Operand &a)
+            {
+                switch (op)
+                {
+                case OpCode::Neg:
+                {
+                    uint32_t x = asNumber(a);
+                    Operand result = produce(true);
+                    emit(Op::NegN, result.reg, x);
+                    return result;
+                }
+                case OpCode::Plus:
+                    if (a.number)
+                        return a;
+                    {
+                        Operand result = produce(true);
+                        emit(Op::Unbox, result.reg, a.reg);
+                        return result;
+                    }
+                default:
+                {
+                    uint32_t x = asValue(a);
+                    Operand result = produce(false);
+                    out.code[emit(Op::Unary, result.reg, x)].oper = op;
+                    return result;
+                }
+                }
+            }
+
+            Operand binary(OpCode op, const Operand &a, const Operand &b)
+            {
+                Op numeric;
+                bool numberResult = true;
+                switch (op)
+                {
+                case OpCode::Add:
+                    if (!a.number || !b.number)
+                        return generic(op, a, b);
+                    numeric = Op::AddN;
+                    break;
+                case OpCode::Sub:
+                    numeric = Op::SubN;
+                    break;
+                case OpCode::Mul:
+                    numeric = Op::MulN;
+                    break;
+                case OpCode::Div:
+                    numeric = Op::DivN;
+                    break;
+                case OpCode::Mod:
+                    numeric = Op::ModN;
+                    break;
+                case OpCode::Pow:
+                    numeric = Op::PowN;
+                    break;
+                // Ordering compares numbers whatever the operands are
+                case OpCode::Lt:
+                    numeric = Op::LtN, numberResult = false;
+                    break;
+                case OpCode::Gt:
+                    numeric = Op::GtN, numberResult = false;
+                    break;
+                case OpCode::Le:
+                    numeric = Op::LeN, numberResult = false;
+                    break;
+                case OpCode::Ge:
+                    numeric = Op::GeN, numberResult = false;
+                    break;
+                // Equality is numeric only between numbers
+                case OpCode::Eq:
+                case OpCode::StrictEq:
+                    if (!a.number || !b.number)
+                        return generic(op, a, b);
+                    numeric = Op::EqN, numberResult = false;
+                    break;
+                case OpCode::Ne:
+                case OpCode::StrictNe:
+                    if (!a.number || !b.number)
+                        return generic(op, a, b);
+                    numeric = Op::NeN, numberResult = false;
+                    break;
+                case OpCode::Index:
+                {
+                    if (!b.number)
+                        return generic(op, a, b);
+                    uint32_t target = asValue(a);
+                    Operand result = produce(false);
+                    emit(Op::IndexN, result.reg, target, b.reg);
+                    return result;
+                }
+                default:
+                    return generic(op, a, b);
+                }
+                uint32_t x = asNumber(a);
+                uint32_t y = asNumber(b);
+                Operand result = produce(numberResult);
+                emit(numeric, result.reg, x, y);
+                return result;
+            }
+
+            Operand generic(OpCode op, const Operand &a, const Operand &b)
+            {
+                uint32_t x = asValue(a);
+                uint32_t y = asValue(b);
+                Operand result = produce(false);
+                out.code[emit(Op::Binary, result.reg, x, y)].oper = op;
+                return result;
+            }
+
+            Operand expression(const ExpressionPtr &expr)
+            {
+                if (!expr)
+                    return undefinedValue();
+                std::vector<Operand> stack;
+                tokens(expr->code.data(), expr->code.data() + expr->code.size(), stack);
+                return stack.empty() ? undefinedValue() : stack.back();
+            }
+
+            // Emits a jump to be patched, taken when `expr` is truthy (or falsy
+            // unless `whenTrue`); comparisons of numbers jump directly
+            size_t branch(const ExpressionPtr &expr, bool whenTrue)
+            {
+                if (!expr || expr->code.empty())
+                    return test(undefinedValue(), whenTrue);
+
+                const RpnToken *first = expr->code.data();
+                const RpnToken *last = first + expr->code.size() - 1;
+                std::vector<Operand> stack;
+                tokens(first, last, stack);
+
+                if (last->kind == TokenKind::Operator && last->op == OpCode::Not && !stack.empty())
+                    return test(stack.back(), !whenTrue); // !x jumps where x does not
+
+                Op fused = Op::Jump;
+                bool ordering = true;
+                if (last->kind == TokenKind::Operator && stack.size() >= 2)
+                {
+                    switch (last->op)
+                    {
+                    case OpCode::Lt:
+                        fused = whenTrue ? Op::JumpIfLt : Op::JumpUnlessLt;
+                        break;
+                    case OpCode::Gt:
+                        fused = whenTrue ? Op::JumpIfGt : Op::JumpUnlessGt;
+                        break;
+                    case OpCode::Le:
+                        fused = whenTrue ? Op::JumpIfLe : Op::JumpUnlessLe;
+                        break;
+                    case OpCode::Ge:
+                        fused = whenTrue ? Op::JumpIfGe : Op::JumpUnlessGe;
+                        break;
+                    case OpCode::Eq:
+                    case OpCode::StrictEq:
+                        fused = whenTrue ? Op::JumpIfEq : Op::JumpUnlessEq, ordering = false;
+                        break;
+                    case OpCode::Ne:
+                    case OpCode::StrictNe:
+                        fused = whenTrue ? Op::JumpIfNe : Op::JumpUnlessNe, ordering = false;
+                        break;
+                    default:
+                        break;
+                    }
+                }
+                if (fused != Op::Jump)
+                {
+                    const Operand &a = stack[stack.size() - 2];
+                    const Operand &b = stack.back();
+                    if (ordering || (a.number && b.number))
+                    {
+                        uint32_t x = asNumber(a);
+                        uint32_t y = asNumber(b);
+                        return emit(fused, 0, x, y);
+                    }
+                }
+
+                tokens(last, last + 1, stack);
+                return test(stack.empty() ? undefinedValue() : stack.back(), whenTrue);
+            }
+
+            size_t test(const Operand &x, bool whenTrue)
+            {
+                if (x.number)
+                    return emit(whenTrue ? Op::JumpIfN : Op::JumpUnlessN, 0, x.reg);
+                return emit(whenTrue ? Op::JumpIf : Op::JumpUnless, 0, x.reg);
+            }
+
+            // --- Statements ---
+
+            // Writes an operand to a slot, retargeting the instruction that just produced it
+            bool store(int32_t slot, const Operand &value)
+            {
+                const Operand &target = slotRegisters[slot];
+                if (value.producer >= 0 && value.number == target.number && value.producer + 1 == static_cast<int32_t>(out.code.size()))
+                {
+                    out.code.back().a = target.reg;
+                    return true;
+                }
+                if (target.number)
+                {
+                    if (!value.number)
+                        return false; // ruled out by NumberSlots
+                    if (value.reg != target.reg)
+                        emit(Op::MoveN, target.reg, value.reg);
+                    return true;
+                }
+                if (value.number)
+                    emit(Op::Box, target.reg, value.reg);
+                else if (value.reg != target.reg)
+                    emit(Op::MoveV, target.reg, value.reg);
+                return true;
+            }
+
+            bool assignment(const Statement &stmt)
+            {
+                uint32_t begin = here();
+                if (stmt.index)
+                {
+                    // name[index] = expr: checked, evaluated and written like assignElement
+                    bool global = stmt.slot < 0;
+                    if (!global && slotRegisters[stmt.slot].number)
+                        return false;
+                    uint32_t target = global ? 0 : slotRegisters[stmt.slot].reg;
+                    uint32_t label = stmt.path ? path(stmt.name, stmt.atom, stmt.path) : name(stmt.name);
+                    size_t check = emit(Op::CheckArray, target, 0, 0, label);
+                    out.code[check].global = global;
+                    uint32_t index = asNumber(expression(stmt.index));
+                    uint32_t value = asValue(expression(stmt.expr));
+                    size_t set = emit(Op::SetElement, target, index, value, label);
+                    out.code[set].global = global;
+                    out.code[check].c = here();
+                }
+                else if (stmt.path)
+                {
+                    uint32_t value = asValue(expression(stmt.expr));
+                    uint32_t local = 0;
+                    bool global = !pathBase(stmt.slot, local);
+                    size_t set = emit(Op::StorePath, path(stmt.name, stmt.atom, stmt.path), value, local);
+                    out.code[set].global = global;
+                }
+                else if (stmt.slot >= 0)
+                {
+                    if (!store(stmt.slot, expression(stmt.expr)))
+                        return false;
+                }
+                else
+                {
+                    uint32_t value = asValue(expression(stmt.expr));
+                    emit(Op::StoreGlobal, name(stmt.name), value);
+                }
+                out.handlers.push_back(Bytecode::Handler{begin, here(), here()});
+                return true;
+            }
+
+            bool statement(const Statement &stmt)
+            {
+                resetTemporaries();
+                switch (stmt.kind)
+                {
+                case StatementKind::Let:
+                case StatementKind::Assign:
+                    return assignment(stmt);
+
+                case StatementKind::If:
+                {
+                    size_t toElse = branch(stmt.expr, false);
+                    if (!block(stmt.body))
+                        return false;
+                    if (stmt.elseBody.empty())
+                    {
+                        patch(toElse, here());
+                        return true;
+                    }
+                    size_t toEnd = emit(Op::Jump);
+                    patch(toElse, here());
+                    if (!block(stmt.elseBody))
+                        return false;
+                    patch(toEnd, here());
+                    return true;
+                }
+
+                case StatementKind::While:
+                {
+                    // jump cond; body: ...; cond: if (expr) goto body
+                    size_t toCondition = emit(Op::Jump);
+                    uint32_t body = here();
+                    loops.emplace_back();
+                    bool ok = block(stmt.body);
+                    uint32_t condition = here();
+                    patch(toCondition, condition);
+                    resetTemporaries();
+                    patch(branch(stmt.expr, true), body);
+                    finishLoop(condition, here());
+                    return ok;
+                }
+
+                case StatementKind::For:
+                {
+                    if (!block(stmt.init))
+                        return false;
+                    size_t toCondition = emit(Op::Jump);
+                    uint32_t body = here();
+                    loops.emplace_back();
+                    bool ok = block(stmt.body);
+                    uint32_t update = here();
+                    ok = ok && block(stmt.update);
+                    patch(toCondition, here());
+                    resetTemporaries();
+                    if (stmt.expr)
+                        patch(branch(stmt.expr, true), body);
+                    else
+                        emit(Op::Jump, body);
+                    finishLoop(update, here());
+                    return ok;
+                }
+
+                case StatementKind::Break:
+                    if (loops.empty())
+                        emit(Op::ReturnUndefined); // like the interpreter, it ends the call
+                    else
+                        loops.back().breaks.push_back(emit(Op::Jump));
+                    return true;
+
+                case StatementKind::Continue:
+                    if (loops.empty())
+                        emit(Op::ReturnUndefined);
+                    else
+                        loops.back().continues.push_back(emit(Op::Jump));
+                    return true;
+
+                case StatementKind::Call:
+                {
+                    std::vector<Operand> args;
+                    for (const ExpressionPtr &arg : stmt.args)
+                        args.push_back(expression(arg));
+                    uint32_t argc = static_cast<uint32_t>(args.size());
+                    if (stmt.path)
+                    {
+                        uint32_t base = pathBlock(stmt.slot, args.data(), argc);
+                        size_t call = emit(Op::CallPathStatement, path(stmt.name, stmt.atom, stmt.path), 0, base, argc);
+                        out.code[call].global = stmt.slot < 0;
+                        return true;
+                    }
+                    uint32_t base = valueBlock(args.data(), argc);
+                    emit(Op::CallStatement, name(stmt.name), stmt.atom, base, argc);
+                    return true;
+                }
+
+                case StatementKind::Return:
+                {
+                    if (!stmt.expr)
+                    {
+                        emit(Op::ReturnUndefined);
+                        return true;
+                    }
+                    Operand value = expression(stmt.expr);
+                    emit(value.number ? Op::ReturnN : Op::Return, value.reg);
+                    return true;
+                }
+
+                default:
+                    return false;
+                }
+            }
+
+            void finishLoop(uint32_t continueTarget, uint32_t breakTarget)
+            {
+                for (size_t jump : loops.back().continues)
+                    patch(jump, continueTarget);
+                for (size_t jump : loops.back().breaks)
+                    patch(jump, breakTarget);
+                loops.pop_back();
+            }
+
+            bool block(const Block &body)
+            {
+                for (const Statement &stmt : body)
+                    if (!statement(stmt))
+                        return false;
+                return true;
+            }
+        };
+    } // namespace
+
+    std::shared_ptr<const Bytecode> compileBytecode(const FunctionDef &def)
+    {
+        if (!compilable(def.body))
+            return nullptr;
+        return BytecodeCompiler(def).compile();
+    }
+
+    // --- Execution ---
+
+    // Register files with at most this many entries live on the C++ stack (larger ones in ctx.scratch)
+    constexpr uint32_t kInlineRegisters = 16;
+
+    static inline bool truthy(NUMBER x)
+    {
+        return x != 0 && !std::isnan(x);
+    }
+
+    static const TS::Value *elementTarget(const Instruction &ins, const Bytecode &code, TS::Value *v, Context &ctx)
+    {
+        if (const PropertyPath *path = code.paths[ins.d].get())
+            return resolvePath(*path, ins.global ? nullptr : &v[ins.a], code.atoms[ins.d], ctx.variables);
+        return ins.global ? ctx.variables.lookup(code.atoms[ins.d]) : &v[ins.a];
+    }
+
+    // Existing variables are updated where they live, new ones become globals
+    static void storeGlobal(uint32_t name, const TS::Value &value, Context &ctx)
+    {
+        if (TS::Value *existing = ctx.variables.lookup(name))
+        {
+            *existing = value;
+            return;
+        }
+        TS::Environment *global = &ctx.variables;
+        while (global->parent)
+            global = global->parent;
+        TS::setVar(*global, name, value);
+    }
+
+    bool runBytecode(const Bytecode &code, Args args, Context &ctx, TS::Value &result)
+    {
+        for (size_t i = 0; i < code.params.size(); ++i)
+            if (code.params[i].number && args[i].type != TS::ValueType::Number)
+                return false;
+
+        TS::Arena::Scope frameScope(ctx.scratch);
+        NUMBER numberInline[kInlineRegisters];
+        TS::Value valueInline[kInlineRegisters];
+        std::pmr::vector<NUMBER> numberArena(&ctx.scratch);
+        std::pmr::vector<TS::Value> valueArena(&ctx.scratch);
+        NUMBER *n = numberInline;
+        TS::Value *v = valueInline;
+        if (code.numberRegisters > kInlineRegisters)
+        {
+            numberArena.resize(code.numberRegisters);
+            n = numberArena.data();
+        }
+        if (code.valueRegisters > kInlineRegisters)
+        {
+            valueArena.resize(code.valueRegisters);
+            v = valueArena.data();
+        }
+
+        std::copy(code.numbers.begin(), code.numbers.end(), n + code.firstConstant);
+        for (size_t i = 0; i < code.params.size(); ++i)
+        {
+            if (code.params[i].number)
+                n[code.params[i].reg] = args[i].asNumber();
+            else
+                v[code.params[i].reg] = args[i];
+        }
+
+        const Instruction *start = code.code.data();
+        const Instruction *pc = start;
+
+#ifdef INTERPRETER_COMPUTED_GOTO
+        static const void *const labels[] = {
+#define INTERPRETER_BYTECODE_LABEL(name) &&op_##name,
+            INTERPRETER_BYTECODE_OPS(INTERPRETER_BYTECODE_LABEL)
+#undef INTERPRETER_BYTECODE_LABEL
+        };
+#define CASE(name) op_##name:
+#define DISPATCH() goto *labels[static_cast<size_t>(pc->op)]
+#else
+#define CASE(name) case BytecodeOp::name:
+#define DISPATCH() continue
+#endif
+// Plain blocks rather than do/while: DISPATCH() is `continue` for the switch
+#define NEXT()      \
+    {               \
+        ++pc;       \
+        DISPATCH(); \
+    }
+#define JUMP_IF(condition)                            \
+    {                                                 \
+        pc = (condition) ? start + pc->a : pc + 1;    \
+        DISPATCH();                                   \
+    }
+
+        for (;;)
+        {
+            try
+            {
+#ifdef INTERPRETER_COMPUTED_GOTO
+                DISPATCH();
+#else
+                for (;;)
+                {
+                    switch (pc->op)
+                    {
+#endif
+                CASE(Jump)
+                {
+                    pc = start + pc->a;
+                    DISPATCH();
+                }
+                CASE(JumpIf) JUMP_IF(v[pc->b].toBool());
+                CASE(JumpUnless) JUMP_IF(!v[pc->b].toBool());
+                CASE(JumpIfN) JUMP_IF(truthy(n[pc->b]));
+                CASE(JumpUnlessN) JUMP_IF(!truthy(n[pc->b]));
+                CASE(JumpIfLt) JUMP_IF(n[pc->b] < n[pc->c]);
+                CASE(JumpIfGt) JUMP_IF(n[pc->b] > n[pc->c]);
+                CASE(JumpIfLe) JUMP_IF(n[pc->b] <= n[pc->c]);
+                CASE(JumpIfGe) JUMP_IF(n[pc->b] >= n[pc->c]);
+                CASE(JumpIfEq) JUMP_IF(n[pc->b] == n[pc->c]);
+                CASE(JumpIfNe) JUMP_IF(n[pc->b] != n[pc->c]);
+                CASE(JumpUnlessLt) JUMP_IF(!(n[pc->b] < n[pc->c]));
+                CASE(JumpUnlessGt) JUMP_IF(!(n[pc->b] > n[pc->c]));
+                CASE(JumpUnlessLe) JUMP_IF(!(n[pc->b] <= n[pc->c]));
+                CASE(JumpUnlessGe) JUMP_IF(!(n[pc->b] >= n[pc->c]));
+                CASE(JumpUnlessEq) JUMP_IF(!(n[pc->b] == n[pc->c]));
+                CASE(JumpUnlessNe) JUMP_IF(!(n[pc->b] != n[pc->c]));
+
+                CASE(MoveN)
+                {
+                    n[pc->a] = n[pc->b];
+                    NEXT();
+                }
+                CASE(MoveV)
+                {
+                    v[pc->a] = v[pc->b];
+                    NEXT();
+                }
+                CASE(Box)
+                {
+                    v[pc->a] = TS::Value(n[pc->b]);
+                    NEXT();
+                }
+                CASE(Unbox)
+                {
+                    n[pc->a] = v[pc->b].toNumber();
+                    NEXT();
+                }
+                CASE(LoadConstant)
+                {
+                    v[pc->a] = code.values[pc->b];
+                    NEXT();
+                }
+                CASE(LoadGlobal)
+                {
+                    const TS::Value *global = ctx.variables.lookup(code.atoms[pc->b]);
+                    v[pc->a] = global ? *global : TS::Value();
+                    NEXT();
+                }
+                CASE(StoreGlobal)
+                {
+                    storeGlobal(code.atoms[pc->a], v[pc->b], ctx);
+                    NEXT();
+                }
+                CASE(LoadPath)
+                {
+                    const TS::Value *found = resolvePath(*code.paths[pc->b], pc->global ? nullptr : &v[pc->c],
+                                                         code.atoms[pc->b], ctx.variables);
+                    v[pc->a] = found ? *found : TS::Value();
+                    NEXT();
+                }
+                CASE(StorePath)
+                {
+                    // A property, or else a dotted global such as a class static
+                    if (!assignPath(*code.paths[pc->a], pc->global ? nullptr : &v[pc->c], ctx.variables, v[pc->b]))
+                        storeGlobal(code.atoms[pc->a], v[pc->b], ctx);
+                    NEXT();
+                }
+                CASE(GetMember)
+                {
+                    const PropertyPath &path = *code.paths[pc->b];
+                    const TS::Value *found = TS::findProperty(v[pc->c], path.keys[0], path.caches[0]);
+                    TS::Value value = found ? *found : TS::Value(); // `found` may live in V[a]
+                    v[pc->a] = std::move(value);
+                    NEXT();
+                }
+                CASE(MakeObject)
+                {
+                    v[pc->a] = objectLiteral(*code.paths[pc->b], v + pc->c, pc->d);
+                    NEXT();
+                }
+
+                CASE(AddN)
+                {
+                    n[pc->a] = n[pc->b] + n[pc->c];
+                    NEXT();
+                }
+                CASE(SubN)
+                {
+                    n[pc->a] = n[pc->b] - n[pc->c];
+                    NEXT();
+                }
+                CASE(MulN)
+                {
+                    n[pc->a] = n[pc->b] * n[pc->c];
+                    NEXT();
+                }
+                CASE(DivN)
+                {
+                    NUMBER divisor = n[pc->c];
+                    n[pc->a] = divisor == 0 ? std::numeric_limits<NUMBER>::quiet_NaN() : n[pc->b] / divisor;
+                    NEXT();
+                }
+                CASE(ModN)
+                {
+                    n[pc->a] = std::fmod(n[pc->b], n[pc->c]);
+                    NEXT();
+                }
+                CASE(PowN)
+                {
+                    n[pc->a] = static_cast<NUMBER>(std::pow(n[pc->b], n[pc->c]));
+                    NEXT();
+                }
+                CASE(NegN)
+                {
+                    n[pc->a] = -n[pc->b];
+                    NEXT();
+                }
+                CASE(LtN)
+                {
+                    v[pc->a] = TS::Value(n[pc->b] < n[pc->c]);
+                    NEXT();
+                }
+                CASE(GtN)
+                {
+                    v[pc->a] = TS::Value(n[pc->b] > n[pc->c]);
+                    NEXT();
+                }
+                CASE(LeN)
+                {
+                    v[pc->a] = TS::Value(n[pc->b] <= n[pc->c]);
+                    NEXT();
+                }
+                CASE(GeN)
+                {
+                    v[pc->a] = TS::Value(n[pc->b] >= n[pc->c]);
+                    NEXT();
+                }
+                CASE(EqN)
+                {
+                    v[pc->a] = TS::Value(n[pc->b] == n[pc->c]);
+                    NEXT();
+                }
+                CASE(NeN)
+                {
+                    v[pc->a] = TS::Value(n[pc->b] != n[pc->c]);
+                    NEXT();
+                }
+                CASE(Binary)
+                {
+                    v[pc->a] = applyOpVal(pc->oper, v[pc->b], v[pc->c]);
+                    NEXT();
+                }
+                CASE(Unary)
+                {
+                    v[pc->a] = applyUnaryOpVal(pc->oper, v[pc->b]);
+                    NEXT();
+                }
+                CASE(IndexN)
+                {
+                    // Out of range and non-integer indices are null
+                    NUMBER i = n[pc->c];
+                    if (!(i >= 0) || i != std::floor(i))
+                        v[pc->a] = TS::Value();
+                    else
+                        v[pc->a] = v[pc->b].at(static_cast<size_t>(i));
+                    NEXT();
+                }
+                CASE(MakeArray)
+                {
+                    std::vector<TS::Value> elements(v + pc->b, v + pc->b + pc->c);
+                    v[pc->a] = TS::Value::makeArray(std::move(elements));
+                    NEXT();
+                }
+                CASE(Call)
+                {
+                    const Callable *callee = ctx.callables.find(pc->b);
+                    const TS::Value *argv = v + pc->c;
+                    uint32_t argc = pc->d;
+                    TS::Value out; // undefined when the callee is unknown
+                    if (callee)
+                    {
+                        if (argc == 1 && callee->fn1)
+                            out = callee->fn1(argv[0]);
+                        else if (argc == 2 && callee->fn2)
+                            out = callee->fn2(argv[0], argv[1]);
+                        else
+                            out = callee->fn(Args(argv, argc, &ctx));
+                    }
+                    v[pc->a] = std::move(out);
+                    NEXT();
+                }
+                CASE(New)
+                {
+                    v[pc->a] = construct(*code.paths[pc->b], code.atoms[pc->b], v + pc->c, pc->d + 1, ctx.callables, &ctx);
+                    NEXT();
+                }
+                CASE(CallMethod)
+                {
+                    TS::Value out; // undefined when there is no such method
+                    callMethod(*code.paths[pc->b], v + pc->c, pc->d + 1, ctx.callables, &ctx, out);
+                    v[pc->a] = std::move(out);
+                    NEXT();
+                }
+                CASE(CallPath)
+                {
+                    const Callable *callee = ctx.callables.find(code.atoms[pc->b]);
+                    TS::Value *argv = v + pc->c;
+                    TS::Value out;
+                    if (callee && pc->d == 1 && callee->fn1)
+                        out = callee->fn1(argv[1]);
+                    else if (callee && pc->d == 2 && callee->fn2)
+                        out = callee->fn2(argv[1], argv[2]);
+                    else if (callee)
+                        out = callee->fn(Args(argv + 1, pc->d, &ctx));
+                    else
+                        out = callPathMethod(*code.paths[pc->b], pc->global ? nullptr : argv, argv, pc->d, ctx.callables,
+                                             &ctx, ctx.variables);
+                    v[pc->a] = std::move(out);
+                    NEXT();
+                }
+                CASE(CallPathStatement)
+                {
+                    callPathStatement(code.names[pc->a], code.atoms[pc->a], *code.paths[pc->a], pc->global ? nullptr : v + pc->c,
+                                      v + pc->c, pc->d, ctx, ctx.variables);
+                    NEXT();
+                }
+                CASE(CallStatement)
+                {
+                    callStatement(code.names[pc->a], pc->b, Args(v + pc->c, pc->d, &ctx), ctx);
+                    NEXT();
+                }
+                CASE(CheckArray)
+                {
+                    const TS::Value *target = elementTarget(*pc, code, v, ctx);
+                    if (!target || !target->isArray())
+                    {
+                        ctx.console->printLine("TypeError: '" + code.names[pc->d] + "' is not an array");
+                        pc = start + pc->c;
+                        DISPATCH();
+                    }
+                    NEXT();
+                }
+                CASE(SetElement)
+                {
+                    NUMBER index = n[pc->b];
+                    if (!(index >= 0) || index != std::floor(index))
+                        ctx.console->printLine("RangeError: invalid index for '" + code.names[pc->d] + "'");
+                    else
+                    {
+                        // Re-resolve: evaluating the value may have rebound the variable
+                        const TS::Value *target = elementTarget(*pc, code, v, ctx);
+                        if (target && target->isArray())
+                            target->setAt(static_cast<size_t>(index), v[pc->c]);
+                    }
+                    NEXT();
+                }
+                CASE(Return)
+                {
+                    result = std::move(v[pc->a]);
+                    return true;
+                }
+                CASE(ReturnN)
+                {
+                    result = TS::Value(n[pc->a]);
+                    return true;
+                }
+                CASE(ReturnUndefined)
+                {
+                    result = TS::Value();
+                    return true;
+                }
+#ifndef INTERPRETER_COMPUTED_GOTO
+                    }
+                }
+#endif
+            }
+            catch (const std::exception &e)
+            {
+                // Only `let` and assignments report and carry on; anything else propagates
+                uint32_t at = static_cast<uint32_t>(pc - start);
+                auto handler = std::find_if(code.handlers.begin(), code.handlers.end(), [at](const Bytecode::Handler &h)
+                                            { return at >= h.begin && at < h.end; });
+                if (handler == code.handlers.end())
+                    throw;
+                ctx.console->printLine(std::string("Error evaluating expression: ") + e.what());
+                pc = start + handler->resume;
+            }
+        }
+
+#undef CASE
+#undef DISPATCH
+#undef NEXT
+#undef JUMP_IF
+    }
+
+} // namespace Interpreter